@@ -1,3 +1,40 @@
+////////////////////////////////////////////////////////////////////////////////
+#shader packing
+////////////////////////////////////////////////////////////////////////////////
+
+// packed vertices: a_pos is normalized to the model bounds, identity offset
+// and scale for float vertices. with PACKED a_normal has two components,
+// octahedral encoded in xy, z reads as 0.
+uniform vec3 u_pos_offset;
+uniform vec3 u_pos_scale;
+
+vec3 unpack_pos( vec3 p )
+{
+    return u_pos_offset + p * u_pos_scale;
+}
+
+vec3 unpack_normal( vec3 n )
+{
+#ifdef PACKED
+    vec3 o = vec3( n.xy, 1.0 - abs( n.x ) - abs( n.y ) );
+    if ( o.z < 0.0 ) {
+        o.xy = ( 1.0 - abs( o.yx ) ) * sign( o.xy );
+    }
+    return normalize( o );
+#else
+    return n;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#shader gbuffer
+////////////////////////////////////////////////////////////////////////////////
+
+#define O_COLOR    0
+#define O_POSITION 1
+#define O_NORMAL   2
+#define O_EMISSION 3
+
 ////////////////////////////////////////////////////////////////////////////////
 #shader vertex_deferred
 ////////////////////////////////////////////////////////////////////////////////
@@ -6,23 +43,34 @@
 precision highp float;
 attribute vec3 a_pos;
 attribute vec3 a_normal;
-attribute vec2 a_uv;
+// the third buffer, the uv in xy or with BAKED the palette texel baked at
+// import
+attribute vec4 a_uv_or_color;
 
 uniform mat4 u_proj;
 uniform mat4 u_view;
 uniform mat4 u_model;
 
+#include "packing"
+
 varying vec3 v_normal; // in world coords
 varying vec3 v_position; // in world coords
+#if defined( TEXTURED )
 varying vec2 v_uv;
+#elif defined( BAKED )
+varying vec4 v_color;
+#endif
 
 void main()
 {
-    vec4 pos = vec4( a_pos, 1.0 );
-    vec4 world_pos = u_model * pos;
-
-    v_normal = ( u_model * vec4( a_normal, 0.0 ) ).xyz;
-    v_uv = a_uv;
+    vec4 world_pos = u_model * vec4( unpack_pos( a_pos ), 1.0 );
+
+    v_normal = ( u_model * vec4( unpack_normal( a_normal ), 0.0 ) ).xyz;
+#if defined( TEXTURED )
+    v_uv = a_uv_or_color.xy;
+#elif defined( BAKED )
+    v_color = a_uv_or_color;
+#endif
     v_position = world_pos.xyz;
     gl_Position = u_proj * u_view * world_pos;
 }
@@ -36,23 +84,28 @@ precision highp float;
 uniform vec4 u_color;
 varying vec3 v_normal; // in world coords
 varying vec3 v_position; // in world coords
+#if defined( TEXTURED )
 varying vec2 v_uv;
-
 uniform sampler2D u_material_texture;
-uniform float u_material_mix;
+#elif defined( BAKED )
+varying vec4 v_color;
+#endif
+
 uniform vec3 u_emission;
 
-#define O_COLOR    0
-#define O_POSITION 1
-#define O_NORMAL   2
-#define O_EMISSION 3
+#include "gbuffer"
 
 void main()
 {
-    vec4 texture_color = texture2D( u_material_texture, v_uv );
-    texture_color = mix( texture_color, vec4(1.0, 1.0, 1.0, 1.0), u_material_mix );
-
-    gl_FragData[ O_COLOR ] =  u_color * texture_color;
+    // untextured draws take the material color alone
+    vec4 color = u_color;
+#if defined( TEXTURED )
+    color *= texture2D( u_material_texture, v_uv );
+#elif defined( BAKED )
+    color *= v_color;
+#endif
+
+    gl_FragData[ O_COLOR ] = color;
     gl_FragData[ O_COLOR ].a = 1.0;
     gl_FragData[ O_POSITION ] = vec4( v_position, 1.0 );
     gl_FragData[ O_NORMAL ] = vec4( v_normal, 1.0 );
@@ -66,15 +119,15 @@ void main()
 #version 100
 precision highp float;
 attribute vec3 a_pos;
-attribute vec3 a_normal;
-attribute vec2 a_uv;
 
 uniform mat4 u_combined;
 uniform mat4 u_model;
 
+#include "packing"
+
 void main()
 {
-    gl_Position = u_combined * u_model * vec4( a_pos, 1.0 );
+    gl_Position = u_combined * u_model * vec4( unpack_pos( a_pos ), 1.0 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -96,15 +149,16 @@ void main()
 #version 100
 precision highp float;
 attribute vec3 a_pos;
-attribute vec3 a_normal;
-attribute vec2 a_uv;
 uniform mat4 u_proj;
 uniform mat4 u_view;
 uniform mat4 u_model;
 
+#include "packing"
+
 void main()
 {
-    gl_Position = u_proj * u_view * u_model * vec4( a_pos, 1.0 );
+    vec4 pos = vec4( unpack_pos( a_pos ), 1.0 );
+    gl_Position = u_proj * u_view * u_model * pos;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -142,16 +196,19 @@ precision highp float;
 
 uniform sampler2D u_position_texture;
 uniform sampler2D u_normal_texture;
+uniform vec3 u_light_pos;
+
+varying vec2 v_uv;
+
+#ifdef SHADOWED
+// one cube face of the light's shadow map, a pass per face
 uniform sampler2D u_depth_texture;
 uniform vec4 u_depth_tile;
 uniform mat4 u_light_matrix;
-uniform vec3 u_light_pos;
 
 uniform float u_shadow_bias;
 //uniform float u_normal_bias;
 
-varying vec2 v_uv;
-
 bool do_shadow_test( vec3 pos )
 {
     // transform
@@ -174,6 +231,7 @@ bool do_shadow_test( vec3 pos )
            depth >= 0.0 && depth <= 1.0 &&
            depth <= sample_depth;
 }
+#endif
 
 void main()
 {
@@ -183,8 +241,12 @@ void main()
     vec3 to_light = normalize( u_light_pos - pos );
     float diffuse_factor = max( dot( normal, to_light ), 0.0 );
 
-    if ( distance( pos, u_light_pos ) < 10.0 && 
-         do_shadow_test( pos + normal * u_shadow_bias ) ) {
+    bool lit = distance( pos, u_light_pos ) < 10.0;
+#ifdef SHADOWED
+    lit = lit && do_shadow_test( pos + normal * u_shadow_bias );
+#endif
+
+    if ( lit ) {
         // lit
         gl_FragColor = diffuse_factor * vec4( 1.0, 1.0, 1.0, 1.0 );
     } else {
@@ -281,67 +343,3 @@ void main()
     }
 
 }
-
-////////////////////////////////////////////////////////////////////////////////
-#shader shader2_vertex
-////////////////////////////////////////////////////////////////////////////////
-
-#version 100
-attribute vec2 a_pos;
-attribute vec2 a_uv;
-varying vec2 v_uv;
-void main()
-{
-    v_uv = a_uv;
-    gl_Position = vec4( a_pos.x, a_pos.y, 0.0, 1.0 );
-}
-
-////////////////////////////////////////////////////////////////////////////////
-#shader shader2_fragment
-////////////////////////////////////////////////////////////////////////////////
-
-#version 100
-precision lowp float;
-uniform sampler2D u_texture;
-uniform float u_amount;
-varying vec2 v_uv;
-void main()
-{
-    vec2 d = vec2( 0.003, 0.003 ) * u_amount;
-    vec3 c;
-    c.r = texture2D( u_texture, v_uv + d ).r;
-    c.g = texture2D( u_texture, v_uv ).g;
-    c.b = texture2D( u_texture, v_uv - d ).b;
-    gl_FragColor = vec4( c, 1.0 );
-}
-
-////////////////////////////////////////////////////////////////////////////////
-#shader shader3_vertex
-////////////////////////////////////////////////////////////////////////////////
-
-#version 100
-attribute vec2 a_pos;
-attribute vec2 a_uv;
-uniform mat4 u_proj;
-uniform mat4 u_model;
-varying vec2 v_uv;
-void main()
-{
-    v_uv = a_uv;
-    vec4 pos = vec4( a_pos, 0.0, 1.0 );
-    gl_Position = u_proj * u_model * pos;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-#shader shader3_fragment
-////////////////////////////////////////////////////////////////////////////////
-
-#version 100
-precision lowp float;
-uniform sampler2D u_texture;
-uniform vec4 u_color;
-varying vec2 v_uv;
-void main()
-{
-    gl_FragColor = u_color * texture2D( u_texture, v_uv );
-}
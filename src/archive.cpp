@@ -0,0 +1,397 @@
+#include "archive.hpp"
+#include "logging.hpp"
+#include "registry.hpp"
+
+#include <atomic>
+#include <string.h>
+
+const char archive_magic[ 4 ] = { 'M', 'W', 'P', 'K' };
+
+static struct {
+    res_t file; // empty while nothing is mounted
+
+    archive_header_t * header;
+    archive_entry_t * slot_list;
+    const char * names;
+
+    const char ** name_list; // packing order
+    int name_count;
+
+    std::atomic< unsigned char * > * raw_list; // decompressed, per slot
+} intern;
+
+uint64_t archive_name_hash( const char * name )
+{
+    uint64_t hash = hash_string( name, HASH_SEED );
+    return hash == 0 ? 1 : hash;
+}
+
+// lz4 [begin] /////////////////////////////////////////////////////////////////
+
+// the block format: sequences of a token (literal length << 4 | match length
+// - 4, 15 = more length bytes follow), the literals, a 16 bit little endian
+// offset back into the output and the extra match length bytes. the last
+// sequence is only literals.
+
+#define LZ4_MIN_MATCH    4
+#define LZ4_LAST_LITERAL 5  // the last bytes are always literals
+#define LZ4_MATCH_LIMIT  12 // no match starts closer to the end
+#define LZ4_MAX_OFFSET   65535
+#define LZ4_HASH_BITS    16
+
+size_t lz4_bound( size_t size )
+{
+    return size + size / 255 + 16;
+}
+
+static uint32_t read32( const unsigned char * p )
+{
+    uint32_t v;
+    memcpy( &v, p, 4 );
+    return v;
+}
+
+static unsigned char * write_length( unsigned char * op, size_t length )
+{
+    while ( length >= 255 ) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char) length;
+
+    return op;
+}
+
+static unsigned char * write_literals(
+    unsigned char * op,
+    const unsigned char * literals,
+    size_t literal_count,
+    size_t match_code
+)
+{
+    size_t literal_code = literal_count < 15 ? literal_count : 15;
+    *op++ = (unsigned char) ( ( literal_code << 4 ) | match_code );
+
+    if ( literal_count >= 15 ) op = write_length( op, literal_count - 15 );
+
+    memcpy( op, literals, literal_count );
+    return op + literal_count;
+}
+
+/// greedy, one candidate per hash of the next four bytes. positions are
+/// kept as int, respack stores entries of 2 GiB and more uncompressed.
+size_t lz4_compress(
+    const unsigned char * src,
+    size_t size,
+    unsigned char * out
+)
+{
+    int * table = new int[ 1 << LZ4_HASH_BITS ];
+    memset( table, 0xff, sizeof( int ) * ( 1 << LZ4_HASH_BITS ) );
+
+    unsigned char * op = out;
+    size_t anchor = 0;
+    size_t i = 0;
+
+    size_t last_match = size > LZ4_MATCH_LIMIT ? size - LZ4_MATCH_LIMIT : 0;
+    size_t match_end = size > LZ4_LAST_LITERAL ? size - LZ4_LAST_LITERAL : 0;
+
+    while ( i < last_match ) {
+        uint32_t seq = read32( src + i );
+        uint32_t h = ( seq * 2654435761u ) >> ( 32 - LZ4_HASH_BITS );
+
+        int candidate = table[ h ];
+        table[ h ] = (int) i;
+
+        bool found = candidate >= 0 && i - candidate <= LZ4_MAX_OFFSET &&
+                     read32( src + candidate ) == seq;
+        if ( !found ) {
+            i++;
+            continue;
+        }
+
+        const unsigned char * ref = src + candidate;
+
+        size_t length = LZ4_MIN_MATCH;
+        while ( i + length < match_end && ref[ length ] == src[ i + length ] ) {
+            length++;
+        }
+
+        size_t match = length - LZ4_MIN_MATCH;
+        size_t match_code = match < 15 ? match : 15;
+        size_t offset = i - candidate;
+
+        op = write_literals( op, src + anchor, i - anchor, match_code );
+        *op++ = (unsigned char) ( offset & 0xff );
+        *op++ = (unsigned char) ( offset >> 8 );
+        if ( match >= 15 ) op = write_length( op, match - 15 );
+
+        i += length;
+        anchor = i;
+    }
+
+    op = write_literals( op, src + anchor, size - anchor, 0 );
+
+    delete[] table;
+
+    return op - out;
+}
+
+/// reads the rest of a length that did not fit its 4 bits
+static int read_length(
+    const unsigned char ** ip,
+    const unsigned char * end,
+    size_t * length
+)
+{
+    unsigned char b;
+    do {
+        if ( *ip >= end ) return 1;
+        b = *( *ip )++;
+        *length += b;
+    } while ( b == 255 );
+
+    return 0;
+}
+
+int lz4_decompress(
+    const unsigned char * src,
+    size_t size,
+    unsigned char * out,
+    size_t out_size
+)
+{
+    const unsigned char * ip = src;
+    const unsigned char * end = src + size;
+    unsigned char * op = out;
+    unsigned char * out_end = out + out_size;
+
+    while ( ip < end ) {
+        unsigned char token = *ip++;
+
+        size_t literal_count = token >> 4;
+        if ( literal_count == 15 && read_length( &ip, end, &literal_count ) ) {
+            return 1;
+        }
+        if ( literal_count > (size_t) ( end - ip ) ) return 1;
+        if ( literal_count > (size_t) ( out_end - op ) ) return 1;
+
+        memcpy( op, ip, literal_count );
+        op += literal_count;
+        ip += literal_count;
+
+        // the last sequence has no match
+        if ( ip == end ) break;
+
+        if ( end - ip < 2 ) return 1;
+        size_t offset = ip[ 0 ] | ( ip[ 1 ] << 8 );
+        ip += 2;
+        if ( offset == 0 || offset > (size_t) ( op - out ) ) return 1;
+
+        size_t length = token & 15;
+        if ( length == 15 && read_length( &ip, end, &length ) ) return 1;
+        length += LZ4_MIN_MATCH;
+        if ( length > (size_t) ( out_end - op ) ) return 1;
+
+        // byte by byte, the match may overlap what it writes
+        const unsigned char * match = op - offset;
+        for ( size_t i = 0; i < length; i++ ) {
+            op[ i ] = match[ i ];
+        }
+        op += length;
+    }
+
+    return op == out_end ? 0 : 1;
+}
+
+// lz4 [end] ///////////////////////////////////////////////////////////////////
+
+// archive [begin] /////////////////////////////////////////////////////////////
+
+static int check_archive( res_t file )
+{
+    if ( file.size < sizeof( archive_header_t ) ) return 1;
+
+    archive_header_t * header = (archive_header_t *) file.data;
+    if ( memcmp( header->magic, archive_magic, 4 ) != 0 ) return 1;
+    if ( header->version != ARCHIVE_VERSION ) return 1;
+
+    uint32_t slot_count = header->slot_count;
+    if ( slot_count == 0 || ( slot_count & ( slot_count - 1 ) ) != 0 ) {
+        return 1;
+    }
+    if ( header->entry_count >= slot_count ) return 1;
+
+    uint64_t toc_end =
+        sizeof( archive_header_t ) + slot_count * sizeof( archive_entry_t );
+    if ( toc_end > file.size ) return 1;
+
+    uint64_t names_end = header->names_offset + header->names_size;
+    if ( header->names_offset < toc_end || names_end > file.size ) return 1;
+    if ( header->names_size == 0 ) return 1;
+    if ( file.data[ names_end - 1 ] != 0 ) return 1;
+
+    archive_entry_t * slot_list =
+        (archive_entry_t *) ( file.data + sizeof( archive_header_t ) );
+
+    for ( uint32_t i = 0; i < slot_count; i++ ) {
+        archive_entry_t & entry = slot_list[ i ];
+        if ( entry.name_hash == 0 ) continue;
+
+        if ( entry.name_offset >= header->names_size ) return 1;
+        if ( entry.offset > file.size ) return 1;
+        if ( entry.size > file.size - entry.offset ) return 1;
+        if ( entry.codec == ARCHIVE_CODEC_NONE &&
+             entry.size != entry.raw_size ) {
+            return 1;
+        }
+        if ( entry.codec > ARCHIVE_CODEC_LZ4 ) return 1;
+    }
+
+    return 0;
+}
+
+int mount_archive( const char * path )
+{
+    unmount_archive();
+
+    res_t file = load_file( path );
+    if ( !file.data ) return 1;
+
+    if ( check_archive( file ) ) {
+        ERROR_LOG( "not a valid resource archive: %s", path );
+        release_res( &file );
+        return 1;
+    }
+
+    intern.file = file;
+    intern.header = (archive_header_t *) file.data;
+    intern.slot_list =
+        (archive_entry_t *) ( file.data + sizeof( archive_header_t ) );
+    intern.names = (const char *) file.data + intern.header->names_offset;
+
+    int slot_count = intern.header->slot_count;
+    intern.raw_list = new std::atomic< unsigned char * >[ slot_count ];
+    for ( int i = 0; i < slot_count; i++ ) {
+        intern.raw_list[ i ].store( nullptr );
+    }
+
+    // the names are packed in order, one after the other
+    int entry_count = intern.header->entry_count;
+    intern.name_list = new const char *[ entry_count ];
+    intern.name_count = 0;
+
+    const char * name = intern.names;
+    const char * names_end = intern.names + intern.header->names_size;
+    while ( name < names_end && intern.name_count < entry_count ) {
+        intern.name_list[ intern.name_count++ ] = name;
+        name += strlen( name ) + 1;
+    }
+
+    INFO_LOG( "mounted %s, %d resources", path, entry_count );
+
+    return 0;
+}
+
+void unmount_archive()
+{
+    if ( !intern.file.data ) return;
+
+    int slot_count = intern.header->slot_count;
+    for ( int i = 0; i < slot_count; i++ ) {
+        delete[] intern.raw_list[ i ].load();
+    }
+
+    delete[] intern.raw_list;
+    delete[] intern.name_list;
+
+    release_res( &intern.file );
+
+    intern.header = nullptr;
+    intern.slot_list = nullptr;
+    intern.names = nullptr;
+    intern.name_list = nullptr;
+    intern.name_count = 0;
+    intern.raw_list = nullptr;
+}
+
+static int find_slot( const char * name )
+{
+    uint64_t hash = archive_name_hash( name );
+    uint32_t mask = intern.header->slot_count - 1;
+    uint32_t slot = (uint32_t) hash & mask;
+
+    // the table is never full, so there is always an empty slot to stop at
+    while ( intern.slot_list[ slot ].name_hash != 0 ) {
+        archive_entry_t & entry = intern.slot_list[ slot ];
+
+        if ( entry.name_hash == hash &&
+             strcmp( intern.names + entry.name_offset, name ) == 0 ) {
+            return (int) slot;
+        }
+
+        slot = ( slot + 1 ) & mask;
+    }
+
+    return -1;
+}
+
+/// the decompressed entry, the first thread to finish decompressing it wins
+static unsigned char * raw_data( int slot )
+{
+    archive_entry_t & entry = intern.slot_list[ slot ];
+    unsigned char * stored = intern.file.data + entry.offset;
+
+    if ( entry.codec == ARCHIVE_CODEC_NONE ) return stored;
+
+    unsigned char * raw = intern.raw_list[ slot ].load();
+    if ( raw ) return raw;
+
+    raw = new unsigned char[ entry.raw_size > 0 ? entry.raw_size : 1 ];
+
+    if ( lz4_decompress( stored, entry.size, raw, entry.raw_size ) ) {
+        ERROR_LOG(
+            "failed to decompress resource: %s",
+            intern.names + entry.name_offset
+        );
+        delete[] raw;
+        return nullptr;
+    }
+
+    unsigned char * expected = nullptr;
+    if ( !intern.raw_list[ slot ].compare_exchange_strong( expected, raw ) ) {
+        delete[] raw;
+        return expected;
+    }
+
+    return raw;
+}
+
+int archive_find( const char * name, res_t * out_res )
+{
+    if ( !intern.file.data ) return 1;
+
+    int slot = find_slot( name );
+    if ( slot == -1 ) return 1;
+
+    unsigned char * data = raw_data( slot );
+    if ( !data ) return 1;
+
+    out_res->data = data;
+    out_res->size = intern.slot_list[ slot ].raw_size;
+    out_res->storage = RES_UNOWNED;
+
+    return 0;
+}
+
+int archive_entry_count()
+{
+    return intern.name_count;
+}
+
+const char * archive_entry_name( int i )
+{
+    return intern.name_list[ i ];
+}
+
+// archive [end] ///////////////////////////////////////////////////////////////
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "res.hpp"
+
+#include <stdint.h>
+
+/// resource archive, one file holding all of res/. layout:
+///   header
+///   slots  [ slot_count ] entries, open addressing on the name hash
+///   names  every entry name, zero terminated
+///   data   every entry, starting on an ARCHIVE_ALIGN boundary
+/// integers are little endian. written by tools/respack.cpp.
+
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_ALIGN   64
+
+#define ARCHIVE_CODEC_NONE 0
+#define ARCHIVE_CODEC_LZ4  1 // lz4 block format, no frame
+
+struct archive_header_t {
+    char magic[ 4 ];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t slot_count; // power of two, at least twice entry_count
+    uint64_t names_offset;
+    uint64_t names_size;
+};
+
+struct archive_entry_t {
+    uint64_t name_hash; // hash_string, 0 = empty slot
+    uint64_t offset;    // from the start of the archive
+    uint64_t size;      // stored bytes
+    uint64_t raw_size;  // bytes after decompression
+    uint32_t codec;     // ARCHIVE_CODEC_*
+    uint32_t name_offset;
+};
+
+extern const char archive_magic[ 4 ];
+
+/// name hash as stored in the slots, never 0
+uint64_t archive_name_hash( const char * name );
+
+/// maps an archive so find_res serves from it before looking at files
+int mount_archive( const char * path );
+
+void unmount_archive();
+
+/// looks a resource up in the mounted archive. compressed entries are
+/// decompressed on first use and kept until unmount, the archive owns the
+/// data either way.
+/// @threadsafe
+int archive_find( const char * name, res_t * out_res );
+
+/// entries of the mounted archive, 0 without one
+int archive_entry_count();
+
+/// name of the i'th entry in the order they were packed
+const char * archive_entry_name( int i );
+
+/// worst case size of compressing size bytes
+size_t lz4_bound( size_t size );
+
+/// compresses into out, which needs lz4_bound( size ) bytes. returns the
+/// compressed size.
+size_t lz4_compress(
+    const unsigned char * src,
+    size_t size,
+    unsigned char * out
+);
+
+/// decompresses exactly out_size bytes, fails on malformed input
+int lz4_decompress(
+    const unsigned char * src,
+    size_t size,
+    unsigned char * out,
+    size_t out_size
+);
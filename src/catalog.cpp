@@ -0,0 +1,862 @@
+#include "catalog.hpp"
+#include "logging.hpp"
+#include "model_loader.hpp"
+#include "registry.hpp"
+#include "render_utils.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef __EMSCRIPTEN__
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#define CATALOG_VERSION          1
+#define CATALOG_FILE             "models.catalog"
+#define MAX_CATALOG_THREAD_COUNT 4
+#define MAX_PATH_LENGTH          1024
+#define UPLOADS_PER_FRAME        16
+
+#define THUMBNAIL_BYTES ( CATALOG_THUMBNAIL_SIZE * CATALOG_THUMBNAIL_SIZE * 4 )
+
+struct job_t {
+    char * filename;
+    bool optimize;
+
+    // the built entry
+    res_stamp_t stamp;
+    int status;
+    int vertex_count;
+    int triangle_count;
+    float bounds_min[ 3 ];
+    float bounds_max[ 3 ];
+    unsigned char * thumbnail;
+
+    job_t * next;
+};
+
+static struct {
+    catalog_entry_t * entry_list;
+    int entry_count;
+    int entry_cap;
+
+    hash_map_t name_map; // file name hash -> entry
+
+    bool dirty;       // entries changed since models.catalog was written
+    int upload_count; // thumbnails uploaded this frame
+
+    // requests, oldest first
+    job_t * pending_first;
+    job_t * pending_last;
+
+    int pending_count;
+
+#ifndef __EMSCRIPTEN__
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool quit;
+
+    // finished builds, newest first. workers push, the gl thread takes all
+    std::atomic< job_t * > done;
+
+    std::thread thread_list[ MAX_CATALOG_THREAD_COUNT ];
+    int thread_count;
+#endif
+} intern;
+
+// thumbnail [begin] ///////////////////////////////////////////////////////////
+
+// rendered at twice the size and averaged down for smooth edges
+#define RENDER_SIZE ( CATALOG_THUMBNAIL_SIZE * 2 )
+
+/// diffuse color of each material group, grey without a material
+static float * group_colors( model_data_t * data )
+{
+    wavefront_t * mesh = data->mesh;
+    material_lib_t & lib = data->material_lib;
+
+    float * color_list = new float[ mesh->material_group_count * 3 + 3 ];
+
+    for ( int i = 0; i < mesh->material_group_count; i++ ) {
+        float * color = color_list + i * 3;
+        color[ 0 ] = 0.75f;
+        color[ 1 ] = 0.75f;
+        color[ 2 ] = 0.75f;
+
+        if ( !data->has_material_lib ) continue;
+
+        const char * name = mesh->material_group_material_list[ i ];
+        for ( int m = 0; m < lib.material_count; m++ ) {
+            if ( strcmp( name, lib.material_name_list[ m ] ) != 0 ) continue;
+            memcpy( color, lib.material_list[ m ].kd, sizeof( float ) * 3 );
+            break;
+        }
+    }
+
+    return color_list;
+}
+
+/// positions seen from the front left and above, the bounding sphere of the
+/// model fills the image. x right, y down in pixels, z towards the viewer.
+static float * view_positions( model_data_t * data )
+{
+    wavefront_t * mesh = data->mesh;
+
+    float center[ 3 ];
+    float radius = 0.0f;
+    for ( int i = 0; i < 3; i++ ) {
+        center[ i ] = ( data->bounds_min[ i ] + data->bounds_max[ i ] ) * 0.5f;
+        float half = ( data->bounds_max[ i ] - data->bounds_min[ i ] ) * 0.5f;
+        radius += half * half;
+    }
+    radius = sqrtf( radius );
+    if ( radius <= 0.0f ) radius = 1.0f;
+
+    float scale = RENDER_SIZE * 0.5f * 0.95f / radius;
+
+    float yaw = 0.785398f;    // 45 degrees
+    float pitch = -0.523599f; // 30 degrees, looking down
+    float cy = cosf( yaw );
+    float sy = sinf( yaw );
+    float cp = cosf( pitch );
+    float sp = sinf( pitch );
+
+    float * view_list = new float[ mesh->vertex_count * 3 ];
+
+    for ( int v = 0; v < mesh->vertex_count; v++ ) {
+        float * pos = mesh->pos_list + v * 3;
+        float x = pos[ 0 ] - center[ 0 ];
+        float y = pos[ 1 ] - center[ 1 ];
+        float z = pos[ 2 ] - center[ 2 ];
+
+        float x1 = cy * x + sy * z;
+        float z1 = -sy * x + cy * z;
+        float y2 = cp * y + sp * z1;
+        float z2 = -sp * y + cp * z1;
+
+        float * out = view_list + v * 3;
+        out[ 0 ] = RENDER_SIZE * 0.5f + x1 * scale;
+        out[ 1 ] = RENDER_SIZE * 0.5f - y2 * scale;
+        out[ 2 ] = z2;
+    }
+
+    return view_list;
+}
+
+static float min3( float a, float b, float c )
+{
+    return fminf( a, fminf( b, c ) );
+}
+
+static float max3( float a, float b, float c )
+{
+    return fmaxf( a, fmaxf( b, c ) );
+}
+
+/// flat shaded with the diffuse color of each material group. two sided,
+/// not every model winds its triangles the same way.
+static void render_thumbnail( model_data_t * data, unsigned char * out_rgba )
+{
+    wavefront_t * mesh = data->mesh;
+    const int size = RENDER_SIZE;
+
+    float * view_list = view_positions( data );
+    float * color_list = group_colors( data );
+
+    float * depth = new float[ size * size ];
+    float * color = new float[ size * size * 3 ];
+    for ( int i = 0; i < size * size; i++ ) depth[ i ] = -FLT_MAX;
+
+    // from the upper left, towards the viewer
+    float light[ 3 ] = { -0.37f, 0.56f, 0.74f };
+
+    int group = -1;
+    for ( int t = 0; t + 2 < mesh->index_count; t += 3 ) {
+        while ( group + 1 < mesh->material_group_count &&
+                mesh->material_group_offset_list[ group + 1 ] <= t ) {
+            group++;
+        }
+
+        float * a = view_list + mesh->index_list[ t + 0 ] * 3;
+        float * b = view_list + mesh->index_list[ t + 1 ] * 3;
+        float * c = view_list + mesh->index_list[ t + 2 ] * 3;
+
+        float area = ( b[ 0 ] - a[ 0 ] ) * ( c[ 1 ] - a[ 1 ] ) -
+                     ( b[ 1 ] - a[ 1 ] ) * ( c[ 0 ] - a[ 0 ] );
+        if ( fabsf( area ) < 1e-6f ) continue;
+
+        // face normal, y flipped back to point up
+        float e1[ 3 ] = { b[ 0 ] - a[ 0 ], a[ 1 ] - b[ 1 ], b[ 2 ] - a[ 2 ] };
+        float e2[ 3 ] = { c[ 0 ] - a[ 0 ], a[ 1 ] - c[ 1 ], c[ 2 ] - a[ 2 ] };
+        float n[ 3 ] = {
+            e1[ 1 ] * e2[ 2 ] - e1[ 2 ] * e2[ 1 ],
+            e1[ 2 ] * e2[ 0 ] - e1[ 0 ] * e2[ 2 ],
+            e1[ 0 ] * e2[ 1 ] - e1[ 1 ] * e2[ 0 ],
+        };
+        float length =
+            sqrtf( n[ 0 ] * n[ 0 ] + n[ 1 ] * n[ 1 ] + n[ 2 ] * n[ 2 ] );
+        if ( length <= 0.0f ) continue;
+        if ( n[ 2 ] < 0.0f ) length = -length;
+
+        float lambert = ( n[ 0 ] * light[ 0 ] + n[ 1 ] * light[ 1 ] +
+                          n[ 2 ] * light[ 2 ] ) /
+                        length;
+        float shade = 0.35f + 0.65f * ( lambert > 0.0f ? lambert : 0.0f );
+
+        static const float grey[ 3 ] = { 0.75f, 0.75f, 0.75f };
+        const float * kd = group == -1 ? grey : color_list + group * 3;
+
+        float first_x = floorf( min3( a[ 0 ], b[ 0 ], c[ 0 ] ) );
+        float last_x = ceilf( max3( a[ 0 ], b[ 0 ], c[ 0 ] ) );
+        float first_y = floorf( min3( a[ 1 ], b[ 1 ], c[ 1 ] ) );
+        float last_y = ceilf( max3( a[ 1 ], b[ 1 ], c[ 1 ] ) );
+
+        int min_x = (int) fmaxf( first_x, 0.0f );
+        int max_x = (int) fminf( last_x, size - 1.0f );
+        int min_y = (int) fmaxf( first_y, 0.0f );
+        int max_y = (int) fminf( last_y, size - 1.0f );
+
+        for ( int y = min_y; y <= max_y; y++ ) {
+            for ( int x = min_x; x <= max_x; x++ ) {
+                float px = x + 0.5f;
+                float py = y + 0.5f;
+
+                // barycentric weights, the sign of area covers both windings
+                float wa = ( ( c[ 0 ] - b[ 0 ] ) * ( py - b[ 1 ] ) -
+                             ( c[ 1 ] - b[ 1 ] ) * ( px - b[ 0 ] ) ) /
+                           area;
+                float wb = ( ( a[ 0 ] - c[ 0 ] ) * ( py - c[ 1 ] ) -
+                             ( a[ 1 ] - c[ 1 ] ) * ( px - c[ 0 ] ) ) /
+                           area;
+                float wc = 1.0f - wa - wb;
+                if ( wa < 0.0f || wb < 0.0f || wc < 0.0f ) continue;
+
+                float z = wa * a[ 2 ] + wb * b[ 2 ] + wc * c[ 2 ];
+                int p = y * size + x;
+                if ( z <= depth[ p ] ) continue;
+
+                depth[ p ] = z;
+                color[ p * 3 + 0 ] = kd[ 0 ] * shade;
+                color[ p * 3 + 1 ] = kd[ 1 ] * shade;
+                color[ p * 3 + 2 ] = kd[ 2 ] * shade;
+            }
+        }
+    }
+
+    // average each 2x2 block, alpha is the covered part of it
+    for ( int y = 0; y < CATALOG_THUMBNAIL_SIZE; y++ ) {
+        for ( int x = 0; x < CATALOG_THUMBNAIL_SIZE; x++ ) {
+            float sum[ 3 ] = { 0.0f, 0.0f, 0.0f };
+            int covered = 0;
+
+            for ( int i = 0; i < 4; i++ ) {
+                int p = ( y * 2 + i / 2 ) * size + x * 2 + i % 2;
+                if ( depth[ p ] == -FLT_MAX ) continue;
+
+                sum[ 0 ] += color[ p * 3 + 0 ];
+                sum[ 1 ] += color[ p * 3 + 1 ];
+                sum[ 2 ] += color[ p * 3 + 2 ];
+                covered++;
+            }
+
+            unsigned char * out =
+                out_rgba + ( y * CATALOG_THUMBNAIL_SIZE + x ) * 4;
+            for ( int i = 0; i < 3; i++ ) {
+                float v = covered > 0 ? sum[ i ] / covered : 0.0f;
+                out[ i ] = (unsigned char) ( fminf( v, 1.0f ) * 255.0f + 0.5f );
+            }
+            out[ 3 ] = (unsigned char) ( covered * 255 / 4 );
+        }
+    }
+
+    delete[] depth;
+    delete[] color;
+    delete[] color_list;
+    delete[] view_list;
+}
+
+// thumbnail [end] /////////////////////////////////////////////////////////////
+
+// catalog file [begin] ////////////////////////////////////////////////////////
+
+/// layout:
+///   header
+///   entries [ entry_count ], each a record, its name (name_length bytes, not
+///   terminated) and its thumbnail if it has one
+struct header_t {
+    char magic[ 4 ];
+    uint32_t version;
+    uint32_t thumbnail_size;
+    uint32_t entry_count;
+};
+
+struct record_t {
+    int64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+
+    int32_t status;
+    int32_t vertex_count;
+    int32_t triangle_count;
+    int32_t name_length;
+
+    float bounds_min[ 3 ];
+    float bounds_max[ 3 ];
+
+    int32_t has_thumbnail;
+    int32_t padding;
+};
+
+static const char magic[ 4 ] = { 'M', 'W', 'C', 'T' };
+
+static int catalog_path( char * out_path )
+{
+    return res_path( out_path, MAX_PATH_LENGTH, CATALOG_FILE );
+}
+
+static catalog_entry_t * add_entry( const char * filename )
+{
+    // resize
+    if ( intern.entry_count >= intern.entry_cap ) {
+        int new_cap = intern.entry_cap * 2;
+        catalog_entry_t * out = new catalog_entry_t[ new_cap ];
+        memcpy(
+            out,
+            intern.entry_list,
+            sizeof( catalog_entry_t ) * intern.entry_count
+        );
+        delete[] intern.entry_list;
+        intern.entry_list = out;
+        intern.entry_cap = new_cap;
+    }
+
+    int i = intern.entry_count++;
+    catalog_entry_t * entry = intern.entry_list + i;
+
+    memset( entry, 0, sizeof( catalog_entry_t ) );
+    entry->filename = strdup( filename );
+    entry->status = CATALOG_STALE;
+    entry->texture = -1;
+
+    hash_map_set( &intern.name_map, hash_string( filename, HASH_SEED ), i );
+
+    return entry;
+}
+
+static void free_entry( catalog_entry_t * entry )
+{
+    if ( entry->texture != -1 ) free_texture( entry->texture );
+
+    free( entry->filename );
+    delete[] entry->thumbnail;
+}
+
+static int find_entry( const char * filename )
+{
+    hash_t name = hash_string( filename, HASH_SEED );
+    return hash_map_find( &intern.name_map, name );
+}
+
+/// fills the entries from models.catalog, a file of another version or
+/// thumbnail size is ignored and everything gets built again
+static void read_catalog()
+{
+    char path[ MAX_PATH_LENGTH ];
+    if ( catalog_path( path ) ) return;
+
+    res_t res = load_file( path );
+    if ( !res.data ) return;
+
+    const unsigned char * p = res.data;
+    const unsigned char * end = res.data + res.size;
+
+    header_t header;
+    if ( res.size < sizeof( header_t ) ) goto done;
+    memcpy( &header, p, sizeof( header_t ) );
+    p += sizeof( header_t );
+
+    if ( memcmp( header.magic, magic, 4 ) != 0 ) goto done;
+    if ( header.version != CATALOG_VERSION ) goto done;
+    if ( header.thumbnail_size != CATALOG_THUMBNAIL_SIZE ) goto done;
+
+    for ( uint32_t i = 0; i < header.entry_count; i++ ) {
+        record_t record;
+        if ( end - p < (long) sizeof( record_t ) ) break;
+        memcpy( &record, p, sizeof( record_t ) );
+        p += sizeof( record_t );
+
+        long thumbnail_size = record.has_thumbnail ? THUMBNAIL_BYTES : 0;
+        if ( record.name_length <= 0 || record.name_length >= MAX_PATH_LENGTH ||
+             end - p < record.name_length + thumbnail_size ) {
+            break;
+        }
+
+        char name[ MAX_PATH_LENGTH ];
+        memcpy( name, p, record.name_length );
+        name[ record.name_length ] = '\0';
+        p += record.name_length;
+
+        if ( find_entry( name ) != -1 ) {
+            p += thumbnail_size;
+            continue;
+        }
+
+        catalog_entry_t * entry = add_entry( name );
+        entry->stamp.size = record.source_size;
+        entry->stamp.mtime_sec = record.source_mtime_sec;
+        entry->stamp.mtime_nsec = record.source_mtime_nsec;
+        entry->status = record.status;
+        entry->vertex_count = record.vertex_count;
+        entry->triangle_count = record.triangle_count;
+        memcpy( entry->bounds_min, record.bounds_min, sizeof( float ) * 3 );
+        memcpy( entry->bounds_max, record.bounds_max, sizeof( float ) * 3 );
+
+        if ( record.has_thumbnail ) {
+            entry->thumbnail = new unsigned char[ THUMBNAIL_BYTES ];
+            memcpy( entry->thumbnail, p, THUMBNAIL_BYTES );
+            p += THUMBNAIL_BYTES;
+        }
+    }
+
+done:
+    release_res( &res );
+}
+
+static bool is_stamped( catalog_entry_t * entry )
+{
+    return entry->stamp.size != 0 || entry->stamp.mtime_sec != 0 ||
+           entry->stamp.mtime_nsec != 0;
+}
+
+/// writes the finished entries of stamped files, the others would be built
+/// again on the next run anyway
+static void write_catalog()
+{
+    char path[ MAX_PATH_LENGTH ];
+    if ( catalog_path( path ) ) return;
+
+    header_t header;
+    memcpy( header.magic, magic, 4 );
+    header.version = CATALOG_VERSION;
+    header.thumbnail_size = CATALOG_THUMBNAIL_SIZE;
+    header.entry_count = 0;
+
+    for ( int i = 0; i < intern.entry_count; i++ ) {
+        catalog_entry_t * entry = intern.entry_list + i;
+        if ( is_stamped( entry ) && entry->status != CATALOG_STALE ) {
+            header.entry_count++;
+        }
+    }
+    if ( header.entry_count == 0 ) return;
+
+    // write to a temporary and rename, so a crash never leaves a torn file
+    char temp_path[ MAX_PATH_LENGTH + 4 ];
+    snprintf( temp_path, MAX_PATH_LENGTH + 4, "%s.tmp", path );
+
+    FILE * file = fopen( temp_path, "wb" );
+    if ( !file ) {
+        ERROR_LOG( "failed to write catalog: %s", path );
+        return;
+    }
+
+    fwrite( &header, sizeof( header_t ), 1, file );
+
+    for ( int i = 0; i < intern.entry_count; i++ ) {
+        catalog_entry_t * entry = intern.entry_list + i;
+        if ( !is_stamped( entry ) || entry->status == CATALOG_STALE ) continue;
+
+        record_t record;
+        memset( &record, 0, sizeof( record_t ) );
+        record.source_size = entry->stamp.size;
+        record.source_mtime_sec = entry->stamp.mtime_sec;
+        record.source_mtime_nsec = entry->stamp.mtime_nsec;
+        record.status = entry->status;
+        record.vertex_count = entry->vertex_count;
+        record.triangle_count = entry->triangle_count;
+        record.name_length = strlen( entry->filename );
+        memcpy( record.bounds_min, entry->bounds_min, sizeof( float ) * 3 );
+        memcpy( record.bounds_max, entry->bounds_max, sizeof( float ) * 3 );
+        record.has_thumbnail = entry->thumbnail != nullptr;
+
+        fwrite( &record, sizeof( record_t ), 1, file );
+        fwrite( entry->filename, 1, record.name_length, file );
+        if ( entry->thumbnail ) {
+            fwrite( entry->thumbnail, 1, THUMBNAIL_BYTES, file );
+        }
+    }
+
+    int failed = ferror( file );
+    failed |= fclose( file );
+
+    if ( failed || rename( temp_path, path ) ) {
+        ERROR_LOG( "failed to write catalog: %s", path );
+        remove( temp_path );
+    }
+}
+
+// catalog file [end] //////////////////////////////////////////////////////////
+
+// builder [begin] /////////////////////////////////////////////////////////////
+
+/// stamps the file before loading it, a change while it loads shows up as a
+/// stale entry next time
+static void run_job( job_t * job )
+{
+    memset( &job->stamp, 0, sizeof( res_stamp_t ) );
+    stamp_res( &job->stamp, job->filename );
+
+    model_data_t data;
+    load_model_mesh( &data, job->filename, job->optimize );
+
+    wavefront_t * mesh = data.mesh;
+    job->vertex_count = mesh->vertex_count;
+    job->triangle_count = mesh->index_count / 3;
+    memcpy( job->bounds_min, data.bounds_min, sizeof( float ) * 3 );
+    memcpy( job->bounds_max, data.bounds_max, sizeof( float ) * 3 );
+
+    if ( data.errors || mesh->vertex_count == 0 ) {
+        job->status = CATALOG_FAILED;
+        job->thumbnail = nullptr;
+    } else {
+        job->status = CATALOG_READY;
+        job->thumbnail = new unsigned char[ THUMBNAIL_BYTES ];
+        render_thumbnail( &data, job->thumbnail );
+    }
+
+    model_data_free( &data );
+}
+
+static void free_job( job_t * job )
+{
+    free( job->filename );
+    delete[] job->thumbnail;
+    delete job;
+}
+
+#ifndef __EMSCRIPTEN__
+
+static void worker()
+{
+    for ( ;; ) {
+        job_t * job;
+
+        {
+            std::unique_lock< std::mutex > lock( intern.mutex );
+            intern.wake.wait( lock, [] {
+                return intern.quit || intern.pending_first;
+            } );
+
+            if ( intern.quit ) return;
+
+            job = intern.pending_first;
+            intern.pending_first = job->next;
+            if ( !intern.pending_first ) intern.pending_last = nullptr;
+        }
+
+        run_job( job );
+
+        job->next = intern.done.load( std::memory_order_relaxed );
+        while ( !intern.done.compare_exchange_weak(
+            job->next,
+            job,
+            std::memory_order_release,
+            std::memory_order_relaxed
+        ) ) {
+        }
+    }
+}
+
+#endif
+
+static void request( const char * filename, bool optimize )
+{
+    job_t * job = new job_t;
+    memset( job, 0, sizeof( job_t ) );
+    job->filename = strdup( filename );
+    job->optimize = optimize;
+
+    intern.pending_count++;
+
+#ifndef __EMSCRIPTEN__
+    std::lock_guard< std::mutex > lock( intern.mutex );
+#endif
+
+    if ( intern.pending_last ) {
+        intern.pending_last->next = job;
+    } else {
+        intern.pending_first = job;
+    }
+    intern.pending_last = job;
+
+#ifndef __EMSCRIPTEN__
+    intern.wake.notify_one();
+#endif
+}
+
+/// finished builds in completion order
+static job_t * take_done()
+{
+#ifdef __EMSCRIPTEN__
+    // no workers, one build per frame on the calling thread
+    job_t * job = intern.pending_first;
+    if ( !job ) return nullptr;
+
+    intern.pending_first = job->next;
+    if ( !intern.pending_first ) intern.pending_last = nullptr;
+
+    run_job( job );
+    job->next = nullptr;
+
+    return job;
+#else
+    job_t * list = intern.done.exchange( nullptr, std::memory_order_acquire );
+
+    // newest first, reverse into completion order
+    job_t * ready = nullptr;
+    while ( list ) {
+        job_t * next = list->next;
+        list->next = ready;
+        ready = list;
+        list = next;
+    }
+
+    return ready;
+#endif
+}
+
+/// moves the result of a build into its entry, unless the file was dropped
+/// from the list meanwhile
+static void apply_job( job_t * job )
+{
+    intern.pending_count--;
+
+    int i = find_entry( job->filename );
+    if ( i == -1 ) return;
+
+    catalog_entry_t * entry = intern.entry_list + i;
+    entry->building = false;
+    entry->stamp = job->stamp;
+    entry->status = job->status;
+    entry->vertex_count = job->vertex_count;
+    entry->triangle_count = job->triangle_count;
+    memcpy( entry->bounds_min, job->bounds_min, sizeof( float ) * 3 );
+    memcpy( entry->bounds_max, job->bounds_max, sizeof( float ) * 3 );
+
+    delete[] entry->thumbnail;
+    entry->thumbnail = job->thumbnail;
+    job->thumbnail = nullptr;
+
+    if ( entry->texture != -1 ) {
+        free_texture( entry->texture );
+        entry->texture = -1;
+    }
+
+    intern.dirty = true;
+}
+
+/// queues a build unless the entry is up to date with its file. files that
+/// can not be stamped are built once per run.
+static void build_if_stale( catalog_entry_t * entry, bool optimize )
+{
+    if ( entry->building ) return;
+
+    if ( entry->status != CATALOG_STALE ) {
+        res_stamp_t stamp;
+        if ( stamp_res( &stamp, entry->filename ) ) return;
+        if ( memcmp( &stamp, &entry->stamp, sizeof( res_stamp_t ) ) == 0 ) {
+            return;
+        }
+    }
+
+    entry->building = true;
+    request( entry->filename, optimize );
+}
+
+// builder [end] ///////////////////////////////////////////////////////////////
+
+void catalog_init( int thread_count )
+{
+    intern.entry_cap = 64;
+    intern.entry_list = new catalog_entry_t[ intern.entry_cap ];
+    intern.entry_count = 0;
+    hash_map_init( &intern.name_map, intern.entry_cap );
+
+    intern.dirty = false;
+    intern.pending_first = nullptr;
+    intern.pending_last = nullptr;
+    intern.pending_count = 0;
+
+    read_catalog();
+
+#ifndef __EMSCRIPTEN__
+    if ( thread_count <= 0 ) {
+        thread_count = (int) std::thread::hardware_concurrency() / 2;
+    }
+    if ( thread_count < 1 ) thread_count = 1;
+    if ( thread_count > MAX_CATALOG_THREAD_COUNT ) {
+        thread_count = MAX_CATALOG_THREAD_COUNT;
+    }
+
+    intern.quit = false;
+    intern.done = nullptr;
+    intern.thread_count = thread_count;
+
+    for ( int i = 0; i < thread_count; i++ ) {
+        intern.thread_list[ i ] = std::thread( worker );
+    }
+#endif
+}
+
+void catalog_shutdown()
+{
+#ifndef __EMSCRIPTEN__
+    {
+        std::lock_guard< std::mutex > lock( intern.mutex );
+        intern.quit = true;
+    }
+    intern.wake.notify_all();
+
+    for ( int i = 0; i < intern.thread_count; i++ ) {
+        intern.thread_list[ i ].join();
+    }
+    intern.thread_count = 0;
+
+    // builds that finished after the last poll are kept
+    job_t * job = take_done();
+    while ( job ) {
+        job_t * next = job->next;
+        apply_job( job );
+        free_job( job );
+        job = next;
+    }
+#endif
+
+    while ( job_t * pending = intern.pending_first ) {
+        intern.pending_first = pending->next;
+        free_job( pending );
+    }
+    intern.pending_last = nullptr;
+    intern.pending_count = 0;
+
+    if ( intern.dirty ) write_catalog();
+
+    for ( int i = 0; i < intern.entry_count; i++ ) {
+        free_entry( intern.entry_list + i );
+    }
+    delete[] intern.entry_list;
+    hash_map_free( &intern.name_map );
+
+    intern.entry_list = nullptr;
+    intern.entry_count = 0;
+    intern.entry_cap = 0;
+}
+
+void catalog_sync( char ** filename_list, int count, bool optimize )
+{
+    catalog_entry_t * old_list = intern.entry_list;
+    int old_count = intern.entry_count;
+    hash_map_t old_map = intern.name_map;
+
+    intern.entry_cap = count > 64 ? count : 64;
+    intern.entry_list = new catalog_entry_t[ intern.entry_cap ];
+    intern.entry_count = 0;
+    hash_map_init( &intern.name_map, intern.entry_cap );
+
+    for ( int i = 0; i < count; i++ ) {
+        const char * filename = filename_list[ i ];
+        if ( find_entry( filename ) != -1 ) continue;
+
+        hash_t name = hash_string( filename, HASH_SEED );
+        int old = hash_map_find( &old_map, name );
+
+        if ( old == -1 || !old_list[ old ].filename ) {
+            add_entry( filename );
+            continue;
+        }
+
+        // known file, the entry moves over as it is
+        int id = intern.entry_count++;
+        intern.entry_list[ id ] = old_list[ old ];
+        hash_map_set( &intern.name_map, name, id );
+
+        old_list[ old ].filename = nullptr;
+    }
+
+    // files no longer listed
+    for ( int i = 0; i < old_count; i++ ) {
+        if ( !old_list[ i ].filename ) continue;
+
+        free_entry( old_list + i );
+        intern.dirty = true;
+    }
+    delete[] old_list;
+    hash_map_free( &old_map );
+
+    for ( int i = 0; i < intern.entry_count; i++ ) {
+        build_if_stale( intern.entry_list + i, optimize );
+    }
+}
+
+void catalog_update( const char * filename, bool optimize )
+{
+    int i = find_entry( filename );
+    if ( i == -1 ) return;
+
+    build_if_stale( intern.entry_list + i, optimize );
+}
+
+void catalog_poll()
+{
+    intern.upload_count = 0;
+
+    job_t * job = take_done();
+    while ( job ) {
+        job_t * next = job->next;
+        apply_job( job );
+        free_job( job );
+        job = next;
+    }
+
+    if ( intern.dirty && intern.pending_count == 0 ) {
+        write_catalog();
+        intern.dirty = false;
+    }
+}
+
+int catalog_count()
+{
+    return intern.entry_count;
+}
+
+catalog_entry_t * catalog_entry( int i )
+{
+    return intern.entry_list + i;
+}
+
+int catalog_texture( int i )
+{
+    catalog_entry_t * entry = intern.entry_list + i;
+
+    if ( entry->texture != -1 || !entry->thumbnail ) return entry->texture;
+    if ( intern.upload_count >= UPLOADS_PER_FRAME ) return -1;
+
+    intern.upload_count++;
+    entry->texture = load_texture_pixels(
+        entry->thumbnail,
+        CATALOG_THUMBNAIL_SIZE,
+        CATALOG_THUMBNAIL_SIZE
+    );
+
+    return entry->texture;
+}
+
+int catalog_pending()
+{
+    return intern.pending_count;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "res.hpp"
+
+#define CATALOG_THUMBNAIL_SIZE 32 // square, rgba
+
+#define CATALOG_STALE  0 // not built for the current file yet
+#define CATALOG_READY  1 //
+#define CATALOG_FAILED 2 // the file did not load or is empty
+
+/// what the model browser shows of a model file without loading it. kept
+/// in models.catalog next to the resources between runs, an entry is built
+/// again when the stamp of its file changes.
+struct catalog_entry_t {
+    char * filename;
+    res_stamp_t stamp; // of the file the entry was built from, 0 = none
+    int status;        // CATALOG_*
+    bool building;
+
+    int vertex_count;
+    int triangle_count;
+    float bounds_min[ 3 ];
+    float bounds_max[ 3 ];
+
+    unsigned char * thumbnail; // rgba, nullptr until built
+    int texture;               // gl, -1 until catalog_texture uploads it
+};
+
+/// reads models.catalog and starts the workers, thread_count 0 uses half
+/// the cores
+void catalog_init( int thread_count );
+
+/// stops the workers, writes models.catalog if it changed and frees the
+/// entries with their textures
+void catalog_shutdown();
+
+/// makes the entries follow the model file list, in its order. known files
+/// keep their entries, new and changed ones are built in the background and
+/// the entries of files no longer listed are dropped.
+void catalog_sync( char ** filename_list, int count, bool optimize );
+
+/// builds the entry of a listed file again if the file changed
+void catalog_update( const char * filename, bool optimize );
+
+/// takes finished builds into their entries, once per frame on the gl
+/// thread. writes models.catalog once nothing is left to build.
+void catalog_poll();
+
+int catalog_count();
+
+catalog_entry_t * catalog_entry( int i );
+
+/// gl texture of the thumbnail of an entry, -1 while there is none. only a
+/// few are uploaded per frame, so scrolling through thousands of entries
+/// does not stall.
+int catalog_texture( int i );
+
+/// builds queued or running
+int catalog_pending();
@@ -1,40 +1,169 @@
 #include "res.hpp"
+#include "archive.hpp"
 #include "logging.hpp"
 
 #include <stdio.h>
 
-res_t find_res( const char * name )
-{
-    res_t res;
-
-    res.data = nullptr;
-    res.size = 0;
+#if defined( __unix__ ) && !defined( __EMSCRIPTEN__ )
+#define RES_MAP_ENABLED 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define RES_MAP_ENABLED 0
+#endif
 
-    char path[ 1024 ];
+#ifdef _WIN32
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
 
+int res_path( char * out_path, int size, const char * name )
+{
 #ifdef EMSCRIPTEN
-    snprintf( path, 1024, "./%s", name );
+    int len = snprintf( out_path, size, "./%s", name );
 #else
-    snprintf( path, 1024, "../../res/%s", name );
+    int len = snprintf( out_path, size, "../../res/%s", name );
 #endif
 
-    FILE * file = fopen( path, "rb" );
+    if ( len < 0 || len >= size ) {
+        ERROR_LOG( "resource path too long: %s", name );
+        return 1;
+    }
+
+    return 0;
+}
+
+#if RES_MAP_ENABLED
+
+int stamp_res( res_stamp_t * out_stamp, const char * name )
+{
+    char path[ 1024 ];
+    if ( res_path( path, 1024, name ) ) return 1;
+
+    struct stat st;
+    if ( stat( path, &st ) ) return 1;
 
-    if ( !file ) {
-        ERROR_LOG( "failed to find resource: %s", name );
+    out_stamp->size = st.st_size;
+    out_stamp->mtime_sec = st.st_mtim.tv_sec;
+    out_stamp->mtime_nsec = st.st_mtim.tv_nsec;
+
+    return 0;
+}
+
+res_t load_file( const char * path )
+{
+    res_t res{ nullptr, 0, RES_UNOWNED };
+
+    int fd = open( path, O_RDONLY );
+    if ( fd < 0 ) return res;
+
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 ) {
+        ERROR_LOG( "failed to stat file: %s", path );
+        close( fd );
+        return res;
+    }
+
+    size_t size = st.st_size;
+
+    // empty files can not be mapped, callers still expect data
+    if ( size == 0 ) {
+        close( fd );
+        res.data = new unsigned char[ 1 ];
+        res.storage = RES_HEAP;
+        return res;
+    }
+
+    void * map = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+
+    if ( map == MAP_FAILED ) {
+        ERROR_LOG( "failed to map file: %s", path );
         return res;
     }
 
-    fseek( file, 0, SEEK_END );
-    int size = ftell( file );
-    fseek( file, 0, SEEK_SET );
+    madvise( map, size, MADV_SEQUENTIAL );
+    madvise( map, size, MADV_WILLNEED );
 
-    res.data = new unsigned char[ size ];
+    res.data = (unsigned char *) map;
     res.size = size;
+    res.storage = RES_MAPPED;
 
-    fread( res.data, sizeof( unsigned char ), size, file );
+    return res;
+}
+
+#else
+
+int stamp_res( res_stamp_t * out_stamp, const char * name )
+{
+    return 1;
+}
+
+res_t load_file( const char * path )
+{
+    res_t res{ nullptr, 0, RES_UNOWNED };
+
+    FILE * file = fopen( path, "rb" );
+    if ( !file ) return res;
+
+    fseek64( file, 0, SEEK_END );
+    size_t size = ftell64( file );
+    fseek64( file, 0, SEEK_SET );
+
+    res.data = new unsigned char[ size > 0 ? size : 1 ];
+    res.size = size;
+    res.storage = RES_HEAP;
+
+    if ( fread( res.data, sizeof( unsigned char ), size, file ) != size ) {
+        ERROR_LOG( "failed to read file: %s", path );
+        release_res( &res );
+    }
 
     fclose( file );
 
     return res;
 }
+
+#endif
+
+res_t try_res( const char * name )
+{
+    res_t res{ nullptr, 0, RES_UNOWNED };
+
+    if ( archive_find( name, &res ) == 0 ) return res;
+
+    char path[ 1024 ];
+    if ( res_path( path, 1024, name ) ) return res;
+
+    return load_file( path );
+}
+
+res_t find_res( const char * name )
+{
+    res_t res = try_res( name );
+    if ( !res.data ) ERROR_LOG( "failed to find resource: %s", name );
+
+    return res;
+}
+
+void release_res( res_t * res )
+{
+    if ( res->storage == RES_HEAP ) {
+        delete[] res->data;
+    }
+
+#if RES_MAP_ENABLED
+    if ( res->storage == RES_MAPPED ) {
+        munmap( res->data, res->size );
+    }
+#endif
+
+    res->data = nullptr;
+    res->size = 0;
+    res->storage = RES_UNOWNED;
+}
@@ -0,0 +1,154 @@
+#include "file_watch.hpp"
+#include "logging.hpp"
+
+#if defined( __linux__ ) && !defined( __EMSCRIPTEN__ )
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+static struct {
+    bool watching;
+    int fd;
+
+    char ** name_list; // changed since the last read, in order
+    int name_count;
+    int name_cap;
+    int next; // first name not reported yet
+} intern;
+
+int file_watch_init( const char * dir )
+{
+    file_watch_shutdown();
+
+    int fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if ( fd < 0 ) {
+        ERROR_LOG( "failed to start watching files" );
+        return 1;
+    }
+
+    // editors either write in place or write a copy and move it over
+    if ( inotify_add_watch( fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO ) < 0 ) {
+        ERROR_LOG( "failed to watch %s", dir );
+        close( fd );
+        return 1;
+    }
+
+    intern.watching = true;
+    intern.fd = fd;
+
+    intern.name_cap = 16;
+    intern.name_list = new char *[ intern.name_cap ];
+    intern.name_count = 0;
+    intern.next = 0;
+
+    INFO_LOG( "watching %s", dir );
+
+    return 0;
+}
+
+static void clear_names()
+{
+    for ( int i = 0; i < intern.name_count; i++ ) {
+        free( intern.name_list[ i ] );
+    }
+
+    intern.name_count = 0;
+    intern.next = 0;
+}
+
+void file_watch_shutdown()
+{
+    if ( !intern.watching ) return;
+
+    clear_names();
+    delete[] intern.name_list;
+    close( intern.fd );
+
+    intern.watching = false;
+    intern.name_list = nullptr;
+    intern.name_cap = 0;
+}
+
+static void add_name( const char * name )
+{
+    for ( int i = 0; i < intern.name_count; i++ ) {
+        if ( strcmp( intern.name_list[ i ], name ) == 0 ) return;
+    }
+
+    // resize
+    if ( intern.name_count >= intern.name_cap ) {
+        int new_cap = intern.name_cap * 2;
+        char ** out = new char *[ new_cap ];
+        memcpy( out, intern.name_list, sizeof( char * ) * intern.name_count );
+        delete[] intern.name_list;
+        intern.name_list = out;
+        intern.name_cap = new_cap;
+    }
+
+    intern.name_list[ intern.name_count++ ] = strdup( name );
+}
+
+/// drains every pending event into the name list
+static void read_events()
+{
+    alignas( inotify_event ) char buffer[ 4096 ];
+
+    for ( ;; ) {
+        ssize_t size = read( intern.fd, buffer, sizeof( buffer ) );
+        if ( size <= 0 ) {
+            if ( size < 0 && errno != EAGAIN && errno != EINTR ) {
+                ERROR_LOG( "failed to read file events" );
+            }
+            break;
+        }
+
+        for ( char * p = buffer; p < buffer + size; ) {
+            inotify_event * event = (inotify_event *) p;
+            p += sizeof( inotify_event ) + event->len;
+
+            if ( event->mask & IN_Q_OVERFLOW ) {
+                ERROR_LOG( "too many file changes, some were missed" );
+            }
+            if ( event->mask & IN_ISDIR ) continue;
+            if ( event->len == 0 ) continue;
+
+            add_name( event->name );
+        }
+    }
+}
+
+const char * file_watch_poll()
+{
+    if ( !intern.watching ) return nullptr;
+
+    if ( intern.next >= intern.name_count ) {
+        clear_names();
+        read_events();
+    }
+
+    if ( intern.next >= intern.name_count ) return nullptr;
+
+    return intern.name_list[ intern.next++ ];
+}
+
+#else
+
+int file_watch_init( const char * dir )
+{
+    (void) dir;
+    return 1;
+}
+
+void file_watch_shutdown()
+{
+}
+
+const char * file_watch_poll()
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+/// reports files written to or moved into a directory, for reloading
+/// resources while the editor runs. uses inotify on linux, elsewhere
+/// file_watch_init always fails.
+
+/// starts watching the directory, fails if it can not be watched
+int file_watch_init( const char * dir );
+
+void file_watch_shutdown();
+
+/// name of the next changed file in the directory, nullptr once there are
+/// no more. a file written several times since the last poll is reported
+/// once. the name is valid until the next call.
+const char * file_watch_poll();
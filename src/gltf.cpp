@@ -0,0 +1,505 @@
+#include "gltf.hpp"
+#include "logging.hpp"
+#include "utils.hpp"
+
+#include <cgltf.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_NAME_LENGTH 64
+#define MAX_PATH_LENGTH 1024
+
+bool is_gltf( const char * filename )
+{
+    return has_suffix( filename, ".glb" ) || has_suffix( filename, ".gltf" );
+}
+
+static char * copy_name( const char * name, const char * fallback, int i )
+{
+    int size = MAX_NAME_LENGTH + strlen( fallback );
+    char * out = new char[ size ];
+
+    if ( name ) {
+        snprintf( out, size, "%s", name );
+    } else {
+        snprintf( out, size, "%s.%03d", fallback, i );
+    }
+
+    return out;
+}
+
+/// parses and loads the buffers, external ones relative to the resource
+static cgltf_data * open_gltf( res_t res, const char * res_name )
+{
+    cgltf_options options;
+    memset( &options, 0, sizeof( cgltf_options ) );
+
+    cgltf_data * data = nullptr;
+    if ( cgltf_parse( &options, res.data, res.size, &data ) !=
+         cgltf_result_success ) {
+        ERROR_LOG( "failed to parse gltf: %s", res_name );
+        return nullptr;
+    }
+
+    char path[ MAX_PATH_LENGTH ];
+    if ( res_path( path, MAX_PATH_LENGTH, res_name ) ||
+         cgltf_load_buffers( &options, data, path ) != cgltf_result_success ) {
+        ERROR_LOG( "failed to load gltf buffers: %s", res_name );
+        cgltf_free( data );
+        return nullptr;
+    }
+
+    if ( cgltf_validate( data ) != cgltf_result_success ) {
+        ERROR_LOG( "invalid gltf: %s", res_name );
+        cgltf_free( data );
+        return nullptr;
+    }
+
+    return data;
+}
+
+/// materials are shared by name across files, so unnamed ones get the file
+static char * copy_material_name(
+    const char * name,
+    const char * res_name,
+    int i
+)
+{
+    char fallback[ MAX_PATH_LENGTH ];
+    snprintf( fallback, MAX_PATH_LENGTH, "%s#material", res_name );
+    return copy_name( name, fallback, i );
+}
+
+/// whether count elements of stride bytes fit in the buffer view
+static bool fits_view( const cgltf_accessor * accessor, int count )
+{
+    return accessor->offset + count * accessor->stride <=
+           accessor->buffer_view->size;
+}
+
+static bool is_triangles( cgltf_primitive * primitive )
+{
+    if ( primitive->type != cgltf_primitive_type_triangles ) return false;
+
+    const cgltf_accessor * pos =
+        cgltf_find_accessor( primitive, cgltf_attribute_type_position, 0 );
+    return pos && pos->type == cgltf_type_vec3;
+}
+
+/// tightly packed float data of an accessor, nullptr if it has to be
+/// unpacked (other component type, stride, normalized, sparse or short)
+static const float * packed_floats(
+    const cgltf_accessor * accessor,
+    int width,
+    int count
+)
+{
+    if ( !accessor->buffer_view || accessor->is_sparse ) return nullptr;
+    if ( accessor->component_type != cgltf_component_type_r_32f ) {
+        return nullptr;
+    }
+    if ( accessor->stride != sizeof( float ) * width ) return nullptr;
+    if ( !fits_view( accessor, count ) ) return nullptr;
+
+    const uint8_t * view = cgltf_buffer_view_data( accessor->buffer_view );
+    if ( !view ) return nullptr;
+
+    return (const float *) ( view + accessor->offset );
+}
+
+static void read_floats(
+    float * out,
+    const cgltf_accessor * accessor,
+    int width,
+    int count
+)
+{
+    const float * data = packed_floats( accessor, width, count );
+    if ( data ) {
+        memcpy( out, data, sizeof( float ) * width * count );
+    } else {
+        cgltf_accessor_unpack_floats( accessor, out, width * count );
+    }
+}
+
+static void read_indices(
+    unsigned int * out,
+    const cgltf_accessor * accessor,
+    unsigned int base
+)
+{
+    int count = accessor->count;
+
+    const uint8_t * view = accessor->buffer_view
+                               ? cgltf_buffer_view_data( accessor->buffer_view )
+                               : nullptr;
+
+    if ( view && !accessor->is_sparse &&
+         accessor->component_type == cgltf_component_type_r_16u &&
+         accessor->stride == 2 && fits_view( accessor, count ) ) {
+        const uint16_t * data = (const uint16_t *) ( view + accessor->offset );
+        for ( int i = 0; i < count; i++ ) out[ i ] = data[ i ] + base;
+        return;
+    }
+
+    if ( view && !accessor->is_sparse &&
+         accessor->component_type == cgltf_component_type_r_32u &&
+         accessor->stride == 4 && fits_view( accessor, count ) ) {
+        memcpy( out, view + accessor->offset, sizeof( unsigned int ) * count );
+    } else {
+        cgltf_accessor_unpack_indices( accessor, out, 4, count );
+    }
+
+    if ( base ) {
+        for ( int i = 0; i < count; i++ ) out[ i ] += base;
+    }
+}
+
+static void normalize( float * v )
+{
+    float length = sqrtf( v[ 0 ] * v[ 0 ] + v[ 1 ] * v[ 1 ] + v[ 2 ] * v[ 2 ] );
+    if ( length > 0.0f ) {
+        v[ 0 ] /= length;
+        v[ 1 ] /= length;
+        v[ 2 ] /= length;
+    }
+}
+
+/// area weighted vertex normals for primitives that come without any
+static void compute_normals(
+    float * normal_list,
+    float * pos_list,
+    unsigned int * index_list,
+    int index_count,
+    int first_vertex,
+    int vertex_count
+)
+{
+    float * first_normal = normal_list + first_vertex * 3;
+    memset( first_normal, 0, sizeof( float ) * vertex_count * 3 );
+
+    for ( int i = 0; i + 2 < index_count; i += 3 ) {
+        float * a = pos_list + index_list[ i + 0 ] * 3;
+        float * b = pos_list + index_list[ i + 1 ] * 3;
+        float * c = pos_list + index_list[ i + 2 ] * 3;
+
+        float e1[ 3 ] = { b[ 0 ] - a[ 0 ], b[ 1 ] - a[ 1 ], b[ 2 ] - a[ 2 ] };
+        float e2[ 3 ] = { c[ 0 ] - a[ 0 ], c[ 1 ] - a[ 1 ], c[ 2 ] - a[ 2 ] };
+        float n[ 3 ] = {
+            e1[ 1 ] * e2[ 2 ] - e1[ 2 ] * e2[ 1 ],
+            e1[ 2 ] * e2[ 0 ] - e1[ 0 ] * e2[ 2 ],
+            e1[ 0 ] * e2[ 1 ] - e1[ 1 ] * e2[ 0 ],
+        };
+
+        for ( int k = 0; k < 3; k++ ) {
+            float * out = normal_list + index_list[ i + k ] * 3;
+            out[ 0 ] += n[ 0 ];
+            out[ 1 ] += n[ 1 ];
+            out[ 2 ] += n[ 2 ];
+        }
+    }
+
+    for ( int v = first_vertex; v < first_vertex + vertex_count; v++ ) {
+        normalize( normal_list + v * 3 );
+    }
+}
+
+static bool is_identity( float * m )
+{
+    for ( int i = 0; i < 16; i++ ) {
+        if ( m[ i ] != ( i % 5 == 0 ? 1.0f : 0.0f ) ) return false;
+    }
+
+    return true;
+}
+
+/// node transform, normals use the inverse transpose of the upper 3x3
+static void transform_vertices(
+    float * m,
+    float * pos_list,
+    float * normal_list,
+    int first_vertex,
+    int vertex_count
+)
+{
+    // cofactors of the column major 3x3, the inverse transpose up to scale
+    float n[ 9 ] = {
+        m[ 5 ] * m[ 10 ] - m[ 6 ] * m[ 9 ],
+        m[ 6 ] * m[ 8 ] - m[ 4 ] * m[ 10 ],
+        m[ 4 ] * m[ 9 ] - m[ 5 ] * m[ 8 ],
+        m[ 9 ] * m[ 2 ] - m[ 10 ] * m[ 1 ],
+        m[ 10 ] * m[ 0 ] - m[ 8 ] * m[ 2 ],
+        m[ 8 ] * m[ 1 ] - m[ 9 ] * m[ 0 ],
+        m[ 1 ] * m[ 6 ] - m[ 2 ] * m[ 5 ],
+        m[ 2 ] * m[ 4 ] - m[ 0 ] * m[ 6 ],
+        m[ 0 ] * m[ 5 ] - m[ 1 ] * m[ 4 ],
+    };
+
+    for ( int v = first_vertex; v < first_vertex + vertex_count; v++ ) {
+        float * p = pos_list + v * 3;
+        float x = p[ 0 ], y = p[ 1 ], z = p[ 2 ];
+        p[ 0 ] = m[ 0 ] * x + m[ 4 ] * y + m[ 8 ] * z + m[ 12 ];
+        p[ 1 ] = m[ 1 ] * x + m[ 5 ] * y + m[ 9 ] * z + m[ 13 ];
+        p[ 2 ] = m[ 2 ] * x + m[ 6 ] * y + m[ 10 ] * z + m[ 14 ];
+
+        float * q = normal_list + v * 3;
+        x = q[ 0 ], y = q[ 1 ], z = q[ 2 ];
+        q[ 0 ] = n[ 0 ] * x + n[ 3 ] * y + n[ 6 ] * z;
+        q[ 1 ] = n[ 1 ] * x + n[ 4 ] * y + n[ 7 ] * z;
+        q[ 2 ] = n[ 2 ] * x + n[ 5 ] * y + n[ 8 ] * z;
+
+        normalize( q );
+    }
+}
+
+int load_gltf( wavefront_t * out, res_t res, const char * res_name )
+{
+    memset( out, 0, sizeof( wavefront_t ) );
+
+    cgltf_data * data = open_gltf( res, res_name );
+    if ( !data ) return 1;
+
+    // count pass, a node is an instance of its mesh
+    int obj_count = 0;
+    int group_count = 0;
+    int vertex_count = 0;
+    int index_count = 0;
+
+    for ( cgltf_size n = 0; n < data->nodes_count; n++ ) {
+        cgltf_mesh * mesh = data->nodes[ n ].mesh;
+        if ( !mesh ) continue;
+
+        obj_count++;
+
+        for ( cgltf_size p = 0; p < mesh->primitives_count; p++ ) {
+            cgltf_primitive * primitive = mesh->primitives + p;
+            if ( !is_triangles( primitive ) ) continue;
+
+            const cgltf_accessor * pos = cgltf_find_accessor(
+                primitive,
+                cgltf_attribute_type_position,
+                0
+            );
+
+            group_count++;
+            vertex_count += pos->count;
+            index_count += primitive->indices ? primitive->indices->count
+                                              : pos->count;
+        }
+    }
+
+    out->pos_list = new float[ vertex_count * 3 ];
+    out->normal_list = new float[ vertex_count * 3 ];
+    out->uv_list = new float[ vertex_count * 2 ];
+    out->index_list = new unsigned int[ index_count ];
+
+    using c_string_t = const char *;
+    out->obj_offset_list = new int[ obj_count ];
+    out->obj_name_list = new c_string_t[ obj_count ];
+    out->material_group_offset_list = new int[ group_count ];
+    out->material_group_material_list = new c_string_t[ group_count ];
+
+    char * lib_name = new char[ strlen( res_name ) + 1 ];
+    strcpy( lib_name, res_name );
+    out->material_lib_filename = lib_name;
+
+    // fill pass
+    for ( cgltf_size n = 0; n < data->nodes_count; n++ ) {
+        cgltf_node * node = data->nodes + n;
+        cgltf_mesh * mesh = node->mesh;
+        if ( !mesh ) continue;
+
+        out->obj_offset_list[ out->obj_count ] = out->index_count;
+        out->obj_name_list[ out->obj_count ] =
+            copy_name( node->name ? node->name : mesh->name, "node", n );
+        out->obj_count++;
+
+        float m[ 16 ];
+        cgltf_node_transform_world( node, m );
+
+        int node_first_vertex = out->vertex_count;
+
+        for ( cgltf_size p = 0; p < mesh->primitives_count; p++ ) {
+            cgltf_primitive * primitive = mesh->primitives + p;
+            if ( !is_triangles( primitive ) ) {
+                ERROR_LOG( "skipping non triangle primitive: %s", res_name );
+                continue;
+            }
+
+            const cgltf_accessor * pos = cgltf_find_accessor(
+                primitive,
+                cgltf_attribute_type_position,
+                0
+            );
+            const cgltf_accessor * normal = cgltf_find_accessor(
+                primitive,
+                cgltf_attribute_type_normal,
+                0
+            );
+            const cgltf_accessor * uv = cgltf_find_accessor(
+                primitive,
+                cgltf_attribute_type_texcoord,
+                0
+            );
+
+            int first_vertex = out->vertex_count;
+            int count = pos->count;
+
+            cgltf_material * material = primitive->material;
+            int g = out->material_group_count++;
+            out->material_group_offset_list[ g ] = out->index_count;
+            out->material_group_material_list[ g ] = copy_material_name(
+                material ? material->name : "",
+                res_name,
+                material ? cgltf_material_index( data, material ) : 0
+            );
+
+            read_floats( out->pos_list + first_vertex * 3, pos, 3, count );
+
+            unsigned int * index_list = out->index_list + out->index_count;
+            int index_count = count;
+            if ( primitive->indices ) {
+                read_indices( index_list, primitive->indices, first_vertex );
+                index_count = primitive->indices->count;
+            } else {
+                for ( int i = 0; i < count; i++ ) {
+                    index_list[ i ] = first_vertex + i;
+                }
+            }
+            out->index_count += index_count;
+
+            if ( normal && normal->type == cgltf_type_vec3 &&
+                 normal->count == pos->count ) {
+                read_floats(
+                    out->normal_list + first_vertex * 3,
+                    normal,
+                    3,
+                    count
+                );
+            } else {
+                compute_normals(
+                    out->normal_list,
+                    out->pos_list,
+                    index_list,
+                    index_count,
+                    first_vertex,
+                    count
+                );
+            }
+
+            float * out_uv = out->uv_list + first_vertex * 2;
+            if ( uv && uv->type == cgltf_type_vec2 &&
+                 uv->count == pos->count ) {
+                read_floats( out_uv, uv, 2, count );
+
+                // gltf puts v = 0 at the top of the image, wavefront at the
+                // bottom
+                for ( int i = 0; i < count; i++ ) {
+                    out_uv[ i * 2 + 1 ] = 1.0f - out_uv[ i * 2 + 1 ];
+                }
+            } else {
+                memset( out_uv, 0, sizeof( float ) * count * 2 );
+            }
+
+            out->vertex_count += count;
+        }
+
+        if ( !is_identity( m ) ) {
+            transform_vertices(
+                m,
+                out->pos_list,
+                out->normal_list,
+                node_first_vertex,
+                out->vertex_count - node_first_vertex
+            );
+        }
+    }
+
+    INFO_LOG(
+        "gltf %s: %d vertices, %d indices, %d nodes, %d primitives",
+        res_name,
+        out->vertex_count,
+        out->index_count,
+        out->obj_count,
+        out->material_group_count
+    );
+
+    cgltf_free( data );
+
+    return 0;
+}
+
+int load_gltf_materials(
+    material_lib_t * out,
+    res_t res,
+    const char * res_name
+)
+{
+    memset( out, 0, sizeof( material_lib_t ) );
+
+    cgltf_data * data = open_gltf( res, res_name );
+    if ( !data ) return 1;
+
+    int count = data->materials_count;
+
+    using c_string_t = const char *;
+    out->material_name_list = new c_string_t[ count ];
+    out->material_list = new material_t[ count ];
+    out->material_count = count;
+
+    memset( out->material_list, 0, sizeof( material_t ) * count );
+
+    for ( int i = 0; i < count; i++ ) {
+        cgltf_material * material = data->materials + i;
+        material_t * mat = out->material_list + i;
+
+        out->material_name_list[ i ] =
+            copy_material_name( material->name, res_name, i );
+
+        cgltf_pbr_metallic_roughness & pbr = material->pbr_metallic_roughness;
+
+        float * base_color = pbr.base_color_factor;
+        mat->kd[ 0 ] = base_color[ 0 ];
+        mat->kd[ 1 ] = base_color[ 1 ];
+        mat->kd[ 2 ] = base_color[ 2 ];
+        mat->d = base_color[ 3 ];
+
+        float strength = material->has_emissive_strength
+                             ? material->emissive_strength.emissive_strength
+                             : 1.0f;
+        mat->ke[ 0 ] = material->emissive_factor[ 0 ] * strength;
+        mat->ke[ 1 ] = material->emissive_factor[ 1 ] * strength;
+        mat->ke[ 2 ] = material->emissive_factor[ 2 ] * strength;
+
+        cgltf_texture * texture = pbr.base_color_texture.texture;
+        cgltf_image * image = texture ? texture->image : nullptr;
+        if ( !image ) continue;
+
+        if ( image->buffer_view ) {
+            const uint8_t * view = cgltf_buffer_view_data( image->buffer_view );
+            int size = image->buffer_view->size;
+
+            if ( view ) {
+                mat->map_kd_data = new unsigned char[ size ];
+                mat->map_kd_size = size;
+                memcpy( mat->map_kd_data, view, size );
+            }
+        } else if ( image->uri && strncmp( image->uri, "data:", 5 ) != 0 ) {
+            char * filename = new char[ strlen( image->uri ) + 1 ];
+            strcpy( filename, image->uri );
+            cgltf_decode_uri( filename );
+            mat->map_kd = filename;
+        } else {
+            ERROR_LOG(
+                "unsupported gltf image: %s",
+                out->material_name_list[ i ]
+            );
+        }
+    }
+
+    cgltf_free( data );
+
+    return 0;
+}
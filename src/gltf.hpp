@@ -0,0 +1,21 @@
+#pragma once
+
+#include "wavefront.hpp"
+
+/// loads the triangle primitives of every mesh node of a .glb (or a .gltf
+/// with its buffers next to it) into the same layout load_wavefront gives.
+/// nodes become objects and primitives become material groups named after
+/// their material. the material lib of the mesh is the file itself.
+/// @threadsafe
+int load_gltf( wavefront_t * out_mesh, res_t res, const char * res_name );
+
+/// materials of a gltf file, embedded base color images are copied out
+/// @threadsafe
+int load_gltf_materials(
+    material_lib_t * out_lib,
+    res_t res,
+    const char * res_name
+);
+
+/// ".glb" or ".gltf"
+bool is_gltf( const char * filename );
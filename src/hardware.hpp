@@ -41,3 +41,6 @@ float hardware_touch_x();
 float hardware_touch_y();
 
 int hardware_touch_is_down();
+
+/// address of a gl function, nullptr when the context doesnt have it
+void * hardware_gl_proc( const char * name );
@@ -1,8 +1,16 @@
+#include "archive.hpp"
+#include "catalog.hpp"
+#include "file_watch.hpp"
+#include "gltf.hpp"
 #include "hardware.hpp"
 #include "logging.hpp"
+#include "model_loader.hpp"
 #include "render.hpp"
 #include "render_utils.hpp"
 #include "state.hpp"
+#include "texture_file.hpp"
+#include "texture_loader.hpp"
+#include "utils.hpp"
 
 #include <cJSON.h>
 #include <cglm/affine.h>
@@ -11,30 +19,80 @@
 #include <cglm/ray.h>
 #include <imgui.h>
 
-#include <cgltf.h>
-
 #include <stdio.h>
+#include <stdlib.h>
+
+static bool is_model_file( const char * filename )
+{
+    return has_suffix( filename, ".obj" ) || is_gltf( filename );
+}
+
+static void add_avail_model_file( const char * filename )
+{
+    // resize
+    if ( state.avail_model_file_count >= state.avail_model_file_cap ) {
+        int new_cap = state.avail_model_file_cap * 2;
+        array_resize(
+            state.avail_model_file_list,
+            state.avail_model_file_count,
+            new_cap
+        );
+        state.avail_model_file_cap = new_cap;
+    }
+
+    state.avail_model_file_list[ state.avail_model_file_count++ ] =
+        strdup( filename );
+}
+
+static bool has_avail_model_file( const char * filename )
+{
+    for ( int i = 0; i < state.avail_model_file_count; i++ ) {
+        if ( strcmp( filename, state.avail_model_file_list[ i ] ) == 0 ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/// models packed in the resource archive that are not loose files as well
+static void add_archive_model_files()
+{
+    for ( int i = 0; i < archive_entry_count(); i++ ) {
+        const char * name = archive_entry_name( i );
+        if ( !is_model_file( name ) ) continue;
+
+        if ( !has_avail_model_file( name ) ) add_avail_model_file( name );
+    }
+}
+
+static void clear_avail_model_files()
+{
+    for ( int i = 0; i < state.avail_model_file_count; i++ ) {
+        free( state.avail_model_file_list[ i ] );
+    }
+
+    state.avail_model_file_count = 0;
+}
 
 #ifdef __unix__
 
 #include <dirent.h>
 #include <sys/types.h>
 
-static void setup_resource_list()
+static void scan_model_files()
 {
-    state.avail_model_file_count = 0;
+    char res_dir[ 1024 ];
+    if ( res_path( res_dir, 1024, "" ) ) return;
 
     dirent * p;
-    DIR * d = opendir( "../res/" );
+    DIR * d = opendir( res_dir );
     if ( d ) {
         while ( ( p = readdir( d ) ) ) {
             if ( p->d_type == DT_DIR ) continue;
-            if ( strstr( p->d_name, ".obj" ) == nullptr ) continue;
-            if ( state.avail_model_file_count >= 32 ) break;
-            INFO_LOG( "file: %s", p->d_name );
+            if ( !is_model_file( p->d_name ) ) continue;
 
-            state.avail_model_file_list[ state.avail_model_file_count++ ] =
-                strdup( p->d_name );
+            add_avail_model_file( p->d_name );
         }
 
         closedir( d );
@@ -44,7 +102,7 @@ static void setup_resource_list()
 
 #include "windows.h"
 
-static void setup_resource_list()
+static void scan_model_files()
 {
     WIN32_FIND_DATA fdFile;
     HANDLE hFind = NULL;
@@ -61,11 +119,10 @@ static void setup_resource_list()
     do {
         if ( strcmp( fdFile.cFileName, "." ) == 0 ) continue;
         if ( strcmp( fdFile.cFileName, ".." ) == 0 ) continue;
-        if ( strstr( fdFile.cFileName, ".obj" ) == nullptr ) continue;
+        if ( !is_model_file( fdFile.cFileName ) ) continue;
         if ( fdFile.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) continue;
 
-        state.avail_model_file_list[ state.avail_model_file_count++ ] =
-            strdup( fdFile.cFileName );
+        add_avail_model_file( fdFile.cFileName );
 
     } while ( FindNextFile( hFind, &fdFile ) ); // Find the next file.
 
@@ -73,6 +130,22 @@ static void setup_resource_list()
 }
 #endif
 
+/// lists the model files and brings the catalogue in line with them
+static void setup_resource_list()
+{
+    clear_avail_model_files();
+    scan_model_files();
+    add_archive_model_files();
+
+    INFO_LOG( "%d model files", state.avail_model_file_count );
+
+    catalog_sync(
+        state.avail_model_file_list,
+        state.avail_model_file_count,
+        state.enable_mesh_optimization
+    );
+}
+
 static float intersect_entity( int e, vec3 origin, vec3 direction )
 {
     // bool glm_ray_triangle(vec3 origin, vec3 direction, vec3 v0, vec3 v1, vec3
@@ -80,16 +153,13 @@ static float intersect_entity( int e, vec3 origin, vec3 direction )
 
     int model_id = rstate.entity_model_list[ e ];
 
-    int model_offset = rstate.model_offset_list[ model_id ];
-    int model_size = rstate.model_size_list[ model_id ]; // vertex count
-
-    float * pos_list = rstate.vertex_pos_list + ( model_offset * 3 );
+    int index_count = rstate.model_index_count_list[ model_id ];
 
     mat4 & t = rstate.entity_transform_list[ e ].m;
 
     float closest_distance = FLT_MAX;
 
-    for ( int i = 0; i < model_size / 3; i++ ) {
+    for ( int i = 0; i < index_count / 3; i++ ) {
         vec4 v0;
         vec4 v1;
         vec4 v2;
@@ -100,9 +170,9 @@ static float intersect_entity( int e, vec3 origin, vec3 direction )
 
         float distance = 0.0f;
 
-        glm_vec3_copy( pos_list + 3 * ( i * 3 + 0 ), v0 );
-        glm_vec3_copy( pos_list + 3 * ( i * 3 + 1 ), v1 );
-        glm_vec3_copy( pos_list + 3 * ( i * 3 + 2 ), v2 );
+        model_vertex_pos( model_id, i * 3 + 0, v0 );
+        model_vertex_pos( model_id, i * 3 + 1, v1 );
+        model_vertex_pos( model_id, i * 3 + 2, v2 );
 
         glm_mat4_mulv( t, v0, v0 );
         glm_mat4_mulv( t, v1, v1 );
@@ -148,120 +218,955 @@ static void pick_entity()
 
     vec4 vp{ 0.0f, 0.0f, (float) hardware_width(), (float) hardware_height() };
 
-    glm_unproject( point, rstate.combined, vp, point );
+    glm_unproject( point, rstate.combined, vp, point );
+
+    glm_vec3_copy( rstate.camera.pos, origin );
+    glm_vec3_sub( point, origin, direction );
+
+    int e = intersect_scene( origin, direction );
+
+    if ( e != -1 ) {
+        rstate.hi_entity = e;
+        state.current_entity = e;
+    } else {
+        state.current_entity = -1;
+        rstate.hi_entity = -1;
+    }
+}
+
+static int index_of( int * list, int count, int value )
+{
+    for ( int i = 0; i < count; i++ ) {
+        if ( list[ i ] == value ) return i;
+    }
+
+    return -1;
+}
+
+// registry [begin] ////////////////////////////////////////////////////////////
+
+static void setup_registry()
+{
+    using string_t = char *;
+
+    int model_cap = rstate.model_cap;
+    state.model_file_list = new string_t[ model_cap ];
+    state.model_texture_file_list = new string_t[ model_cap ];
+    state.model_ref_count_list = new int[ model_cap ];
+    state.model_hash_list = new hash_t[ model_cap ];
+    state.model_free_list = new int[ model_cap ];
+    state.model_free_count = 0;
+
+    int material_cap = rstate.material_cap;
+    state.material_name_list = new string_t[ material_cap ];
+    state.material_ref_count_list = new int[ material_cap ];
+    state.material_free_list = new int[ material_cap ];
+    state.material_free_count = 0;
+
+    state.texture_file_list = new string_t[ 16 ];
+    state.texture_file_texture_list = new int[ 16 ];
+    state.texture_file_count = 0;
+    state.texture_file_cap = 16;
+
+    hash_map_init( &state.model_name_map, model_cap );
+    hash_map_init( &state.model_content_map, model_cap );
+    hash_map_init( &state.material_name_map, material_cap );
+
+    range_list_init( &state.vertex_range_list );
+    range_list_init( &state.index_range_list );
+    range_list_init( &state.submesh_range_list );
+    range_list_init( &state.cluster_range_list );
+}
+
+/// gives the ends of the tables back that unloading has freed
+static void trim_tables()
+{
+    rstate.vertex_count =
+        range_list_trim( &state.vertex_range_list, rstate.vertex_count );
+    rstate.index_size =
+        range_list_trim( &state.index_range_list, rstate.index_size );
+    rstate.submesh_count =
+        range_list_trim( &state.submesh_range_list, rstate.submesh_count );
+    rstate.cluster_count =
+        range_list_trim( &state.cluster_range_list, rstate.cluster_count );
+}
+
+/// copies the vertices into a free range of the vertex table or appends
+/// them, returns the first vertex. color_list is nullptr unless baked.
+static int add_vertices( wavefront_t * mesh, unsigned int * color_list )
+{
+    int vertex_count = mesh->vertex_count;
+    int offset = range_list_take( &state.vertex_range_list, vertex_count, 1 );
+
+    if ( offset == -1 ) {
+        offset = rstate.vertex_count;
+
+        // resize
+        while ( offset + vertex_count > rstate.vertex_cap ) {
+            int n = rstate.vertex_count;
+            int new_cap = rstate.vertex_cap * 2;
+
+            array_resize( rstate.vertex_pos_list, n * 3, new_cap * 3 );
+            array_resize( rstate.vertex_normal_list, n * 3, new_cap * 3 );
+            array_resize( rstate.vertex_uv_list, n * 2, new_cap * 2 );
+            array_resize( rstate.vertex_color_list, n, new_cap );
+
+            rstate.vertex_cap = new_cap;
+        }
+
+        rstate.vertex_count += vertex_count;
+    }
+
+    memcpy(
+        rstate.vertex_pos_list + ( offset * 3 ),
+        mesh->pos_list,
+        sizeof( float ) * vertex_count * 3
+    );
+    memcpy(
+        rstate.vertex_normal_list + ( offset * 3 ),
+        mesh->normal_list,
+        sizeof( float ) * vertex_count * 3
+    );
+    memcpy(
+        rstate.vertex_uv_list + ( offset * 2 ),
+        mesh->uv_list,
+        sizeof( float ) * vertex_count * 2
+    );
+
+    unsigned int * colors = rstate.vertex_color_list + offset;
+    if ( color_list ) {
+        memcpy( colors, color_list, sizeof( unsigned int ) * vertex_count );
+    } else {
+        memset( colors, 0xff, sizeof( unsigned int ) * vertex_count );
+    }
+
+    return offset;
+}
+
+/// copies the indices into a free range of the index table or appends them,
+/// returns the byte offset
+static int add_indices(
+    unsigned int * index_list,
+    int index_count,
+    int base,
+    int index_size
+)
+{
+    int size = index_count * index_size;
+    int index_offset =
+        range_list_take( &state.index_range_list, size, index_size );
+
+    if ( index_offset == -1 ) {
+        index_offset =
+            ( rstate.index_size + index_size - 1 ) & ~( index_size - 1 );
+
+        // the alignment gap still fits 16 bit indices
+        range_list_give(
+            &state.index_range_list,
+            rstate.index_size,
+            index_offset - rstate.index_size
+        );
+
+        // resize
+        while ( index_offset + size > rstate.index_cap ) {
+            int new_cap = rstate.index_cap * 2;
+            array_resize( rstate.index_data, rstate.index_size, new_cap );
+            rstate.index_cap = new_cap;
+        }
+
+        rstate.index_size = index_offset + size;
+    }
+
+    char * out_index = rstate.index_data + index_offset;
+
+    for ( int i = 0; i < index_count; i++ ) {
+        unsigned int index = index_list[ i ] + base;
+        if ( index_size == 2 ) {
+            ( (unsigned short *) out_index )[ i ] = (unsigned short) index;
+        } else {
+            ( (unsigned int *) out_index )[ i ] = index;
+        }
+    }
+
+    return index_offset;
+}
+
+static bool is_older( res_stamp_t * a, res_stamp_t * b )
+{
+    if ( a->mtime_sec != b->mtime_sec ) return a->mtime_sec < b->mtime_sec;
+    return a->mtime_nsec < b->mtime_nsec;
+}
+
+/// the texture file of an image if the gpu takes its format and it is not
+/// older than the image, which was edited since it was encoded then. the
+/// image otherwise.
+static res_t find_texture_res( const char * name )
+{
+    char variant[ 256 ];
+    if ( texture_loader_variant_name( variant, 256, name ) == 0 ) {
+        res_stamp_t image_stamp;
+        res_stamp_t variant_stamp;
+        bool stale = stamp_res( &image_stamp, name ) == 0 &&
+                     stamp_res( &variant_stamp, variant ) == 0 &&
+                     is_older( &variant_stamp, &image_stamp );
+
+        if ( !stale ) {
+            res_t res = try_res( variant );
+            if ( res.data ) return res;
+        }
+    }
+
+    return find_res( name );
+}
+
+/// loads a texture resource and remembers its file so it can be reloaded,
+/// -1 if there is no such resource
+static int load_texture_file( const char * name )
+{
+    res_t res = find_texture_res( name );
+    if ( !res.data ) return -1;
+
+    int texture = texture_loader_request( res );
+
+    // resize
+    if ( state.texture_file_count >= state.texture_file_cap ) {
+        int n = state.texture_file_count;
+        int new_cap = state.texture_file_cap * 2;
+
+        array_resize( state.texture_file_list, n, new_cap );
+        array_resize( state.texture_file_texture_list, n, new_cap );
+
+        state.texture_file_cap = new_cap;
+    }
+
+    int i = state.texture_file_count++;
+    state.texture_file_list[ i ] = strdup( name );
+    state.texture_file_texture_list[ i ] = texture;
+
+    return texture;
+}
+
+/// drops the file of a texture that is about to be freed, if it has one
+static void forget_texture_file( int texture )
+{
+    int i = index_of(
+        state.texture_file_texture_list,
+        state.texture_file_count,
+        texture
+    );
+    if ( i == -1 ) return;
+
+    free( state.texture_file_list[ i ] );
+
+    int last = state.texture_file_count - 1;
+    state.texture_file_list[ i ] = state.texture_file_list[ last ];
+    state.texture_file_texture_list[ i ] =
+        state.texture_file_texture_list[ last ];
+    state.texture_file_count--;
+}
+
+static void grow_material_tables()
+{
+    int n = rstate.material_count;
+    int new_cap = rstate.material_cap * 2;
+
+    array_resize( rstate.material_texture_list, n, new_cap );
+    array_resize( rstate.material_color_list, n, new_cap );
+    array_resize( rstate.material_emission_list, n, new_cap );
+    array_resize( state.material_name_list, n, new_cap );
+    array_resize( state.material_ref_count_list, n, new_cap );
+    array_resize(
+        state.material_free_list,
+        state.material_free_count,
+        new_cap
+    );
+
+    rstate.material_cap = new_cap;
+}
+
+static int add_material( material_t * material, const char * name )
+{
+    int id;
+    if ( state.material_free_count > 0 ) {
+        id = state.material_free_list[ --state.material_free_count ];
+    } else {
+        if ( rstate.material_count >= rstate.material_cap ) {
+            grow_material_tables();
+        }
+        id = rstate.material_count++;
+    }
+
+    state.material_name_list[ id ] = strdup( name );
+    state.material_ref_count_list[ id ] = 0;
+    hash_t name_hash = hash_string( name, HASH_SEED );
+    hash_map_set( &state.material_name_map, name_hash, id );
+
+    rstate.material_texture_list[ id ] = -1;
+    if ( material->map_kd_data ) {
+        res_t res;
+        res.data = material->map_kd_data;
+        res.size = material->map_kd_size;
+        res.storage = RES_UNOWNED;
+        rstate.material_texture_list[ id ] = texture_loader_request( res );
+    } else if ( material->map_kd ) {
+        rstate.material_texture_list[ id ] =
+            load_texture_file( material->map_kd );
+    }
+
+    // a texture map carries the color, kd is only used without one
+    float * color = rstate.material_color_list[ id ];
+    if ( rstate.material_texture_list[ id ] == -1 ) {
+        glm_vec3_copy( material->kd, color );
+    } else {
+        glm_vec3_one( color );
+    }
+    color[ 3 ] = 1.0f;
+
+    glm_vec3_copy( material->ke, rstate.material_emission_list[ id ] );
+
+    return id;
+}
+
+/// frees the texture of the material and its slot
+static void free_material( int id )
+{
+    if ( rstate.material_texture_list[ id ] != -1 ) {
+        texture_loader_cancel( rstate.material_texture_list[ id ] );
+        forget_texture_file( rstate.material_texture_list[ id ] );
+        free_texture( rstate.material_texture_list[ id ] );
+        rstate.material_texture_list[ id ] = -1;
+    }
+
+    hash_map_remove(
+        &state.material_name_map,
+        hash_string( state.material_name_list[ id ], HASH_SEED )
+    );
+
+    free( state.material_name_list[ id ] );
+    state.material_name_list[ id ] = nullptr;
+
+    state.material_free_list[ state.material_free_count++ ] = id;
+}
+
+static void release_material( int id )
+{
+    if ( id == -1 ) return;
+
+    if ( --state.material_ref_count_list[ id ] == 0 ) free_material( id );
+}
+
+/// material id of every material group, materials are shared by name across
+/// all models. groups whose material can not be found get -1.
+static void add_materials( model_data_t * data, int * out_material_list )
+{
+    wavefront_t * mesh = data->mesh;
+    material_lib_t & lib = data->material_lib;
+
+    for ( int i = 0; i < mesh->material_group_count; i++ ) {
+        const char * name = mesh->material_group_material_list[ i ];
+
+        out_material_list[ i ] = hash_map_find(
+            &state.material_name_map,
+            hash_string( name, HASH_SEED )
+        );
+
+        if ( out_material_list[ i ] != -1 || !data->has_material_lib ) {
+            continue;
+        }
+
+        for ( int m = 0; m < lib.material_count; m++ ) {
+            if ( strcmp( name, lib.material_name_list[ m ] ) != 0 ) continue;
+
+            out_material_list[ i ] =
+                add_material( lib.material_list + m, name );
+            break;
+        }
+    }
+}
+
+/// submeshes with their index ranges in every level and their bounds, each
+/// one holds a reference to its material
+static void add_submeshes(
+    int id,
+    model_data_t * data,
+    int * lod_offset_list,
+    int * group_material_list
+)
+{
+    wavefront_t * mesh = data->mesh;
+    int index_size = rstate.model_index_size_list[ id ];
+    int count = data->submesh_count;
+
+    int first_submesh =
+        range_list_take( &state.submesh_range_list, count, 1 );
+
+    if ( first_submesh == -1 ) {
+        first_submesh = rstate.submesh_count;
+
+        // resize
+        while ( first_submesh + count > rstate.submesh_cap ) {
+            int n = rstate.submesh_count;
+            int new_cap = rstate.submesh_cap * 2;
+            int lod_count = n * MEOWGL_MAX_LOD_COUNT;
+            int lod_cap = new_cap * MEOWGL_MAX_LOD_COUNT;
+
+            array_resize(
+                rstate.submesh_index_offset_list,
+                lod_count,
+                lod_cap
+            );
+            array_resize(
+                rstate.submesh_index_count_list,
+                lod_count,
+                lod_cap
+            );
+            array_resize( rstate.submesh_bounds_min_list, n, new_cap );
+            array_resize( rstate.submesh_bounds_max_list, n, new_cap );
+            array_resize( rstate.submesh_material_list, n, new_cap );
+            array_resize( rstate.submesh_first_cluster_list, n, new_cap );
+            array_resize( rstate.submesh_cluster_count_list, n, new_cap );
+
+            rstate.submesh_cap = new_cap;
+        }
+
+        rstate.submesh_count += count;
+    }
+
+    rstate.model_submesh_offset_list[ id ] = first_submesh;
+    rstate.model_submesh_count_list[ id ] = count;
+
+    for ( int i = 0; i < count; i++ ) {
+        int s = first_submesh + i;
+
+        for ( int lod = 0; lod < data->lod_count; lod++ ) {
+            int lod_id = s * MEOWGL_MAX_LOD_COUNT + lod;
+            int first = data->lod_submesh_first_list[ lod ][ i ];
+
+            rstate.submesh_index_offset_list[ lod_id ] =
+                lod_offset_list[ lod ] + first * index_size;
+            rstate.submesh_index_count_list[ lod_id ] =
+                model_data_submesh_count( data, lod, i );
+        }
+
+        int group = data->submesh_group_list[ i ];
+        int material = group == -1 ? -1 : group_material_list[ group ];
+        rstate.submesh_material_list[ s ] = material;
+        if ( material != -1 ) state.material_ref_count_list[ material ]++;
+
+        rstate.submesh_first_cluster_list[ s ] =
+            rstate.model_cluster_offset_list[ id ] +
+            data->submesh_first_meshlet_list[ i ];
+        rstate.submesh_cluster_count_list[ s ] =
+            data->submesh_meshlet_count_list[ i ];
+
+        int first = data->submesh_offset_list[ i ];
+        int last = first + model_data_submesh_count( data, 0, i );
+
+        float * min = rstate.submesh_bounds_min_list[ s ];
+        float * max = rstate.submesh_bounds_max_list[ s ];
+        glm_vec3_fill( min, FLT_MAX );
+        glm_vec3_fill( max, -FLT_MAX );
+        for ( int j = first; j < last; j++ ) {
+            float * pos = mesh->pos_list + mesh->index_list[ j ] * 3;
+            glm_vec3_minv( min, pos, min );
+            glm_vec3_maxv( max, pos, max );
+        }
+        if ( last == first ) {
+            glm_vec3_zero( min );
+            glm_vec3_zero( max );
+        }
+    }
+}
+
+static void add_clusters( int id, model_data_t * data )
+{
+    int count = data->meshlet_count;
+    int first = range_list_take( &state.cluster_range_list, count, 1 );
+
+    if ( first == -1 ) {
+        first = rstate.cluster_count;
+
+        // resize
+        if ( first + count > rstate.cluster_cap ) {
+            int n = rstate.cluster_count;
+            int new_cap = rstate.cluster_cap;
+            while ( n + count > new_cap ) new_cap *= 2;
+
+            array_resize( rstate.cluster_index_offset_list, n, new_cap );
+            array_resize( rstate.cluster_index_count_list, n, new_cap );
+            array_resize( rstate.cluster_sphere_list, n, new_cap );
+            array_resize( rstate.cluster_cone_list, n, new_cap );
+
+            rstate.cluster_cap = new_cap;
+        }
+
+        rstate.cluster_count += count;
+    }
+
+    for ( int i = 0; i < count; i++ ) {
+        meshlet_t & meshlet = data->meshlet_list[ i ];
+        int c = first + i;
+
+        rstate.cluster_index_offset_list[ c ] = meshlet.first;
+        rstate.cluster_index_count_list[ c ] = meshlet.count;
+        glm_vec3_copy( meshlet.center, rstate.cluster_sphere_list[ c ] );
+        rstate.cluster_sphere_list[ c ][ 3 ] = meshlet.radius;
+        glm_vec3_copy( meshlet.cone_axis, rstate.cluster_cone_list[ c ] );
+        rstate.cluster_cone_list[ c ][ 3 ] = meshlet.cone_cutoff;
+    }
+
+    rstate.model_cluster_offset_list[ id ] = first;
+    rstate.model_cluster_count_list[ id ] = count;
+}
+
+/// the texture of a model texture file, loaded once for all models that
+/// name the file
+static int find_model_texture( const char * texture_file )
+{
+    for ( int i = 0; i < rstate.model_count; i++ ) {
+        const char * file = state.model_texture_file_list[ i ];
+        if ( !file || rstate.model_texture_list[ i ] == -1 ) continue;
+        if ( strcmp( file, texture_file ) == 0 ) {
+            return rstate.model_texture_list[ i ];
+        }
+    }
+
+    return load_texture_file( texture_file );
+}
+
+/// unsets the texture of a model, it is freed with the last model using it
+static void release_model_texture( int id )
+{
+    int texture = rstate.model_texture_list[ id ];
+    if ( texture == -1 ) return;
+
+    rstate.model_texture_list[ id ] = -1;
+
+    int count = rstate.model_count;
+    if ( index_of( rstate.model_texture_list, count, texture ) != -1 ) return;
+
+    texture_loader_cancel( texture );
+    forget_texture_file( texture );
+    free_texture( texture );
+}
+
+/// fills a reserved model from loaded data and makes it resident. the gpu
+/// buffers are not updated, see update_vertex_buffers.
+static void add_model_data( int id, model_data_t * data )
+{
+    wavefront_t * mesh = data->mesh;
+    int vertex_count = mesh->vertex_count;
+
+    int offset = add_vertices( mesh, data->color_list );
+
+    // indices are rebased onto the vertex table unless we can draw with a
+    // base vertex, then use 16 bit indices whenever they fit
+    int base = rstate.has_base_vertex ? 0 : offset;
+    int index_size = base + vertex_count <= 65536 ? 2 : 4;
+
+    rstate.model_offset_list[ id ] = offset;
+    rstate.model_size_list[ id ] = vertex_count;
+    rstate.model_index_size_list[ id ] = index_size;
+
+    // packed positions are quantized to these
+    glm_vec3_copy( data->bounds_min, rstate.model_bounds_min_list[ id ] );
+    glm_vec3_copy( data->bounds_max, rstate.model_bounds_max_list[ id ] );
+
+    int lod_offset_list[ MEOWGL_MAX_LOD_COUNT ];
+
+    for ( int lod = 0; lod < data->lod_count; lod++ ) {
+        int lod_id = id * MEOWGL_MAX_LOD_COUNT + lod;
+        int count = data->lod_index_count_list[ lod ];
+
+        lod_offset_list[ lod ] = add_indices(
+            data->lod_index_list[ lod ],
+            count,
+            base,
+            index_size
+        );
+
+        rstate.lod_index_count_list[ lod_id ] = count;
+        rstate.lod_index_offset_list[ lod_id ] = lod_offset_list[ lod ];
+        rstate.lod_error_list[ lod_id ] = data->lod_error_list[ lod ];
+    }
+
+    rstate.model_lod_count_list[ id ] = data->lod_count;
+    rstate.model_index_count_list[ id ] = data->lod_index_count_list[ 0 ];
+    rstate.model_index_offset_list[ id ] = lod_offset_list[ 0 ];
+
+    int group_count = mesh->material_group_count;
+    int * group_material_list = new int[ group_count ];
+    add_materials( data, group_material_list );
+    add_clusters( id, data );
+    add_submeshes( id, data, lod_offset_list, group_material_list );
+
+    // materials only used by empty groups have no submesh holding them
+    for ( int i = 0; i < group_count; i++ ) {
+        int material = group_material_list[ i ];
+        if ( material == -1 ) continue;
+        if ( state.material_ref_count_list[ material ] == 0 ) {
+            free_material( material );
+        }
+    }
+    delete[] group_material_list;
+
+    // a baked model draws without its texture, it is only loaded for
+    // models that sample it
+    const char * texture_file = state.model_texture_file_list[ id ];
+    rstate.model_baked_list[ id ] = data->color_list != nullptr;
+    if ( data->color_list ) {
+        release_model_texture( id );
+    } else if ( texture_file && rstate.model_texture_list[ id ] == -1 ) {
+        rstate.model_texture_list[ id ] = find_model_texture( texture_file );
+    }
+
+    state.model_hash_list[ id ] = data->content_hash;
+    if ( data->content_hash != 0 ) {
+        hash_map_set( &state.model_content_map, data->content_hash, id );
+    }
+
+    rstate.model_resident_list[ id ] = 1;
+}
+
+static void grow_model_tables()
+{
+    int n = rstate.model_count;
+    int new_cap = rstate.model_cap * 2;
+    int lod_count = n * MEOWGL_MAX_LOD_COUNT;
+    int lod_cap = new_cap * MEOWGL_MAX_LOD_COUNT;
+
+    array_resize( rstate.model_size_list, n, new_cap );
+    array_resize( rstate.model_offset_list, n, new_cap );
+    array_resize( rstate.model_index_count_list, n, new_cap );
+    array_resize( rstate.model_index_offset_list, n, new_cap );
+    array_resize( rstate.model_index_size_list, n, new_cap );
+    array_resize( rstate.model_texture_list, n, new_cap );
+    array_resize( rstate.model_emission_list, n, new_cap );
+    array_resize( rstate.model_bounds_min_list, n, new_cap );
+    array_resize( rstate.model_bounds_max_list, n, new_cap );
+    array_resize( rstate.model_lod_count_list, n, new_cap );
+    array_resize( rstate.model_cluster_offset_list, n, new_cap );
+    array_resize( rstate.model_cluster_count_list, n, new_cap );
+    array_resize( rstate.model_submesh_offset_list, n, new_cap );
+    array_resize( rstate.model_submesh_count_list, n, new_cap );
+    array_resize( rstate.model_resident_list, n, new_cap );
+    array_resize( rstate.model_baked_list, n, new_cap );
+
+    array_resize( rstate.lod_index_count_list, lod_count, lod_cap );
+    array_resize( rstate.lod_index_offset_list, lod_count, lod_cap );
+    array_resize( rstate.lod_error_list, lod_count, lod_cap );
+
+    array_resize( state.model_file_list, n, new_cap );
+    array_resize( state.model_texture_file_list, n, new_cap );
+    array_resize( state.model_ref_count_list, n, new_cap );
+    array_resize( state.model_hash_list, n, new_cap );
+    array_resize( state.model_free_list, state.model_free_count, new_cap );
+
+    rstate.model_cap = new_cap;
+}
+
+static int find_model( const char * filename )
+{
+    hash_t name = hash_string( filename, HASH_SEED );
+    return hash_map_find( &state.model_name_map, name );
+}
+
+/// clears a model table entry so it draws nothing
+static void clear_model( int id )
+{
+    rstate.model_offset_list[ id ] = 0;
+    rstate.model_size_list[ id ] = 0;
+    rstate.model_index_count_list[ id ] = 0;
+    rstate.model_index_offset_list[ id ] = 0;
+    rstate.model_index_size_list[ id ] = 2;
+    rstate.model_texture_list[ id ] = -1;
+    glm_vec3_zero( rstate.model_emission_list[ id ] );
+    glm_vec3_zero( rstate.model_bounds_min_list[ id ] );
+    glm_vec3_zero( rstate.model_bounds_max_list[ id ] );
+    rstate.model_lod_count_list[ id ] = 0;
+    rstate.model_cluster_offset_list[ id ] = 0;
+    rstate.model_cluster_count_list[ id ] = 0;
+    rstate.model_submesh_offset_list[ id ] = 0;
+    rstate.model_submesh_count_list[ id ] = 0;
+    rstate.model_resident_list[ id ] = 0;
+    rstate.model_baked_list[ id ] = 0;
+
+    state.model_ref_count_list[ id ] = 0;
+    state.model_hash_list[ id ] = 0;
+}
+
+/// a model table entry that draws nothing until add_model_data fills it,
+/// reuses the slots of unloaded models
+static int reserve_model( const char * filename )
+{
+    int id;
+    if ( state.model_free_count > 0 ) {
+        id = state.model_free_list[ --state.model_free_count ];
+    } else {
+        if ( rstate.model_count >= rstate.model_cap ) grow_model_tables();
+        id = rstate.model_count++;
+    }
+
+    clear_model( id );
+
+    state.model_file_list[ id ] = strdup( filename );
+    state.model_texture_file_list[ id ] = nullptr;
+    hash_map_set(
+        &state.model_name_map,
+        hash_string( filename, HASH_SEED ),
+        id
+    );
+
+    return id;
+}
+
+static void free_model_slot( int id )
+{
+    clear_model( id );
+
+    free( state.model_file_list[ id ] );
+    free( state.model_texture_file_list[ id ] );
+    state.model_file_list[ id ] = nullptr;
+    state.model_texture_file_list[ id ] = nullptr;
+
+    state.model_free_list[ state.model_free_count++ ] = id;
+}
+
+static void retain_model( int id )
+{
+    state.model_ref_count_list[ id ]++;
+}
+
+static void release_model( int id )
+{
+    state.model_ref_count_list[ id ]--;
+}
+
+/// a resident model the loaded data can share instead of being added again
+static int find_same_model( int id, model_data_t * data )
+{
+    if ( data->content_hash == 0 ) return -1;
+
+    int same = hash_map_find( &state.model_content_map, data->content_hash );
+    if ( same == -1 || same == id ) return -1;
+
+    // the texture and emission set on the models have to agree as well
+    const char * texture_file = state.model_texture_file_list[ id ];
+    const char * same_texture_file = state.model_texture_file_list[ same ];
+    if ( texture_file || same_texture_file ) {
+        if ( !texture_file || !same_texture_file ) return -1;
+        if ( strcmp( texture_file, same_texture_file ) != 0 ) return -1;
+    }
+    if ( !glm_vec3_eqv(
+             rstate.model_emission_list[ same ],
+             rstate.model_emission_list[ id ]
+         ) ) {
+        return -1;
+    }
+
+    return same;
+}
+
+/// moves the references to a model over to the same model and frees its
+/// slot, its file name resolves to the same model from now on
+static void merge_model( int id, int same )
+{
+    INFO_LOG(
+        "%s is the same as %s",
+        state.model_file_list[ id ],
+        state.model_file_list[ same ]
+    );
+
+    for ( int e = 0; e < rstate.entity_count; e++ ) {
+        if ( rstate.entity_model_list[ e ] == id ) {
+            rstate.entity_model_list[ e ] = same;
+        }
+    }
+
+    state.model_ref_count_list[ same ] += state.model_ref_count_list[ id ];
+
+    hash_map_set(
+        &state.model_name_map,
+        hash_string( state.model_file_list[ id ], HASH_SEED ),
+        same
+    );
+
+    free_model_slot( id );
+}
+
+/// makes loaded data resident in the reserved model, or merges the model
+/// into a resident one with the same content. returns the model to use.
+static int place_model_data( int id, model_data_t * data )
+{
+    int same = find_same_model( id, data );
+    if ( same != -1 ) {
+        merge_model( id, same );
+        return same;
+    }
+
+    add_model_data( id, data );
+    return id;
+}
+
+/// gives back the vertex, index, submesh and cluster ranges of a resident
+/// model and its material references, the slot stays with the model
+static void free_model_data( int id )
+{
+    int first = rstate.model_submesh_offset_list[ id ];
+    int count = rstate.model_submesh_count_list[ id ];
+    for ( int s = first; s < first + count; s++ ) {
+        release_material( rstate.submesh_material_list[ s ] );
+    }
+
+    range_list_give( &state.submesh_range_list, first, count );
+    range_list_give(
+        &state.cluster_range_list,
+        rstate.model_cluster_offset_list[ id ],
+        rstate.model_cluster_count_list[ id ]
+    );
+    range_list_give(
+        &state.vertex_range_list,
+        rstate.model_offset_list[ id ],
+        rstate.model_size_list[ id ]
+    );
 
-    glm_vec3_copy( rstate.camera.pos, origin );
-    glm_vec3_sub( point, origin, direction );
+    int index_size = rstate.model_index_size_list[ id ];
+    for ( int lod = 0; lod < rstate.model_lod_count_list[ id ]; lod++ ) {
+        int lod_id = id * MEOWGL_MAX_LOD_COUNT + lod;
+        range_list_give(
+            &state.index_range_list,
+            rstate.lod_index_offset_list[ lod_id ],
+            rstate.lod_index_count_list[ lod_id ] * index_size
+        );
+    }
 
-    int e = intersect_scene( origin, direction );
+    trim_tables();
 
-    if ( e != -1 ) {
-        rstate.hi_entity = e;
-        state.current_entity = e;
-    } else {
-        state.current_entity = -1;
-        rstate.hi_entity = -1;
+    hash_t hash = state.model_hash_list[ id ];
+    if ( hash != 0 && hash_map_find( &state.model_content_map, hash ) == id ) {
+        hash_map_remove( &state.model_content_map, hash );
     }
+
+    state.model_hash_list[ id ] = 0;
+    rstate.model_resident_list[ id ] = 0;
 }
 
-int add_model(
-    float * pos_list,
-    float * norm_list,
-    float * uv_list,
-    int vertex_count
-)
+/// frees the table ranges of a model, its material and texture references
+/// and its slot. fails while the model is used or loading.
+static int unload_model( int id )
 {
-    float * out_pos = rstate.vertex_pos_list;
-    float * out_normal = rstate.vertex_normal_list;
-    float * out_uv = rstate.vertex_uv_list;
+    if ( state.model_ref_count_list[ id ] > 0 ) return -1;
+    if ( !rstate.model_resident_list[ id ] ) return -1;
 
-    // resize
-    while ( rstate.vertex_count + vertex_count > rstate.vertex_cap ) {
-        int new_cap = rstate.vertex_cap * 2;
-        out_pos = new float[ new_cap * 3 ];
-        out_normal = new float[ new_cap * 3 ];
-        out_uv = new float[ new_cap * 2 ];
-
-        memcpy(
-            out_pos,
-            rstate.vertex_pos_list,
-            sizeof( float ) * rstate.vertex_cap * 3
-        );
-        memcpy(
-            out_normal,
-            rstate.vertex_normal_list,
-            sizeof( float ) * rstate.vertex_cap * 3
-        );
-        memcpy(
-            out_uv,
-            rstate.vertex_uv_list,
-            sizeof( float ) * rstate.vertex_cap * 2
-        );
+    free_model_data( id );
+    release_model_texture( id );
+    hash_map_remove_value( &state.model_name_map, id );
 
-        delete[] rstate.vertex_pos_list;
-        delete[] rstate.vertex_normal_list;
-        delete[] rstate.vertex_uv_list;
+    free_model_slot( id );
 
-        rstate.vertex_pos_list = out_pos;
-        rstate.vertex_normal_list = out_normal;
-        rstate.vertex_uv_list = out_uv;
-        rstate.vertex_cap = new_cap;
-    }
+    return 0;
+}
 
-    int offset = rstate.vertex_count;
+/// unloads every resident model nothing holds, returns how many
+static int unload_unused_models()
+{
+    int count = 0;
 
-    memcpy(
-        out_pos + ( rstate.vertex_count * 3 ),
-        pos_list,
-        sizeof( float ) * vertex_count * 3
-    );
-    memcpy(
-        out_normal + ( rstate.vertex_count * 3 ),
-        norm_list,
-        sizeof( float ) * vertex_count * 3
-    );
-    memcpy(
-        out_uv + ( rstate.vertex_count * 2 ),
-        uv_list,
-        sizeof( float ) * vertex_count * 2
-    );
+    for ( int i = 0; i < rstate.model_count; i++ ) {
+        if ( !state.model_file_list[ i ] ) continue;
+        if ( unload_model( i ) == 0 ) count++;
+    }
 
-    rstate.vertex_count += vertex_count;
+    if ( count > 0 ) {
+        INFO_LOG( "unloaded %d models", count );
+        update_vertex_buffers();
+    }
 
-    update_vertex_buffers();
+    return count;
+}
 
-    int id = rstate.model_count++;
+/// loads a model on the calling thread
+static int add_model( const char * filename )
+{
+    int id = find_model( filename );
+    if ( id != -1 ) return id;
+
+    id = reserve_model( filename );
+
+    model_data_t data;
+    load_model_data(
+        &data,
+        filename,
+        nullptr,
+        state.enable_mesh_optimization,
+        state.enable_palette_baking
+    );
+    id = place_model_data( id, &data );
+    model_data_free( &data );
 
-    rstate.model_offset_list[ id ] = offset;
-    rstate.model_size_list[ id ] = vertex_count;
-    rstate.model_texture_list[ id ] = -1;
-    glm_vec3_zero( rstate.model_emission_list[ id ] );
+    update_vertex_buffers();
 
     return id;
 }
 
-static int add_model( const char * filename )
+/// returns right away and loads the model in the background, entities
+/// using it draw the placeholder model until it is resident. the texture
+/// file replaces the textures of the materials, nullptr to keep them.
+static int load_textured_model(
+    const char * filename,
+    const char * texture_file
+)
 {
-    for ( int i = 0; i < rstate.model_count; i++ ) {
-        if ( strcmp( filename, state.model_file_list[ i ] ) == 0 ) {
-            return i;
-        }
+    int id = find_model( filename );
+    if ( id != -1 ) return id;
+
+    id = reserve_model( filename );
+    if ( texture_file ) {
+        state.model_texture_file_list[ id ] = strdup( texture_file );
     }
 
-    wavefront_t file;
-    load_wavefront( &file, find_res( filename ) );
-    int id = add_model(
-        file.pos_list,
-        file.normal_list,
-        file.uv_list,
-        file.vertex_count
+    model_loader_request(
+        id,
+        filename,
+        texture_file,
+        state.enable_mesh_optimization,
+        state.enable_palette_baking
     );
-    state.model_file_list[ id ] = strdup( filename );
-    state.model_file_count++;
 
     return id;
 }
 
+static int load_model( const char * filename )
+{
+    return load_textured_model( filename, nullptr );
+}
+
+/// adds finished background loads until the frame's upload budget is spent,
+/// at least one per frame so a large model can not stall the queue
+static void upload_loaded_models()
+{
+    int size = 0;
+
+    while ( size < state.upload_budget ) {
+        int id;
+        model_data_t * data = model_loader_poll( &id );
+        if ( !data ) break;
+
+        size += model_data_size( data );
+        place_model_data( id, data );
+
+        model_data_free( data );
+        delete data;
+    }
+
+    if ( size > 0 ) {
+        update_vertex_buffers();
+        compute_all_shadow_maps();
+    }
+}
+
+// registry [end] //////////////////////////////////////////////////////////////
+
 static int add_entity()
 {
     int id = rstate.entity_count++;
@@ -272,6 +1177,17 @@ static int add_entity()
     return id;
 }
 
+/// entities hold a reference to their model, -1 = none
+static void set_entity_model( int e, int model )
+{
+    int old = rstate.entity_model_list[ e ];
+
+    if ( model != -1 ) retain_model( model );
+    if ( old != -1 ) release_model( old );
+
+    rstate.entity_model_list[ e ] = model;
+}
+
 static int add_model_entity()
 {
     int id = rstate.e_model_count++;
@@ -288,11 +1204,45 @@ static int add_light_entity()
     int e = add_entity();
 
     rstate.e_light_entity_list[ id ] = e;
-    rstate.entity_model_list[ e ] = rstate.light_model;
+    set_entity_model( e, rstate.light_model );
 
     return e;
 }
 
+static bool is_nocast_light( int e )
+{
+    return index_of(
+               rstate.e_nocast_light_entity_list,
+               rstate.e_nocast_light_count,
+               e
+           ) != -1;
+}
+
+/// moves a light between the casting and non-casting light tables
+static void set_light_casts_shadow( int e, bool cast )
+{
+    int * from_list = rstate.e_nocast_light_entity_list;
+    int * from_count = &rstate.e_nocast_light_count;
+    int * to_list = rstate.e_light_entity_list;
+    int * to_count = &rstate.e_light_count;
+
+    if ( !cast ) {
+        from_list = rstate.e_light_entity_list;
+        from_count = &rstate.e_light_count;
+        to_list = rstate.e_nocast_light_entity_list;
+        to_count = &rstate.e_nocast_light_count;
+    }
+
+    int i = index_of( from_list, *from_count, e );
+    if ( i == -1 ) return;
+
+    array_swap_last( from_list, *from_count, i );
+    ( *from_count )--;
+    to_list[ ( *to_count )++ ] = e;
+
+    compute_all_shadow_maps();
+}
+
 static void rotate_entity( float dtheta )
 {
     if ( state.current_entity == -1 ) return;
@@ -304,15 +1254,6 @@ static void rotate_entity( float dtheta )
     current_t.update();
 }
 
-static int index_of( int * list, int count, int value )
-{
-    for ( int i = 0; i < count; i++ ) {
-        if ( list[ i ] == value ) return i;
-    }
-
-    return -1;
-}
-
 static void duplicate_current_entity()
 {
     if ( state.current_entity == -1 ) return;
@@ -330,6 +1271,11 @@ static void duplicate_current_entity()
         new_e = add_light_entity();
     }
 
+    if ( is_nocast_light( e ) ) {
+        new_e = add_light_entity();
+        set_light_casts_shadow( new_e, false );
+    }
+
     if ( new_e == -1 ) {
         ERROR_LOG( "entity not found in type lists" );
         return;
@@ -338,7 +1284,7 @@ static void duplicate_current_entity()
     int model = rstate.entity_model_list[ e ];
     transform_t & t = rstate.entity_transform_list[ e ];
 
-    rstate.entity_model_list[ new_e ] = model;
+    set_entity_model( new_e, model );
     rstate.entity_transform_list[ new_e ] = t;
 
     state.current_entity = new_e;
@@ -351,6 +1297,8 @@ static void remove_current_entity()
 
     int e = state.current_entity;
 
+    set_entity_model( e, -1 );
+
     // remove entity references
     int i = index_of( rstate.e_model_entity_list, rstate.e_model_count, e );
     if ( i != -1 ) {
@@ -365,6 +1313,20 @@ static void remove_current_entity()
         rstate.e_light_count--;
     }
 
+    i = index_of(
+        rstate.e_nocast_light_entity_list,
+        rstate.e_nocast_light_count,
+        e
+    );
+    if ( i != -1 ) {
+        array_swap_last(
+            rstate.e_nocast_light_entity_list,
+            rstate.e_nocast_light_count,
+            i
+        );
+        rstate.e_nocast_light_count--;
+    }
+
     // remove entity
     array_swap_last( rstate.entity_model_list, rstate.entity_count, e );
     array_swap_last( rstate.entity_transform_list, rstate.entity_count, e );
@@ -379,6 +1341,13 @@ static void remove_current_entity()
     );
     if ( i != -1 ) rstate.e_light_entity_list[ i ] = new_index;
 
+    i = index_of(
+        rstate.e_nocast_light_entity_list,
+        rstate.e_nocast_light_count,
+        last_index
+    );
+    if ( i != -1 ) rstate.e_nocast_light_entity_list[ i ] = new_index;
+
     i = index_of(
         rstate.e_model_entity_list,
         rstate.e_model_count,
@@ -418,8 +1387,10 @@ static void init()
 {
     using string_t = char *;
     state.avail_model_file_list = new string_t[ 32 ];
-    state.model_file_list = new string_t[ 32 ];
-    setup_resource_list();
+    state.avail_model_file_count = 0;
+    state.avail_model_file_cap = 32;
+
+    setup_registry();
 
     state.enable_pos_snapping = false;
     state.pos_snapping_delta = 1.0f;
@@ -427,21 +1398,34 @@ static void init()
     state.enable_rot_snapping = true;
     state.rot_snapping_delta = 45;
 
-    int miku_texture = load_texture( find_res( "colors_miku.png" ) );
+    state.enable_mesh_optimization = true;
+    state.enable_palette_baking = true;
+
+    state.upload_budget = 4 * 1024 * 1024;
+    state.texture_upload_budget = 8 * 1024 * 1024;
+
+    model_loader_init( 0 );
+    texture_loader_init( 0 );
+
+    catalog_init( 0 );
+    setup_resource_list();
+
+    // drawn in place of models that are still loading
+    rstate.placeholder_model = add_model( "cube.obj" );
+    retain_model( rstate.placeholder_model );
+
+    // the kit models color themselves from this palette
+    const char * palette = "colors_miku.png";
 
-    int fan_model = add_model( "SM_Exhaust_Fan.obj" );
-    int miku_model = add_model( "miku.obj" );
-    int floor_model = add_model( "SM_FloorTile.obj" );
+    load_textured_model( "SM_Exhaust_Fan.obj", palette );
+    int miku_model = load_textured_model( "miku.obj", palette );
+    load_textured_model( "SM_FloorTile.obj", palette );
     int light_model = add_model( "SM_Light.obj" );
-    int doorway_model = add_model( "SM_Doorway.obj" );
-    int ceiling_light_model = add_model( "SM_Ceiling_Light.obj" );
+    load_textured_model( "SM_Doorway.obj", palette );
+    int ceiling_light_model = load_model( "SM_Ceiling_Light.obj" );
 
     rstate.light_model = light_model;
-
-    rstate.model_texture_list[ miku_model ] = miku_texture;
-    rstate.model_texture_list[ fan_model ] = miku_texture;
-    rstate.model_texture_list[ floor_model ] = miku_texture;
-    rstate.model_texture_list[ doorway_model ] = miku_texture;
+    retain_model( light_model );
 
     rstate.model_emission_list[ ceiling_light_model ][ 0 ] = 1.0f;
     rstate.model_emission_list[ ceiling_light_model ][ 1 ] = 1.0f;
@@ -449,14 +1433,16 @@ static void init()
 
     {
         int e = add_model_entity();
-        rstate.entity_model_list[ e ] = miku_model;
+        set_entity_model( e, miku_model );
     }
 
     add_light_entity();
 
-    static cgltf_options opt;
-    cgltf_data * data = nullptr;
-    cgltf_parse_file( &opt, "../../res/miku.glb", &data );
+    // packed resources do not change, only loose files are reloaded
+    if ( archive_entry_count() == 0 ) {
+        char res_dir[ 1024 ];
+        if ( res_path( res_dir, 1024, "" ) == 0 ) file_watch_init( res_dir );
+    }
 }
 
 static void render_entity_properties()
@@ -493,6 +1479,16 @@ static void render_entity_properties()
     ImGui::InputFloat3( "scale", current_t.scale );
     current_t.update();
 
+    int e = state.current_entity;
+    bool cast =
+        index_of( rstate.e_light_entity_list, rstate.e_light_count, e ) != -1;
+    if ( cast || is_nocast_light( e ) ) {
+        ImGui::SeparatorText( "light" );
+        if ( ImGui::Checkbox( "cast shadows", &cast ) ) {
+            set_light_casts_shadow( e, cast );
+        }
+    }
+
     ImGui::SeparatorText( "entity actions" );
     if ( ImGui::Button( "move" ) ) {
         state.move_mode = 1;
@@ -505,6 +1501,99 @@ static void render_entity_properties()
     }
 }
 
+static void render_catalog_tooltip( catalog_entry_t * entry )
+{
+    if ( entry->building ) {
+        ImGui::SetTooltip( "%s\nbuilding", entry->filename );
+        return;
+    }
+    if ( entry->status == CATALOG_FAILED ) {
+        ImGui::SetTooltip( "%s\nempty or failed to load", entry->filename );
+        return;
+    }
+
+    float * min = entry->bounds_min;
+    float * max = entry->bounds_max;
+    ImGui::SetTooltip(
+        "%s\n%d vertices, %d triangles\nsize %.2f x %.2f x %.2f",
+        entry->filename,
+        entry->vertex_count,
+        entry->triangle_count,
+        max[ 0 ] - min[ 0 ],
+        max[ 1 ] - min[ 1 ],
+        max[ 2 ] - min[ 2 ]
+    );
+}
+
+/// the catalogue with thumbnails, only the rows in view are drawn so it
+/// stays quick with thousands of files
+static void render_model_browser()
+{
+    static ImGuiTextFilter filter;
+    filter.Draw( "filter" );
+
+    // entries passing the filter
+    static int * row_list = nullptr;
+    static int row_cap = 0;
+    int row_count = 0;
+
+    if ( row_cap < catalog_count() ) {
+        delete[] row_list;
+        row_cap = catalog_count() * 2;
+        row_list = new int[ row_cap ];
+    }
+    for ( int i = 0; i < catalog_count(); i++ ) {
+        if ( filter.PassFilter( catalog_entry( i )->filename ) ) {
+            row_list[ row_count++ ] = i;
+        }
+    }
+
+    float size = CATALOG_THUMBNAIL_SIZE;
+    float row_height = size + ImGui::GetStyle().ItemSpacing.y;
+
+    ImVec2 box_size( -FLT_MIN, row_height * 8.0f );
+    if ( !ImGui::BeginListBox( "##model_file", box_size ) ) return;
+
+    ImGuiListClipper clipper;
+    clipper.Begin( row_count, row_height );
+    while ( clipper.Step() ) {
+        for ( int r = clipper.DisplayStart; r < clipper.DisplayEnd; r++ ) {
+            int i = row_list[ r ];
+            catalog_entry_t * entry = catalog_entry( i );
+
+            ImGui::PushID( i );
+
+            int texture = catalog_texture( i );
+            if ( texture != -1 ) {
+                ImGui::Image( (ImTextureID) texture, ImVec2( size, size ) );
+            } else {
+                ImGui::Dummy( ImVec2( size, size ) );
+            }
+            ImGui::SameLine();
+
+            static char add_model_text[ 1024 ];
+            snprintf( add_model_text, 1024, "add %s", entry->filename );
+            if ( ImGui::Selectable(
+                     add_model_text,
+                     false,
+                     0,
+                     ImVec2( 0.0f, size )
+                 ) ) {
+                int model = load_model( entry->filename );
+                int e = add_model_entity();
+                state.current_entity = e;
+                set_entity_model( e, model );
+                rstate.hi_entity = e;
+            }
+            if ( ImGui::IsItemHovered() ) render_catalog_tooltip( entry );
+
+            ImGui::PopID();
+        }
+    }
+
+    ImGui::EndListBox();
+}
+
 static void render_edit_window()
 {
     ImGui::Text( "fps = %f", 1.0f / state.tick_step );
@@ -516,30 +1605,58 @@ static void render_edit_window()
         rstate.hi_entity = e;
     }
 
-    if ( ImGui::BeginListBox( "##model_file", ImVec2( -FLT_MIN, 0.0f ) ) ) {
-        for ( int i = 0; i < state.avail_model_file_count; i++ ) {
-            static char add_model_text[ 1024 ];
-            snprintf(
-                add_model_text,
-                1024,
-                "add %s",
-                state.avail_model_file_list[ i ]
-            );
-            if ( ImGui::Selectable( add_model_text, false ) ) {
-                int model = add_model( state.avail_model_file_list[ i ] );
-                int e = add_model_entity();
-                state.current_entity = e;
-                rstate.entity_model_list[ e ] = model;
-                rstate.hi_entity = e;
-            }
-        }
-        ImGui::EndListBox();
+    ImGui::Checkbox(
+        "optimize imported meshes",
+        &state.enable_mesh_optimization
+    );
+    ImGui::Checkbox( "bake palette textures", &state.enable_palette_baking );
+
+    bool packed = rstate.packed_vertices;
+    if ( ImGui::Checkbox( "packed vertices", &packed ) ) {
+        rstate.packed_vertices = packed;
+        update_vertex_buffers();
     }
 
+    bool lod = rstate.enable_lod;
+    if ( ImGui::Checkbox( "level of detail", &lod ) ) {
+        rstate.enable_lod = lod;
+    }
+
+    bool clusters = rstate.enable_cluster_culling;
+    if ( ImGui::Checkbox( "cluster culling", &clusters ) ) {
+        rstate.enable_cluster_culling = clusters;
+    }
+
+    render_model_browser();
+
     if ( ImGui::Button( "refresh files" ) ) {
         setup_resource_list();
     }
 
+    if ( ImGui::Button( "unload unused models" ) ) {
+        unload_unused_models();
+    }
+
+    if ( model_loader_pending() > 0 ) {
+        ImGui::Text( "loading %d models", model_loader_pending() );
+    }
+
+    if ( texture_loader_pending() > 0 ) {
+        ImGui::Text( "loading %d textures", texture_loader_pending() );
+    }
+
+    if ( catalog_pending() > 0 ) {
+        ImGui::Text( "cataloguing %d models", catalog_pending() );
+    }
+
+    if ( program_ready_count() < program_count() ) {
+        ImGui::Text(
+            "%d of %d shader programs ready",
+            program_ready_count(),
+            program_count()
+        );
+    }
+
     ImGui::SeparatorText( "render" );
 
     if ( ImGui::Button( "recompute shadows" ) ) {
@@ -551,6 +1668,129 @@ static void render_edit_window()
     render_entity_properties();
 }
 
+// hot reload [begin] /////////////////////////////////////////////////////////
+
+static void read_map();
+
+/// parses the file again into the model it was loaded as, so every entity
+/// using it sees the new mesh. its old ranges are given back first, a mesh
+/// that did not grow goes back where it was.
+static void reload_model( const char * filename )
+{
+    int id = find_model( filename );
+
+    // not loaded, or still loading and about to read the new file anyway
+    if ( id == -1 || !rstate.model_resident_list[ id ] ) return;
+
+    // merged with a model of the same content from another file
+    if ( strcmp( state.model_file_list[ id ], filename ) != 0 ) {
+        INFO_LOG(
+            "%s is shared with %s, reload that instead",
+            filename,
+            state.model_file_list[ id ]
+        );
+        return;
+    }
+
+    model_data_t data;
+    load_model_data(
+        &data,
+        filename,
+        state.model_texture_file_list[ id ],
+        state.enable_mesh_optimization,
+        state.enable_palette_baking
+    );
+
+    // editors may still be writing, keep the old mesh until the file parses
+    if ( data.errors || data.mesh->vertex_count == 0 ) {
+        ERROR_LOG( "failed to reload %s, keeping the old mesh", filename );
+        model_data_free( &data );
+        return;
+    }
+
+    free_model_data( id );
+    add_model_data( id, &data );
+    model_data_free( &data );
+
+    update_vertex_buffers();
+    compute_all_shadow_maps();
+
+    INFO_LOG( "reloaded %s", filename );
+}
+
+/// loads the file again into every texture that was loaded from it, each
+/// keeps its old image until the new one is resident
+static void reload_texture_file( const char * name )
+{
+    bool found = false;
+
+    for ( int i = 0; i < state.texture_file_count; i++ ) {
+        if ( strcmp( state.texture_file_list[ i ], name ) != 0 ) continue;
+
+        res_t res = find_texture_res( name );
+        if ( !res.data ) return;
+
+        texture_loader_reload( state.texture_file_texture_list[ i ], res );
+        found = true;
+    }
+
+    if ( found ) INFO_LOG( "reloading %s", name );
+}
+
+/// models set to a texture file that changed, their baked colors come from
+/// it, or it may have become a palette
+static void reload_textured_models( const char * name )
+{
+    for ( int i = 0; i < rstate.model_count; i++ ) {
+        const char * file = state.model_texture_file_list[ i ];
+        if ( !file || strcmp( file, name ) != 0 ) continue;
+
+        reload_model( state.model_file_list[ i ] );
+    }
+}
+
+/// reloads each resource that changed on disk since the last frame on its
+/// own, everything else stays as it is
+static void reload_changed_files()
+{
+    const char * name;
+    while ( ( name = file_watch_poll() ) ) {
+        if ( is_model_file( name ) ) {
+            if ( has_avail_model_file( name ) ) {
+                catalog_update( name, state.enable_mesh_optimization );
+            } else {
+                add_avail_model_file( name );
+                catalog_sync(
+                    state.avail_model_file_list,
+                    state.avail_model_file_count,
+                    state.enable_mesh_optimization
+                );
+            }
+            reload_model( name );
+        } else if ( strcmp( name, "shaders.glsl" ) == 0 ) {
+            int count = reload_shaders();
+            INFO_LOG( "rebuilding %d shader programs", count );
+        } else if ( strcmp( name, "map.json" ) == 0 ) {
+            read_map();
+            compute_all_shadow_maps();
+        } else if ( has_suffix( name, TEXTURE_FILE_BC_SUFFIX ) ||
+                    has_suffix( name, TEXTURE_FILE_ETC_SUFFIX ) ) {
+            // texpack ran again, the image name is the file name before the
+            // suffix
+            char image[ 256 ];
+            snprintf( image, 256, "%s", name );
+            *strrchr( image, '.' ) = '\0';
+            *strrchr( image, '.' ) = '\0';
+            reload_texture_file( image );
+        } else {
+            reload_texture_file( name );
+            reload_textured_models( name );
+        }
+    }
+}
+
+// hot reload [end] ////////////////////////////////////////////////////////////
+
 static void loop()
 {
     float time = hardware_time();
@@ -625,6 +1865,14 @@ static void loop()
         compute_all_shadow_maps();
     }
 
+    reload_changed_files();
+
+    catalog_poll();
+
+    upload_loaded_models();
+
+    texture_loader_poll( state.texture_upload_budget );
+
     render();
 
     static bool show_imgui = true;
@@ -659,6 +1907,8 @@ static void write_map()
     cJSON * entity_list = cJSON_AddArrayToObject( map, "entity_list" );
     cJSON * e_model_list = cJSON_AddArrayToObject( map, "e_model_list" );
     cJSON * e_light_list = cJSON_AddArrayToObject( map, "e_light_list" );
+    cJSON * e_nocast_light_list =
+        cJSON_AddArrayToObject( map, "e_nocast_light_list" );
 
     for ( int i = 0; i < rstate.entity_count; i++ ) {
         int model = rstate.entity_model_list[ i ];
@@ -688,6 +1938,13 @@ static void write_map()
         );
     }
 
+    for ( int i = 0; i < rstate.e_nocast_light_count; i++ ) {
+        cJSON_AddItemToArray(
+            e_nocast_light_list,
+            cJSON_CreateNumber( rstate.e_nocast_light_entity_list[ i ] )
+        );
+    }
+
     char * json = cJSON_Print( map );
     // printf( "%s\n", json );
 
@@ -708,6 +1965,9 @@ cJSON_GetVec3CaseSensitive( vec3 out, cJSON * object, const char * name )
     }
 }
 
+/// reads map.json into the entity tables. entities already in the tables
+/// are only touched where the map differs, so reading it again while
+/// editing applies just what changed in the file.
 static void read_map()
 {
     res_t res = find_res( "map.json" );
@@ -718,41 +1978,82 @@ static void read_map()
 
     if ( !map ) {
         ERROR_LOG( "failed to parse map.json" );
+        release_res( &res );
         return;
     }
 
-    // clear tables
-    rstate.entity_count = 0;
-    rstate.e_light_count = 0;
-    rstate.e_model_count = 0;
-
     cJSON * entity_list =
         cJSON_GetObjectItemCaseSensitive( map, "entity_list" );
     cJSON * e_model_list =
         cJSON_GetObjectItemCaseSensitive( map, "e_model_list" );
     cJSON * e_light_list =
         cJSON_GetObjectItemCaseSensitive( map, "e_light_list" );
+    // lights that cast no shadow, maps without the list have none
+    cJSON * e_nocast_light_list =
+        cJSON_GetObjectItemCaseSensitive( map, "e_nocast_light_list" );
     cJSON * id;
     cJSON * entity;
 
+    int count = 0;
+    int changed = 0;
+    int old_count = rstate.entity_count;
+
     cJSON_ArrayForEach( entity, entity_list )
     {
         cJSON * model_json =
             cJSON_GetObjectItemCaseSensitive( entity, "model" );
 
-        int model = add_model( model_json->valuestring );
+        int model = load_model( model_json->valuestring );
 
-        int e = add_entity();
-        rstate.entity_model_list[ e ] = model;
-        transform_t & t = rstate.entity_transform_list[ e ];
+        transform_t t;
+        t.identity();
         cJSON_GetVec3CaseSensitive( t.pos, entity, "pos" );
         cJSON_GetVec3CaseSensitive( t.rot, entity, "rot" );
         cJSON_GetVec3CaseSensitive( t.scale, entity, "scale" );
-        t.update();
+
+        int e = count < rstate.entity_count ? count : add_entity();
+        count++;
+
+        transform_t & old_t = rstate.entity_transform_list[ e ];
+        if ( e < old_count && rstate.entity_model_list[ e ] == model &&
+             glm_vec3_eqv( old_t.pos, t.pos ) &&
+             glm_vec3_eqv( old_t.rot, t.rot ) &&
+             glm_vec3_eqv( old_t.scale, t.scale ) ) {
+            continue;
+        }
+        if ( e < old_count ) changed++;
+
+        set_entity_model( e, model );
+        glm_vec3_copy( t.pos, old_t.pos );
+        glm_vec3_copy( t.rot, old_t.rot );
+        glm_vec3_copy( t.scale, old_t.scale );
+        old_t.update();
 
         // INFO_LOG( "read %s", model_json->valuestring );
     }
 
+    // entities the map no longer has
+    for ( int e = count; e < rstate.entity_count; e++ ) {
+        set_entity_model( e, -1 );
+    }
+    rstate.entity_count = count;
+
+    if ( state.current_entity >= count ) {
+        state.current_entity = -1;
+        rstate.hi_entity = -1;
+    }
+
+    INFO_LOG(
+        "map: %d entities changed, %d added, %d removed",
+        changed,
+        count > old_count ? count - old_count : 0,
+        old_count > count ? old_count - count : 0
+    );
+
+    rstate.e_light_count = 0;
+    rstate.e_nocast_light_count = 0;
+    rstate.e_model_count = 0;
+
     cJSON_ArrayForEach( id, e_model_list )
     {
         int e = cJSON_GetNumberValue( id );
@@ -764,6 +2065,18 @@ static void read_map()
         int e = cJSON_GetNumberValue( id );
         rstate.e_light_entity_list[ rstate.e_light_count++ ] = e;
     }
+
+    cJSON_ArrayForEach( id, e_nocast_light_list )
+    {
+        int e = cJSON_GetNumberValue( id );
+        rstate.e_nocast_light_entity_list[ rstate.e_nocast_light_count++ ] = e;
+    }
+
+    cJSON_Delete( map );
+    release_res( &res );
+
+    // models of the previous map that this one does not use
+    unload_unused_models();
 }
 
 #if defined( _WIN32 ) and RELEASE
@@ -774,6 +2087,9 @@ int main()
 {
     INFO_LOG( "meow" );
 
+    // packed resources, loose files are used without it
+    mount_archive( "res.pak" );
+
     hardware_init();
 
     render_init();
@@ -786,9 +2102,19 @@ int main()
 
     hardware_set_loop( loop );
 
+    file_watch_shutdown();
+
+    model_loader_shutdown();
+
+    texture_loader_shutdown();
+
+    catalog_shutdown();
+
     write_map();
 
     hardware_destroy();
 
+    unmount_archive();
+
     return 0;
 }
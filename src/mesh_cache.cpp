@@ -0,0 +1,424 @@
+#include "mesh_cache.hpp"
+#include "logging.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( __unix__ ) && !defined( __EMSCRIPTEN__ )
+#define MESH_CACHE_ENABLED 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define MESH_CACHE_ENABLED 0
+#endif
+
+#define MESH_CACHE_VERSION     3
+#define MESH_CACHE_NAME_LENGTH 64
+#define MESH_CACHE_ALIGN       16
+#define MAX_PATH_LENGTH        1024
+
+#if MESH_CACHE_ENABLED
+
+/// layout:
+///   header
+///   pos    [ vertex_count * 3 ] float
+///   normal [ vertex_count * 3 ] float
+///   uv     [ vertex_count * 2 ] float
+///   index  [ index_count ] uint32
+///   obj    [ obj_count ] int32 offsets, [ obj_count ] names
+///   group  [ material_group_count ] int32 offsets, [ ... ] names
+/// every section starts on a MESH_CACHE_ALIGN boundary.
+struct header_t {
+    char magic[ 4 ];
+    uint32_t version;
+
+    // source stamp
+    int64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+
+    int32_t vertex_count;
+    int32_t index_count;
+    int32_t obj_count;
+    int32_t material_group_count;
+
+    uint32_t optimized; // optimize_wavefront ran before the write
+
+    float bounds_min[ 3 ];
+    float bounds_max[ 3 ];
+
+    int64_t pos_offset;
+    int64_t normal_offset;
+    int64_t uv_offset;
+    int64_t index_offset;
+    int64_t obj_offset;
+    int64_t material_group_offset;
+
+    char material_lib_filename[ MESH_CACHE_NAME_LENGTH ];
+};
+
+static const char magic[ 4 ] = { 'M', 'W', 'M', 'C' };
+
+static int64_t align( int64_t offset )
+{
+    int64_t mask = MESH_CACHE_ALIGN - 1;
+    return ( offset + mask ) & ~mask;
+}
+
+static int64_t name_section_size( int count )
+{
+    return (int64_t) count * ( 4 + MESH_CACHE_NAME_LENGTH );
+}
+
+/// "foo.obj" -> "../../res/foo.mesh"
+static int cache_path( char * out_path, const char * res_name )
+{
+    if ( res_path( out_path, MAX_PATH_LENGTH - 8, res_name ) ) {
+        return 1;
+    }
+
+    int len = strlen( out_path );
+    if ( len > 4 && strcmp( out_path + len - 4, ".obj" ) == 0 ) {
+        len -= 4;
+    }
+
+    strcpy( out_path + len, ".mesh" );
+
+    return 0;
+}
+
+static int stamp_source( header_t * header, const char * res_name )
+{
+    res_stamp_t stamp;
+    if ( stamp_res( &stamp, res_name ) ) return 1;
+
+    header->source_size = stamp.size;
+    header->source_mtime_sec = stamp.mtime_sec;
+    header->source_mtime_nsec = stamp.mtime_nsec;
+
+    return 0;
+}
+
+static int section_fits( int64_t offset, int64_t size, int64_t file_size )
+{
+    return offset >= (int64_t) sizeof( header_t ) && size >= 0 &&
+           offset + size <= file_size;
+}
+
+static int validate( header_t * header, header_t * stamp, int64_t size )
+{
+    if ( memcmp( header->magic, magic, 4 ) != 0 ) return 1;
+    if ( header->version != MESH_CACHE_VERSION ) return 1;
+
+    if ( header->source_size != stamp->source_size ) return 1;
+    if ( header->source_mtime_sec != stamp->source_mtime_sec ) return 1;
+    if ( header->source_mtime_nsec != stamp->source_mtime_nsec ) return 1;
+    if ( header->optimized != stamp->optimized ) return 1;
+
+    int64_t vertex_size = (int64_t) header->vertex_count * 4;
+    int64_t index_size = (int64_t) header->index_count * 4;
+    int64_t obj_size = name_section_size( header->obj_count );
+    int64_t group_size = name_section_size( header->material_group_count );
+
+    if ( !section_fits( header->pos_offset, vertex_size * 3, size ) ||
+         !section_fits( header->normal_offset, vertex_size * 3, size ) ||
+         !section_fits( header->uv_offset, vertex_size * 2, size ) ||
+         !section_fits( header->index_offset, index_size, size ) ||
+         !section_fits( header->obj_offset, obj_size, size ) ||
+         !section_fits( header->material_group_offset, group_size, size ) ) {
+        return 1;
+    }
+
+    // a truncated write could leave indices pointing past the vertices
+    uint32_t * index_list =
+        (uint32_t *) ( (char *) header + header->index_offset );
+    for ( int i = 0; i < header->index_count; i++ ) {
+        if ( index_list[ i ] >= (uint32_t) header->vertex_count ) return 1;
+    }
+
+    return 0;
+}
+
+static const char ** map_names( char * section, int count )
+{
+    const char ** name_list = new const char *[ count ];
+
+    char * names = section + count * 4;
+    for ( int i = 0; i < count; i++ ) {
+        name_list[ i ] = names + i * MESH_CACHE_NAME_LENGTH;
+    }
+
+    return name_list;
+}
+
+int load_mesh_cache(
+    mesh_cache_t * out,
+    const char * res_name,
+    bool optimized
+)
+{
+    memset( out, 0, sizeof( mesh_cache_t ) );
+
+    header_t stamp;
+    if ( stamp_source( &stamp, res_name ) ) return 1;
+    stamp.optimized = optimized;
+
+    char path[ MAX_PATH_LENGTH ];
+    if ( cache_path( path, res_name ) ) return 1;
+
+    int fd = open( path, O_RDONLY );
+    if ( fd < 0 ) return 1;
+
+    struct stat st;
+    if ( fstat( fd, &st ) || st.st_size < (off_t) sizeof( header_t ) ) {
+        close( fd );
+        return 1;
+    }
+
+    // private + writable so the lists can be handed out as non-const, the
+    // pages are only copied if someone actually writes to them
+    void * map = mmap(
+        nullptr,
+        st.st_size,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE,
+        fd,
+        0
+    );
+    close( fd );
+
+    if ( map == MAP_FAILED ) return 1;
+
+    header_t * header = (header_t *) map;
+    if ( validate( header, &stamp, st.st_size ) ) {
+        INFO_LOG( "stale mesh cache: %s", path );
+        munmap( map, st.st_size );
+        return 1;
+    }
+
+    char * base = (char *) map;
+    wavefront_t * mesh = &out->mesh;
+
+    mesh->pos_list = (float *) ( base + header->pos_offset );
+    mesh->normal_list = (float *) ( base + header->normal_offset );
+    mesh->uv_list = (float *) ( base + header->uv_offset );
+    mesh->vertex_count = header->vertex_count;
+
+    mesh->index_list = (unsigned int *) ( base + header->index_offset );
+    mesh->index_count = header->index_count;
+
+    mesh->obj_offset_list = (int *) ( base + header->obj_offset );
+    mesh->obj_name_list =
+        map_names( base + header->obj_offset, header->obj_count );
+    mesh->obj_count = header->obj_count;
+
+    header->material_lib_filename[ MESH_CACHE_NAME_LENGTH - 1 ] = '\0';
+    mesh->material_lib_filename = header->material_lib_filename;
+    if ( mesh->material_lib_filename[ 0 ] == '\0' ) {
+        mesh->material_lib_filename = nullptr;
+    }
+
+    mesh->material_group_offset_list =
+        (int *) ( base + header->material_group_offset );
+    mesh->material_group_material_list = map_names(
+        base + header->material_group_offset,
+        header->material_group_count
+    );
+    mesh->material_group_count = header->material_group_count;
+
+    memcpy( out->bounds_min, header->bounds_min, sizeof( float ) * 3 );
+    memcpy( out->bounds_max, header->bounds_max, sizeof( float ) * 3 );
+
+    out->map = map;
+    out->map_size = st.st_size;
+
+    return 0;
+}
+
+static void write_padding( FILE * file, int64_t * offset )
+{
+    static const char zero[ MESH_CACHE_ALIGN ] = {};
+
+    int64_t aligned = align( *offset );
+    fwrite( zero, 1, aligned - *offset, file );
+    *offset = aligned;
+}
+
+static int64_t write_section(
+    FILE * file,
+    int64_t * offset,
+    void * data,
+    int64_t size
+)
+{
+    write_padding( file, offset );
+
+    int64_t start = *offset;
+    fwrite( data, 1, size, file );
+    *offset += size;
+
+    return start;
+}
+
+static int64_t write_names(
+    FILE * file,
+    int64_t * offset,
+    int * offset_list,
+    const char ** name_list,
+    int count
+)
+{
+    write_padding( file, offset );
+
+    int64_t start = *offset;
+    fwrite( offset_list, 4, count, file );
+
+    for ( int i = 0; i < count; i++ ) {
+        char name[ MESH_CACHE_NAME_LENGTH ] = {};
+        strncpy( name, name_list[ i ], MESH_CACHE_NAME_LENGTH - 1 );
+        fwrite( name, 1, MESH_CACHE_NAME_LENGTH, file );
+    }
+
+    *offset += name_section_size( count );
+
+    return start;
+}
+
+int save_mesh_cache(
+    const char * res_name,
+    wavefront_t * mesh,
+    bool optimized
+)
+{
+    header_t header;
+    memset( &header, 0, sizeof( header_t ) );
+
+    if ( stamp_source( &header, res_name ) ) return 1;
+
+    char path[ MAX_PATH_LENGTH ];
+    if ( cache_path( path, res_name ) ) return 1;
+
+    // write to a temporary and rename, so a crash never leaves a torn cache,
+    // named uniquely since the catalog and the loader can both write one
+    char temp_path[ MAX_PATH_LENGTH + 8 ];
+    snprintf( temp_path, MAX_PATH_LENGTH + 8, "%s.XXXXXX", path );
+
+    int fd = mkstemp( temp_path );
+    FILE * file = fd >= 0 ? fdopen( fd, "wb" ) : nullptr;
+    if ( !file ) {
+        ERROR_LOG( "failed to write mesh cache: %s", path );
+        if ( fd >= 0 ) {
+            close( fd );
+            remove( temp_path );
+        }
+        return 1;
+    }
+
+    memcpy( header.magic, magic, 4 );
+    header.version = MESH_CACHE_VERSION;
+    header.optimized = optimized;
+    header.vertex_count = mesh->vertex_count;
+    header.index_count = mesh->index_count;
+    header.obj_count = mesh->obj_count;
+    header.material_group_count = mesh->material_group_count;
+    mesh->compute_bounds( header.bounds_min, header.bounds_max );
+
+    if ( mesh->material_lib_filename ) {
+        strncpy(
+            header.material_lib_filename,
+            mesh->material_lib_filename,
+            MESH_CACHE_NAME_LENGTH - 1
+        );
+    }
+
+    // header is written twice, the second time with the section offsets
+    fwrite( &header, sizeof( header_t ), 1, file );
+    int64_t offset = sizeof( header_t );
+
+    int64_t vertex_count = mesh->vertex_count;
+
+    header.pos_offset =
+        write_section( file, &offset, mesh->pos_list, vertex_count * 3 * 4 );
+    header.normal_offset =
+        write_section( file, &offset, mesh->normal_list, vertex_count * 3 * 4 );
+    header.uv_offset =
+        write_section( file, &offset, mesh->uv_list, vertex_count * 2 * 4 );
+    header.index_offset = write_section(
+        file,
+        &offset,
+        mesh->index_list,
+        (int64_t) mesh->index_count * 4
+    );
+    header.obj_offset = write_names(
+        file,
+        &offset,
+        mesh->obj_offset_list,
+        mesh->obj_name_list,
+        mesh->obj_count
+    );
+    header.material_group_offset = write_names(
+        file,
+        &offset,
+        mesh->material_group_offset_list,
+        mesh->material_group_material_list,
+        mesh->material_group_count
+    );
+
+    fseek( file, 0, SEEK_SET );
+    fwrite( &header, sizeof( header_t ), 1, file );
+
+    int failed = ferror( file );
+    failed |= fclose( file );
+
+    if ( failed || rename( temp_path, path ) ) {
+        ERROR_LOG( "failed to write mesh cache: %s", path );
+        remove( temp_path );
+        return 1;
+    }
+
+    return 0;
+}
+
+void mesh_cache_free( mesh_cache_t * cache )
+{
+    if ( cache->map ) {
+        munmap( cache->map, cache->map_size );
+    }
+
+    delete[] cache->mesh.obj_name_list;
+    delete[] cache->mesh.material_group_material_list;
+
+    memset( cache, 0, sizeof( mesh_cache_t ) );
+}
+
+#else
+
+int load_mesh_cache(
+    mesh_cache_t * out,
+    const char * res_name,
+    bool optimized
+)
+{
+    memset( out, 0, sizeof( mesh_cache_t ) );
+    return 1;
+}
+
+int save_mesh_cache(
+    const char * res_name,
+    wavefront_t * mesh,
+    bool optimized
+)
+{
+    return 1;
+}
+
+void mesh_cache_free( mesh_cache_t * cache )
+{
+    memset( cache, 0, sizeof( mesh_cache_t ) );
+}
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "wavefront.hpp"
+
+/// binary copy of a parsed wavefront, stored next to the source as
+/// <name>.mesh and memory mapped on load. the mesh lists point straight into
+/// the mapping, so they are only valid until mesh_cache_free.
+struct mesh_cache_t {
+    wavefront_t mesh;
+
+    float bounds_min[ 3 ];
+    float bounds_max[ 3 ];
+
+    void * map;
+    long map_size;
+};
+
+/// loads the cache of the resource, fails if there is none, if the source
+/// has changed (size or mtime) since it was written or if it was written
+/// with optimization the other way. always fails on web.
+/// @threadsafe
+int load_mesh_cache(
+    mesh_cache_t * out_cache,
+    const char * res_name,
+    bool optimized
+);
+
+/// writes the cache of the resource from a freshly loaded mesh, optimized
+/// if optimize_wavefront ran on it
+/// @threadsafe
+int save_mesh_cache(
+    const char * res_name,
+    wavefront_t * mesh,
+    bool optimized
+);
+
+void mesh_cache_free( mesh_cache_t * cache );
@@ -0,0 +1,1222 @@
+#include "mesh_opt.hpp"
+
+#include "logging.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+float compute_acmr(
+    unsigned int * index_list,
+    int index_count,
+    int vertex_count
+)
+{
+    if ( index_count < 3 ) return 0.0f;
+
+    int k = MESH_OPT_CACHE_SIZE;
+
+    int * stamp_list = new int[ vertex_count ];
+    memset( stamp_list, 0, sizeof( int ) * vertex_count );
+
+    int time = k + 1;
+    int miss_count = 0;
+
+    for ( int i = 0; i < index_count; i++ ) {
+        unsigned int v = index_list[ i ];
+        if ( time - stamp_list[ v ] > k ) {
+            stamp_list[ v ] = time++;
+            miss_count++;
+        }
+    }
+
+    delete[] stamp_list;
+
+    return (float) miss_count / ( index_count / 3 );
+}
+
+// tipsify [begin] /////////////////////////////////////////////////////////////
+
+/// Sander, Nehab, Barczak - Fast Triangle Reordering for Vertex Locality and
+/// Reduced Overdraw (2007)
+struct tipsify_t {
+    // vertex -> triangle adjacency (csr)
+    int * adj_offset_list;
+    int * adj_list;
+
+    int * live_list;  // unemitted triangles per vertex
+    int * stamp_list; // cache time stamps
+    bool * emitted_list;
+
+    int * dead_end_list; // recently emitted vertices
+    int dead_end_count;
+
+    int * candidate_list;
+    int candidate_count;
+
+    int cursor; // input scan position, for when everything else is dead
+    int time;
+};
+
+static int skip_dead_end( tipsify_t * t, unsigned int * index_list, int count )
+{
+    while ( t->dead_end_count > 0 ) {
+        int v = t->dead_end_list[ --t->dead_end_count ];
+        if ( t->live_list[ v ] > 0 ) return v;
+    }
+
+    while ( t->cursor < count ) {
+        int v = index_list[ t->cursor++ ];
+        if ( t->live_list[ v ] > 0 ) return v;
+    }
+
+    return -1;
+}
+
+static int next_candidate( tipsify_t * t )
+{
+    int k = MESH_OPT_CACHE_SIZE;
+
+    int best = -1;
+    int best_priority = -1;
+
+    for ( int i = 0; i < t->candidate_count; i++ ) {
+        int v = t->candidate_list[ i ];
+        if ( t->live_list[ v ] == 0 ) continue;
+
+        // prefer vertices that stay in the cache while their fan is emitted
+        int age = t->time - t->stamp_list[ v ];
+        int priority = 0;
+        if ( age + 2 * t->live_list[ v ] <= k ) {
+            priority = age;
+        }
+
+        if ( priority > best_priority ) {
+            best_priority = priority;
+            best = v;
+        }
+    }
+
+    return best;
+}
+
+/// writes the reordered triangles to out_list and the first triangle of each
+/// cluster (a cache restart) to cluster_list. returns the cluster count.
+static int tipsify(
+    unsigned int * out_list,
+    int * cluster_list,
+    unsigned int * index_list,
+    int index_count,
+    int vertex_count
+)
+{
+    int k = MESH_OPT_CACHE_SIZE;
+    int triangle_count = index_count / 3;
+
+    tipsify_t t;
+    t.adj_offset_list = new int[ vertex_count + 1 ];
+    t.adj_list = new int[ index_count ];
+    t.live_list = new int[ vertex_count ];
+    t.stamp_list = new int[ vertex_count ];
+    t.emitted_list = new bool[ triangle_count ];
+    t.dead_end_list = new int[ index_count ];
+    t.candidate_list = new int[ index_count ];
+    t.dead_end_count = 0;
+    t.candidate_count = 0;
+    t.cursor = 0;
+    t.time = k + 1;
+
+    memset( t.live_list, 0, sizeof( int ) * vertex_count );
+    memset( t.stamp_list, 0, sizeof( int ) * vertex_count );
+    memset( t.emitted_list, 0, sizeof( bool ) * triangle_count );
+
+    for ( int i = 0; i < index_count; i++ ) {
+        t.live_list[ index_list[ i ] ]++;
+    }
+
+    int offset = 0;
+    for ( int v = 0; v < vertex_count; v++ ) {
+        t.adj_offset_list[ v ] = offset;
+        offset += t.live_list[ v ];
+    }
+    t.adj_offset_list[ vertex_count ] = offset;
+
+    // fill using the stamps as write cursors, reset afterwards
+    for ( int i = 0; i < index_count; i++ ) {
+        int v = index_list[ i ];
+        t.adj_list[ t.adj_offset_list[ v ] + t.stamp_list[ v ]++ ] = i / 3;
+    }
+    memset( t.stamp_list, 0, sizeof( int ) * vertex_count );
+
+    int out_count = 0;
+    int cluster_count = 0;
+
+    int fan = skip_dead_end( &t, index_list, index_count );
+    if ( fan >= 0 ) cluster_list[ cluster_count++ ] = 0;
+
+    while ( fan >= 0 ) {
+        t.candidate_count = 0;
+
+        int adj_begin = t.adj_offset_list[ fan ];
+        int adj_end = t.adj_offset_list[ fan + 1 ];
+
+        for ( int a = adj_begin; a < adj_end; a++ ) {
+            int tri = t.adj_list[ a ];
+            if ( t.emitted_list[ tri ] ) continue;
+
+            for ( int c = 0; c < 3; c++ ) {
+                int v = index_list[ tri * 3 + c ];
+
+                out_list[ out_count++ ] = v;
+                t.dead_end_list[ t.dead_end_count++ ] = v;
+                t.candidate_list[ t.candidate_count++ ] = v;
+                t.live_list[ v ]--;
+
+                if ( t.time - t.stamp_list[ v ] > k ) {
+                    t.stamp_list[ v ] = t.time++;
+                }
+            }
+
+            t.emitted_list[ tri ] = true;
+        }
+
+        fan = next_candidate( &t );
+        if ( fan < 0 ) {
+            fan = skip_dead_end( &t, index_list, index_count );
+            if ( fan >= 0 ) cluster_list[ cluster_count++ ] = out_count / 3;
+        }
+    }
+
+    delete[] t.adj_offset_list;
+    delete[] t.adj_list;
+    delete[] t.live_list;
+    delete[] t.stamp_list;
+    delete[] t.emitted_list;
+    delete[] t.dead_end_list;
+    delete[] t.candidate_list;
+
+    return cluster_count;
+}
+
+// tipsify [end] ///////////////////////////////////////////////////////////////
+
+// overdraw [begin] ////////////////////////////////////////////////////////////
+
+struct cluster_t {
+    int first; // triangle
+    int count;
+    float sort_key;
+};
+
+static int compare_cluster( const void * a, const void * b )
+{
+    const cluster_t * ca = (const cluster_t *) a;
+    const cluster_t * cb = (const cluster_t *) b;
+
+    // descending, ties keep cache order
+    if ( ca->sort_key > cb->sort_key ) return -1;
+    if ( ca->sort_key < cb->sort_key ) return 1;
+    return ca->first - cb->first;
+}
+
+/// area weighted centroid and normal of a run of triangles
+static float accumulate_triangles(
+    float * out_centroid,
+    float * out_normal,
+    unsigned int * index_list,
+    int first,
+    int count,
+    float * pos_list
+)
+{
+    float area_sum = 0.0f;
+
+    for ( int i = first; i < first + count; i++ ) {
+        float * a = pos_list + index_list[ i * 3 + 0 ] * 3;
+        float * b = pos_list + index_list[ i * 3 + 1 ] * 3;
+        float * c = pos_list + index_list[ i * 3 + 2 ] * 3;
+
+        float ab[ 3 ] = { b[ 0 ] - a[ 0 ], b[ 1 ] - a[ 1 ], b[ 2 ] - a[ 2 ] };
+        float ac[ 3 ] = { c[ 0 ] - a[ 0 ], c[ 1 ] - a[ 1 ], c[ 2 ] - a[ 2 ] };
+
+        float n[ 3 ] = {
+            ab[ 1 ] * ac[ 2 ] - ab[ 2 ] * ac[ 1 ],
+            ab[ 2 ] * ac[ 0 ] - ab[ 0 ] * ac[ 2 ],
+            ab[ 0 ] * ac[ 1 ] - ab[ 1 ] * ac[ 0 ],
+        };
+
+        float area =
+            sqrtf( n[ 0 ] * n[ 0 ] + n[ 1 ] * n[ 1 ] + n[ 2 ] * n[ 2 ] );
+
+        for ( int j = 0; j < 3; j++ ) {
+            out_centroid[ j ] += ( a[ j ] + b[ j ] + c[ j ] ) * area;
+            out_normal[ j ] += n[ j ];
+        }
+
+        area_sum += area;
+    }
+
+    return area_sum;
+}
+
+/// sorts clusters so the ones facing away from the mesh center come first,
+/// those tend to occlude the rest
+static void sort_clusters(
+    unsigned int * index_list,
+    int index_count,
+    int * cluster_start_list,
+    int cluster_count,
+    float * pos_list
+)
+{
+    if ( cluster_count < 2 ) return;
+
+    int triangle_count = index_count / 3;
+
+    float center[ 3 ] = { 0.0f, 0.0f, 0.0f };
+    float unused[ 3 ] = { 0.0f, 0.0f, 0.0f };
+    float area = accumulate_triangles(
+        center,
+        unused,
+        index_list,
+        0,
+        triangle_count,
+        pos_list
+    );
+    if ( area <= 0.0f ) return;
+
+    for ( int j = 0; j < 3; j++ ) {
+        center[ j ] /= area * 3.0f;
+    }
+
+    cluster_t * cluster_list = new cluster_t[ cluster_count ];
+
+    for ( int i = 0; i < cluster_count; i++ ) {
+        cluster_t * c = cluster_list + i;
+        c->first = cluster_start_list[ i ];
+        c->count = ( i + 1 < cluster_count ? cluster_start_list[ i + 1 ]
+                                           : triangle_count ) -
+                   c->first;
+
+        float centroid[ 3 ] = { 0.0f, 0.0f, 0.0f };
+        float normal[ 3 ] = { 0.0f, 0.0f, 0.0f };
+        float cluster_area = accumulate_triangles(
+            centroid,
+            normal,
+            index_list,
+            c->first,
+            c->count,
+            pos_list
+        );
+
+        c->sort_key = 0.0f;
+        if ( cluster_area <= 0.0f ) continue;
+
+        float length = sqrtf(
+            normal[ 0 ] * normal[ 0 ] + normal[ 1 ] * normal[ 1 ] +
+            normal[ 2 ] * normal[ 2 ]
+        );
+        if ( length <= 0.0f ) continue;
+
+        for ( int j = 0; j < 3; j++ ) {
+            float offset = centroid[ j ] / ( cluster_area * 3.0f );
+            offset -= center[ j ];
+            c->sort_key += offset * normal[ j ] / length;
+        }
+    }
+
+    qsort( cluster_list, cluster_count, sizeof( cluster_t ), compare_cluster );
+
+    unsigned int * temp_list = new unsigned int[ index_count ];
+    memcpy( temp_list, index_list, sizeof( unsigned int ) * index_count );
+
+    int out = 0;
+    for ( int i = 0; i < cluster_count; i++ ) {
+        int first = cluster_list[ i ].first * 3;
+        int count = cluster_list[ i ].count * 3;
+        memcpy(
+            index_list + out,
+            temp_list + first,
+            sizeof( unsigned int ) * count
+        );
+        out += count;
+    }
+
+    delete[] temp_list;
+    delete[] cluster_list;
+}
+
+// overdraw [end] //////////////////////////////////////////////////////////////
+
+// simplify [begin] ////////////////////////////////////////////////////////////
+
+/// Garland, Heckbert - Surface Simplification Using Quadric Error Metrics
+/// (1997). symmetric 4x4, area weighted.
+struct quadric_t {
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+    double weight;
+};
+
+struct collapse_t {
+    float cost;
+    int from;
+    int to;
+};
+
+static void quadric_add_plane(
+    quadric_t * q,
+    double a,
+    double b,
+    double c,
+    double d,
+    double weight
+)
+{
+    q->a2 += a * a * weight;
+    q->ab += a * b * weight;
+    q->ac += a * c * weight;
+    q->ad += a * d * weight;
+    q->b2 += b * b * weight;
+    q->bc += b * c * weight;
+    q->bd += b * d * weight;
+    q->c2 += c * c * weight;
+    q->cd += c * d * weight;
+    q->d2 += d * d * weight;
+    q->weight += weight;
+}
+
+static void quadric_add( quadric_t * q, quadric_t * other )
+{
+    q->a2 += other->a2;
+    q->ab += other->ab;
+    q->ac += other->ac;
+    q->ad += other->ad;
+    q->b2 += other->b2;
+    q->bc += other->bc;
+    q->bd += other->bd;
+    q->c2 += other->c2;
+    q->cd += other->cd;
+    q->d2 += other->d2;
+    q->weight += other->weight;
+}
+
+/// mean squared distance of p to the planes of q
+static float quadric_error( quadric_t * q, float * p )
+{
+    double x = p[ 0 ];
+    double y = p[ 1 ];
+    double z = p[ 2 ];
+
+    double e = q->a2 * x * x + 2 * q->ab * x * y + 2 * q->ac * x * z +
+               2 * q->ad * x + q->b2 * y * y + 2 * q->bc * y * z +
+               2 * q->bd * y + q->c2 * z * z + 2 * q->cd * z + q->d2;
+
+    if ( q->weight <= 0.0 ) return 0.0f;
+
+    e /= q->weight;
+
+    return e < 0.0 ? 0.0f : (float) e;
+}
+
+static void triangle_normal( float * out, float * a, float * b, float * c )
+{
+    float ab[ 3 ] = { b[ 0 ] - a[ 0 ], b[ 1 ] - a[ 1 ], b[ 2 ] - a[ 2 ] };
+    float ac[ 3 ] = { c[ 0 ] - a[ 0 ], c[ 1 ] - a[ 1 ], c[ 2 ] - a[ 2 ] };
+
+    out[ 0 ] = ab[ 1 ] * ac[ 2 ] - ab[ 2 ] * ac[ 1 ];
+    out[ 1 ] = ab[ 2 ] * ac[ 0 ] - ab[ 0 ] * ac[ 2 ];
+    out[ 2 ] = ab[ 0 ] * ac[ 1 ] - ab[ 1 ] * ac[ 0 ];
+}
+
+static float dot3( float * a, float * b )
+{
+    return a[ 0 ] * b[ 0 ] + a[ 1 ] * b[ 1 ] + a[ 2 ] * b[ 2 ];
+}
+
+static int compare_collapse( const void * a, const void * b )
+{
+    float ca = ( (const collapse_t *) a )->cost;
+    float cb = ( (const collapse_t *) b )->cost;
+
+    return ca < cb ? -1 : ( ca > cb ? 1 : 0 );
+}
+
+static int compare_u64( const void * a, const void * b )
+{
+    uint64_t ka = *(const uint64_t *) a;
+    uint64_t kb = *(const uint64_t *) b;
+
+    return ka < kb ? -1 : ( ka > kb ? 1 : 0 );
+}
+
+static uint32_t hash_pos( float * p )
+{
+    uint32_t h[ 3 ];
+    memcpy( h, p, sizeof( h ) );
+
+    return ( h[ 0 ] * 73856093u ) ^ ( h[ 1 ] * 19349663u ) ^
+           ( h[ 2 ] * 83492791u );
+}
+
+/// vertices that only differ in normal / uv share a position id
+static int weld_positions( int * out_pid_list, float * pos_list, int count )
+{
+    int table_size = 1;
+    while ( table_size < count * 2 ) table_size *= 2;
+
+    int * table = new int[ table_size ];
+    memset( table, -1, sizeof( int ) * table_size );
+
+    int pid_count = 0;
+
+    for ( int v = 0; v < count; v++ ) {
+        float * p = pos_list + v * 3;
+        uint32_t slot = hash_pos( p ) & ( table_size - 1 );
+
+        while ( true ) {
+            int other = table[ slot ];
+            if ( other < 0 ) {
+                table[ slot ] = v;
+                out_pid_list[ v ] = pid_count++;
+                break;
+            }
+            if ( memcmp( pos_list + other * 3, p, sizeof( float ) * 3 ) == 0 ) {
+                out_pid_list[ v ] = out_pid_list[ other ];
+                break;
+            }
+            slot = ( slot + 1 ) & ( table_size - 1 );
+        }
+    }
+
+    delete[] table;
+
+    return pid_count;
+}
+
+struct simplify_t {
+    int * tri_list; // position ids, 3 per triangle
+    int tri_count;
+
+    float * pos_list; // per position id
+    quadric_t * quadric_list;
+    int * collapse_list; // position id a position was collapsed into
+    int pid_count;
+
+    // position -> triangle adjacency (csr), rebuilt every pass
+    int * adj_offset_list;
+    int * adj_list;
+};
+
+static int find_pid( simplify_t * s, int p )
+{
+    while ( s->collapse_list[ p ] != p ) p = s->collapse_list[ p ];
+    return p;
+}
+
+static void build_adjacency( simplify_t * s )
+{
+    memset( s->adj_offset_list, 0, sizeof( int ) * ( s->pid_count + 1 ) );
+
+    for ( int i = 0; i < s->tri_count * 3; i++ ) {
+        s->adj_offset_list[ s->tri_list[ i ] + 1 ]++;
+    }
+    for ( int p = 0; p < s->pid_count; p++ ) {
+        s->adj_offset_list[ p + 1 ] += s->adj_offset_list[ p ];
+    }
+
+    int * cursor_list = new int[ s->pid_count ];
+    memcpy( cursor_list, s->adj_offset_list, sizeof( int ) * s->pid_count );
+
+    for ( int i = 0; i < s->tri_count * 3; i++ ) {
+        s->adj_list[ cursor_list[ s->tri_list[ i ] ]++ ] = i / 3;
+    }
+
+    delete[] cursor_list;
+}
+
+static void add_plane_quadrics( simplify_t * s )
+{
+    for ( int t = 0; t < s->tri_count; t++ ) {
+        int * tri = s->tri_list + t * 3;
+        float n[ 3 ];
+        triangle_normal(
+            n,
+            s->pos_list + tri[ 0 ] * 3,
+            s->pos_list + tri[ 1 ] * 3,
+            s->pos_list + tri[ 2 ] * 3
+        );
+
+        float length = sqrtf( dot3( n, n ) );
+        if ( length <= 0.0f ) continue;
+
+        float a = n[ 0 ] / length;
+        float b = n[ 1 ] / length;
+        float c = n[ 2 ] / length;
+        float d = -( a * s->pos_list[ tri[ 0 ] * 3 + 0 ] +
+                     b * s->pos_list[ tri[ 0 ] * 3 + 1 ] +
+                     c * s->pos_list[ tri[ 0 ] * 3 + 2 ] );
+
+        for ( int i = 0; i < 3; i++ ) {
+            quadric_add_plane(
+                s->quadric_list + tri[ i ],
+                a,
+                b,
+                c,
+                d,
+                length * 0.5f
+            );
+        }
+    }
+}
+
+/// open edges get a plane perpendicular to their triangle so borders don't
+/// shrink away
+static void add_border_quadrics( simplify_t * s )
+{
+    int edge_count = s->tri_count * 3;
+    uint64_t * key_list = new uint64_t[ edge_count ];
+
+    for ( int t = 0; t < s->tri_count; t++ ) {
+        for ( int i = 0; i < 3; i++ ) {
+            uint64_t a = s->tri_list[ t * 3 + i ];
+            uint64_t b = s->tri_list[ t * 3 + ( i + 1 ) % 3 ];
+            uint64_t lo = a < b ? a : b;
+            uint64_t hi = a < b ? b : a;
+            key_list[ t * 3 + i ] = ( lo << 32 ) | hi;
+        }
+    }
+
+    uint64_t * sorted_list = new uint64_t[ edge_count ];
+    memcpy( sorted_list, key_list, sizeof( uint64_t ) * edge_count );
+    qsort( sorted_list, edge_count, sizeof( uint64_t ), compare_u64 );
+
+    for ( int e = 0; e < edge_count; e++ ) {
+        uint64_t * found = (uint64_t *) bsearch(
+            key_list + e,
+            sorted_list,
+            edge_count,
+            sizeof( uint64_t ),
+            compare_u64
+        );
+
+        // shared when a neighbour in the sorted list has the same key
+        int index = found - sorted_list;
+        while ( index > 0 && sorted_list[ index - 1 ] == key_list[ e ] ) {
+            index--;
+        }
+        bool shared = index + 1 < edge_count &&
+                      sorted_list[ index + 1 ] == key_list[ e ];
+        if ( shared ) continue;
+
+        int t = e / 3;
+        int i = e % 3;
+        int * tri = s->tri_list + t * 3;
+        float * pa = s->pos_list + tri[ i ] * 3;
+        float * pb = s->pos_list + tri[ ( i + 1 ) % 3 ] * 3;
+        float * pc = s->pos_list + tri[ ( i + 2 ) % 3 ] * 3;
+
+        float n[ 3 ];
+        triangle_normal( n, pa, pb, pc );
+
+        float edge[ 3 ] = {
+            pb[ 0 ] - pa[ 0 ],
+            pb[ 1 ] - pa[ 1 ],
+            pb[ 2 ] - pa[ 2 ],
+        };
+        float plane[ 3 ] = {
+            edge[ 1 ] * n[ 2 ] - edge[ 2 ] * n[ 1 ],
+            edge[ 2 ] * n[ 0 ] - edge[ 0 ] * n[ 2 ],
+            edge[ 0 ] * n[ 1 ] - edge[ 1 ] * n[ 0 ],
+        };
+
+        float length = sqrtf( dot3( plane, plane ) );
+        if ( length <= 0.0f ) continue;
+
+        float a = plane[ 0 ] / length;
+        float b = plane[ 1 ] / length;
+        float c = plane[ 2 ] / length;
+        float d = -( a * pa[ 0 ] + b * pa[ 1 ] + c * pa[ 2 ] );
+        float weight = dot3( edge, edge ) * 10.0f;
+
+        quadric_add_plane( s->quadric_list + tri[ i ], a, b, c, d, weight );
+        quadric_add_plane(
+            s->quadric_list + tri[ ( i + 1 ) % 3 ],
+            a,
+            b,
+            c,
+            d,
+            weight
+        );
+    }
+
+    delete[] key_list;
+    delete[] sorted_list;
+}
+
+/// moving from onto to must not flip any remaining triangle around from
+static bool collapse_flips( simplify_t * s, int from, int to )
+{
+    float * target = s->pos_list + to * 3;
+
+    int adj_begin = s->adj_offset_list[ from ];
+    int adj_end = s->adj_offset_list[ from + 1 ];
+
+    for ( int a = adj_begin; a < adj_end; a++ ) {
+        int * tri = s->tri_list + s->adj_list[ a ] * 3;
+        if ( tri[ 0 ] == to || tri[ 1 ] == to || tri[ 2 ] == to ) continue;
+
+        float * p[ 3 ];
+        float * q[ 3 ];
+        for ( int i = 0; i < 3; i++ ) {
+            p[ i ] = s->pos_list + tri[ i ] * 3;
+            q[ i ] = tri[ i ] == from ? target : p[ i ];
+        }
+
+        float before[ 3 ];
+        float after[ 3 ];
+        triangle_normal( before, p[ 0 ], p[ 1 ], p[ 2 ] );
+        triangle_normal( after, q[ 0 ], q[ 1 ], q[ 2 ] );
+
+        if ( dot3( before, after ) <= 0.0f ) return true;
+    }
+
+    return false;
+}
+
+/// one round of independent collapses, cheapest first. returns the number of
+/// triangles that became degenerate.
+static int collapse_pass(
+    simplify_t * s,
+    collapse_t * collapse_list,
+    bool * touched_list,
+    int target_tri_count,
+    float * max_error
+)
+{
+    build_adjacency( s );
+
+    int collapse_count = 0;
+    for ( int t = 0; t < s->tri_count; t++ ) {
+        for ( int i = 0; i < 3; i++ ) {
+            int a = s->tri_list[ t * 3 + i ];
+            int b = s->tri_list[ t * 3 + ( i + 1 ) % 3 ];
+
+            quadric_t q = s->quadric_list[ a ];
+            quadric_add( &q, s->quadric_list + b );
+
+            float cost_ab = quadric_error( &q, s->pos_list + b * 3 );
+            float cost_ba = quadric_error( &q, s->pos_list + a * 3 );
+
+            collapse_t * c = collapse_list + collapse_count++;
+            c->cost = cost_ab <= cost_ba ? cost_ab : cost_ba;
+            c->from = cost_ab <= cost_ba ? a : b;
+            c->to = cost_ab <= cost_ba ? b : a;
+        }
+    }
+
+    qsort(
+        collapse_list,
+        collapse_count,
+        sizeof( collapse_t ),
+        compare_collapse
+    );
+
+    memset( touched_list, 0, sizeof( bool ) * s->pid_count );
+
+    int removed = 0;
+    int tri_count = s->tri_count;
+
+    for ( int i = 0; i < collapse_count; i++ ) {
+        if ( tri_count - removed <= target_tri_count ) break;
+
+        collapse_t * c = collapse_list + i;
+        if ( touched_list[ c->from ] || touched_list[ c->to ] ) continue;
+        if ( collapse_flips( s, c->from, c->to ) ) continue;
+
+        int adj_begin = s->adj_offset_list[ c->from ];
+        int adj_end = s->adj_offset_list[ c->from + 1 ];
+
+        // lock the whole one ring, its triangles are stale until the rewrite
+        for ( int a = adj_begin; a < adj_end; a++ ) {
+            int * tri = s->tri_list + s->adj_list[ a ] * 3;
+            if ( tri[ 0 ] == c->to || tri[ 1 ] == c->to || tri[ 2 ] == c->to ) {
+                removed++;
+            }
+            touched_list[ tri[ 0 ] ] = true;
+            touched_list[ tri[ 1 ] ] = true;
+            touched_list[ tri[ 2 ] ] = true;
+        }
+
+        s->collapse_list[ c->from ] = c->to;
+        quadric_add( s->quadric_list + c->to, s->quadric_list + c->from );
+
+        if ( c->cost > *max_error ) *max_error = c->cost;
+    }
+
+    // rewrite and drop degenerate triangles
+    int out = 0;
+    for ( int t = 0; t < s->tri_count; t++ ) {
+        int a = find_pid( s, s->tri_list[ t * 3 + 0 ] );
+        int b = find_pid( s, s->tri_list[ t * 3 + 1 ] );
+        int c = find_pid( s, s->tri_list[ t * 3 + 2 ] );
+        if ( a == b || b == c || a == c ) continue;
+
+        s->tri_list[ out * 3 + 0 ] = a;
+        s->tri_list[ out * 3 + 1 ] = b;
+        s->tri_list[ out * 3 + 2 ] = c;
+        out++;
+    }
+
+    int degenerate = s->tri_count - out;
+    s->tri_count = out;
+
+    return degenerate;
+}
+
+/// vertex at position id pid whose normal is closest to the one of v
+static unsigned int pick_wedge(
+    int v,
+    int pid,
+    int * wedge_offset_list,
+    int * wedge_list,
+    float * normal_list
+)
+{
+    float * n = normal_list + v * 3;
+
+    int best = wedge_list[ wedge_offset_list[ pid ] ];
+    float best_dot = -FLT_MAX;
+
+    for ( int w = wedge_offset_list[ pid ]; w < wedge_offset_list[ pid + 1 ];
+          w++ ) {
+        int other = wedge_list[ w ];
+        if ( other == v ) return v;
+
+        float d = dot3( n, normal_list + other * 3 );
+        if ( d > best_dot ) {
+            best_dot = d;
+            best = other;
+        }
+    }
+
+    return best;
+}
+
+int simplify_mesh(
+    unsigned int * out_index_list,
+    unsigned int * index_list,
+    int index_count,
+    float * pos_list,
+    float * normal_list,
+    int vertex_count,
+    int target_index_count,
+    float * out_error
+)
+{
+    *out_error = 0.0f;
+
+    int triangle_count = index_count / 3;
+
+    simplify_t s;
+
+    int * pid_list = new int[ vertex_count ];
+    s.pid_count = weld_positions( pid_list, pos_list, vertex_count );
+
+    s.pos_list = new float[ s.pid_count * 3 ];
+    s.quadric_list = new quadric_t[ s.pid_count ];
+    s.collapse_list = new int[ s.pid_count ];
+    s.adj_offset_list = new int[ s.pid_count + 1 ];
+    s.adj_list = new int[ index_count ];
+    s.tri_list = new int[ index_count ];
+
+    memset( s.quadric_list, 0, sizeof( quadric_t ) * s.pid_count );
+
+    for ( int v = 0; v < vertex_count; v++ ) {
+        memcpy( s.pos_list + pid_list[ v ] * 3, pos_list + v * 3, 12 );
+    }
+    for ( int p = 0; p < s.pid_count; p++ ) {
+        s.collapse_list[ p ] = p;
+    }
+
+    // source triangles, kept in vertex space for the output
+    s.tri_count = 0;
+    for ( int t = 0; t < triangle_count; t++ ) {
+        int a = pid_list[ index_list[ t * 3 + 0 ] ];
+        int b = pid_list[ index_list[ t * 3 + 1 ] ];
+        int c = pid_list[ index_list[ t * 3 + 2 ] ];
+        if ( a == b || b == c || a == c ) continue;
+
+        s.tri_list[ s.tri_count * 3 + 0 ] = a;
+        s.tri_list[ s.tri_count * 3 + 1 ] = b;
+        s.tri_list[ s.tri_count * 3 + 2 ] = c;
+        s.tri_count++;
+    }
+
+    add_plane_quadrics( &s );
+    add_border_quadrics( &s );
+
+    collapse_t * collapse_list = new collapse_t[ index_count ];
+    bool * touched_list = new bool[ s.pid_count ];
+
+    int target_tri_count = target_index_count / 3;
+    float max_error = 0.0f;
+
+    while ( s.tri_count > target_tri_count ) {
+        int removed = collapse_pass(
+            &s,
+            collapse_list,
+            touched_list,
+            target_tri_count,
+            &max_error
+        );
+        if ( removed == 0 ) break;
+    }
+
+    // map every surviving source corner onto a vertex at its new position
+    int * wedge_offset_list = new int[ s.pid_count + 1 ];
+    int * wedge_list = new int[ vertex_count ];
+
+    memset( wedge_offset_list, 0, sizeof( int ) * ( s.pid_count + 1 ) );
+    for ( int v = 0; v < vertex_count; v++ ) {
+        wedge_offset_list[ pid_list[ v ] + 1 ]++;
+    }
+    for ( int p = 0; p < s.pid_count; p++ ) {
+        wedge_offset_list[ p + 1 ] += wedge_offset_list[ p ];
+    }
+    int * cursor_list = new int[ s.pid_count ];
+    memcpy( cursor_list, wedge_offset_list, sizeof( int ) * s.pid_count );
+    for ( int v = 0; v < vertex_count; v++ ) {
+        wedge_list[ cursor_list[ pid_list[ v ] ]++ ] = v;
+    }
+    delete[] cursor_list;
+
+    int out_count = 0;
+    for ( int t = 0; t < triangle_count; t++ ) {
+        unsigned int * tri = index_list + t * 3;
+        int p[ 3 ];
+        for ( int i = 0; i < 3; i++ ) {
+            p[ i ] = find_pid( &s, pid_list[ tri[ i ] ] );
+        }
+        if ( p[ 0 ] == p[ 1 ] || p[ 1 ] == p[ 2 ] || p[ 0 ] == p[ 2 ] ) {
+            continue;
+        }
+
+        for ( int i = 0; i < 3; i++ ) {
+            out_index_list[ out_count++ ] = pick_wedge(
+                tri[ i ],
+                p[ i ],
+                wedge_offset_list,
+                wedge_list,
+                normal_list
+            );
+        }
+    }
+
+    *out_error = sqrtf( max_error );
+
+    delete[] pid_list;
+    delete[] s.pos_list;
+    delete[] s.quadric_list;
+    delete[] s.collapse_list;
+    delete[] s.adj_offset_list;
+    delete[] s.adj_list;
+    delete[] s.tri_list;
+    delete[] collapse_list;
+    delete[] touched_list;
+    delete[] wedge_offset_list;
+    delete[] wedge_list;
+
+    return out_count;
+}
+
+// simplify [end] //////////////////////////////////////////////////////////////
+
+// meshlets [begin] ////////////////////////////////////////////////////////////
+
+int meshlet_bound( int index_count )
+{
+    int triangle_count = index_count / 3;
+    return ( triangle_count + MESHLET_MIN_TRIANGLES - 1 ) /
+               MESHLET_MIN_TRIANGLES +
+           1;
+}
+
+static void finish_meshlet(
+    meshlet_t * m,
+    unsigned int * index_list,
+    float * pos_list,
+    float * normal_sum
+)
+{
+    // sphere around the box center, good enough for small clusters
+    float min[ 3 ] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float max[ 3 ] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    for ( int i = m->first; i < m->first + m->count; i++ ) {
+        float * p = pos_list + index_list[ i ] * 3;
+        for ( int j = 0; j < 3; j++ ) {
+            min[ j ] = fminf( min[ j ], p[ j ] );
+            max[ j ] = fmaxf( max[ j ], p[ j ] );
+        }
+    }
+
+    for ( int j = 0; j < 3; j++ ) {
+        m->center[ j ] = ( min[ j ] + max[ j ] ) * 0.5f;
+    }
+
+    float radius2 = 0.0f;
+    for ( int i = m->first; i < m->first + m->count; i++ ) {
+        float * p = pos_list + index_list[ i ] * 3;
+        float d[ 3 ] = {
+            p[ 0 ] - m->center[ 0 ],
+            p[ 1 ] - m->center[ 1 ],
+            p[ 2 ] - m->center[ 2 ],
+        };
+        radius2 = fmaxf( radius2, dot3( d, d ) );
+    }
+    m->radius = sqrtf( radius2 );
+
+    // cone around the average normal, cutoff is the sine of its spread
+    float length = sqrtf( dot3( normal_sum, normal_sum ) );
+    if ( length <= 0.0f ) {
+        m->cone_axis[ 0 ] = 0.0f;
+        m->cone_axis[ 1 ] = 0.0f;
+        m->cone_axis[ 2 ] = 1.0f;
+        m->cone_cutoff = 1.0f;
+        return;
+    }
+
+    for ( int j = 0; j < 3; j++ ) {
+        m->cone_axis[ j ] = normal_sum[ j ] / length;
+    }
+
+    float min_dot = 1.0f;
+    for ( int i = m->first; i < m->first + m->count; i += 3 ) {
+        float n[ 3 ];
+        triangle_normal(
+            n,
+            pos_list + index_list[ i + 0 ] * 3,
+            pos_list + index_list[ i + 1 ] * 3,
+            pos_list + index_list[ i + 2 ] * 3
+        );
+
+        float n_length = sqrtf( dot3( n, n ) );
+        if ( n_length <= 0.0f ) continue;
+
+        min_dot = fminf( min_dot, dot3( n, m->cone_axis ) / n_length );
+    }
+
+    // wider than a hemisphere can never be back facing as a whole
+    m->cone_cutoff = 1.0f;
+    if ( min_dot > 0.0f ) {
+        m->cone_cutoff = sqrtf( 1.0f - min_dot * min_dot );
+    }
+}
+
+int build_meshlets(
+    meshlet_t * out_meshlet_list,
+    unsigned int * index_list,
+    int index_count,
+    float * pos_list
+)
+{
+    index_count -= index_count % 3;
+
+    int count = 0;
+
+    meshlet_t * m = nullptr;
+    float normal_sum[ 3 ];
+
+    for ( int i = 0; i < index_count; i += 3 ) {
+        float n[ 3 ];
+        triangle_normal(
+            n,
+            pos_list + index_list[ i + 0 ] * 3,
+            pos_list + index_list[ i + 1 ] * 3,
+            pos_list + index_list[ i + 2 ] * 3
+        );
+
+        bool split = false;
+        if ( m ) {
+            int triangles = m->count / 3;
+            split = triangles >= MESHLET_MAX_TRIANGLES;
+
+            // facing against the cluster so far, the cone would be useless
+            if ( triangles >= MESHLET_MIN_TRIANGLES &&
+                 dot3( n, normal_sum ) < 0.0f ) {
+                split = true;
+            }
+        }
+
+        if ( !m || split ) {
+            if ( m ) finish_meshlet( m, index_list, pos_list, normal_sum );
+
+            m = out_meshlet_list + count++;
+            m->first = i;
+            m->count = 0;
+            normal_sum[ 0 ] = 0.0f;
+            normal_sum[ 1 ] = 0.0f;
+            normal_sum[ 2 ] = 0.0f;
+        }
+
+        m->count += 3;
+
+        float length = sqrtf( dot3( n, n ) );
+        if ( length > 0.0f ) {
+            normal_sum[ 0 ] += n[ 0 ] / length;
+            normal_sum[ 1 ] += n[ 1 ] / length;
+            normal_sum[ 2 ] += n[ 2 ] / length;
+        }
+    }
+
+    if ( m ) finish_meshlet( m, index_list, pos_list, normal_sum );
+
+    return count;
+}
+
+// meshlets [end] //////////////////////////////////////////////////////////////
+
+void optimize_triangle_order(
+    unsigned int * index_list,
+    int index_count,
+    float * pos_list,
+    int vertex_count
+)
+{
+    index_count -= index_count % 3;
+    if ( index_count < 6 ) return;
+
+    unsigned int * out_list = new unsigned int[ index_count ];
+    int * cluster_list = new int[ index_count / 3 ];
+
+    int cluster_count = tipsify(
+        out_list,
+        cluster_list,
+        index_list,
+        index_count,
+        vertex_count
+    );
+
+    sort_clusters(
+        out_list,
+        index_count,
+        cluster_list,
+        cluster_count,
+        pos_list
+    );
+
+    memcpy( index_list, out_list, sizeof( unsigned int ) * index_count );
+
+    delete[] out_list;
+    delete[] cluster_list;
+}
+
+static void permute( float * list, int width, int * remap_list, int count )
+{
+    float * temp_list = new float[ count * width ];
+    memcpy( temp_list, list, sizeof( float ) * count * width );
+
+    for ( int v = 0; v < count; v++ ) {
+        if ( remap_list[ v ] < 0 ) continue;
+        memcpy(
+            list + remap_list[ v ] * width,
+            temp_list + v * width,
+            sizeof( float ) * width
+        );
+    }
+
+    delete[] temp_list;
+}
+
+int optimize_vertex_order(
+    float * pos_list,
+    float * normal_list,
+    float * uv_list,
+    int vertex_count,
+    unsigned int * index_list,
+    int index_count
+)
+{
+    int * remap_list = new int[ vertex_count ];
+    memset( remap_list, -1, sizeof( int ) * vertex_count );
+
+    int next = 0;
+    for ( int i = 0; i < index_count; i++ ) {
+        unsigned int v = index_list[ i ];
+        if ( remap_list[ v ] < 0 ) {
+            remap_list[ v ] = next++;
+        }
+        index_list[ i ] = remap_list[ v ];
+    }
+
+    permute( pos_list, 3, remap_list, vertex_count );
+    permute( normal_list, 3, remap_list, vertex_count );
+    permute( uv_list, 2, remap_list, vertex_count );
+
+    delete[] remap_list;
+
+    return next;
+}
+
+static int compare_int( const void * a, const void * b )
+{
+    return *(const int *) a - *(const int *) b;
+}
+
+void optimize_wavefront( wavefront_t * mesh, const char * name )
+{
+    if ( mesh->index_count < 6 ) return;
+
+    float acmr_before =
+        compute_acmr( mesh->index_list, mesh->index_count, mesh->vertex_count );
+
+    // triangles never cross an object or material group boundary
+    int range_count = mesh->obj_count + mesh->material_group_count + 2;
+    int * range_list = new int[ range_count ];
+
+    int n = 0;
+    range_list[ n++ ] = 0;
+    range_list[ n++ ] = mesh->index_count;
+    for ( int i = 0; i < mesh->obj_count; i++ ) {
+        range_list[ n++ ] = mesh->obj_offset_list[ i ];
+    }
+    for ( int i = 0; i < mesh->material_group_count; i++ ) {
+        range_list[ n++ ] = mesh->material_group_offset_list[ i ];
+    }
+
+    qsort( range_list, range_count, sizeof( int ), compare_int );
+
+    for ( int i = 0; i + 1 < range_count; i++ ) {
+        int begin = range_list[ i ];
+        int end = range_list[ i + 1 ];
+        if ( end <= begin ) continue;
+
+        optimize_triangle_order(
+            mesh->index_list + begin,
+            end - begin,
+            mesh->pos_list,
+            mesh->vertex_count
+        );
+    }
+
+    delete[] range_list;
+
+    mesh->vertex_count = optimize_vertex_order(
+        mesh->pos_list,
+        mesh->normal_list,
+        mesh->uv_list,
+        mesh->vertex_count,
+        mesh->index_list,
+        mesh->index_count
+    );
+
+    float acmr_after =
+        compute_acmr( mesh->index_list, mesh->index_count, mesh->vertex_count );
+
+    INFO_LOG( "%s: acmr %.3f -> %.3f", name, acmr_before, acmr_after );
+}
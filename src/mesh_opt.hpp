@@ -0,0 +1,85 @@
+#pragma once
+
+#include "wavefront.hpp"
+
+/// post-transform cache size the optimizer and the acmr report assume
+#define MESH_OPT_CACHE_SIZE 16
+
+/// cluster size limits, a cluster is closed early once it has the minimum and
+/// the next triangle would widen its normal cone past usefulness
+#define MESHLET_MIN_TRIANGLES 64
+#define MESHLET_MAX_TRIANGLES 128
+
+/// a contiguous run of triangles with bounds for culling
+struct meshlet_t {
+    int first; // index
+    int count; // indices
+
+    float center[ 3 ];
+    float radius;
+
+    /// back facing from eye when
+    /// dot( center - eye, cone_axis ) >= cone_cutoff * |center - eye| + radius
+    float cone_axis[ 3 ];
+    float cone_cutoff;
+};
+
+/// average cache miss ratio (transformed vertices per triangle) of a
+/// triangle list on a fifo cache of MESH_OPT_CACHE_SIZE. 0.5 is the best a
+/// regular grid can do, 3.0 means nothing is ever reused.
+float compute_acmr(
+    unsigned int * index_list,
+    int index_count,
+    int vertex_count
+);
+
+/// reorders the triangles of an index range for vertex cache locality
+/// (tipsify), then sorts the resulting clusters front to back so outward
+/// facing surfaces are drawn first.
+void optimize_triangle_order(
+    unsigned int * index_list,
+    int index_count,
+    float * pos_list,
+    int vertex_count
+);
+
+/// reorders the vertices by first use in the index list and remaps it.
+/// unreferenced vertices are dropped, returns the new vertex count.
+int optimize_vertex_order(
+    float * pos_list,
+    float * normal_list,
+    float * uv_list,
+    int vertex_count,
+    unsigned int * index_list,
+    int index_count
+);
+
+/// quadric error edge collapse down to about target_index_count indices.
+/// vertices only ever move onto other existing vertices, so the result
+/// indexes the same vertex list. writes at most index_count indices, returns
+/// the count and the object space error (rms distance) in out_error.
+int simplify_mesh(
+    unsigned int * out_index_list,
+    unsigned int * index_list,
+    int index_count,
+    float * pos_list,
+    float * normal_list,
+    int vertex_count,
+    int target_index_count,
+    float * out_error
+);
+
+/// upper bound of meshlets build_meshlets writes
+int meshlet_bound( int index_count );
+
+/// splits an index list into meshlets without reordering it
+int build_meshlets(
+    meshlet_t * out_meshlet_list,
+    unsigned int * index_list,
+    int index_count,
+    float * pos_list
+);
+
+/// runs both passes on a loaded mesh, one object / material group at a time
+/// so the offset lists stay valid, and logs the acmr before and after.
+void optimize_wavefront( wavefront_t * mesh, const char * name );
@@ -0,0 +1,817 @@
+#include "model_loader.hpp"
+#include "gltf.hpp"
+#include "logging.hpp"
+#include "texture_file.hpp"
+
+#include <math.h>
+#include <stb_image.h>
+#include <string.h>
+
+#ifndef __EMSCRIPTEN__
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#define MAX_LOADER_THREAD_COUNT 8
+
+// model data [begin] //////////////////////////////////////////////////////////
+
+/// cuts a mesh at every object and material group boundary, the out lists
+/// need room for obj_count + material_group_count + 1 submeshes
+static int split_submeshes(
+    wavefront_t * mesh,
+    int * out_offset_list,
+    int * out_group_list
+)
+{
+    int count = 0;
+    int obj = 0;
+    int group = 0;
+
+    int offset = 0;
+    while ( offset < mesh->index_count ) {
+        while ( obj < mesh->obj_count &&
+                mesh->obj_offset_list[ obj ] <= offset ) {
+            obj++;
+        }
+        while ( group < mesh->material_group_count &&
+                mesh->material_group_offset_list[ group ] <= offset ) {
+            group++;
+        }
+
+        out_offset_list[ count ] = offset;
+        out_group_list[ count ] = group - 1;
+        count++;
+
+        int next = mesh->index_count;
+        if ( obj < mesh->obj_count && mesh->obj_offset_list[ obj ] < next ) {
+            next = mesh->obj_offset_list[ obj ];
+        }
+        if ( group < mesh->material_group_count &&
+             mesh->material_group_offset_list[ group ] < next ) {
+            next = mesh->material_group_offset_list[ group ];
+        }
+        offset = next;
+    }
+
+    return count;
+}
+
+int model_data_submesh_count( model_data_t * data, int lod, int i )
+{
+    int * first_list = data->lod_submesh_first_list[ lod ];
+    int last = i + 1 < data->submesh_count ? first_list[ i + 1 ]
+                                           : data->lod_index_count_list[ lod ];
+    return last - first_list[ i ];
+}
+
+/// simplified levels, each about half the triangles of the one before. they
+/// index the same vertices. every submesh is simplified on its own so each
+/// level keeps the submeshes as consecutive ranges, a submesh that does not
+/// simplify well keeps its previous level.
+static void build_lods( model_data_t * data )
+{
+    wavefront_t * mesh = data->mesh;
+    int index_count = mesh->index_count;
+    int submesh_count = data->submesh_count;
+
+    data->lod_count = 1;
+    data->lod_index_list[ 0 ] = mesh->index_list;
+    data->lod_index_count_list[ 0 ] = index_count;
+    data->lod_submesh_first_list[ 0 ] = new int[ submesh_count ];
+    data->lod_error_list[ 0 ] = 0.0f;
+    memcpy(
+        data->lod_submesh_first_list[ 0 ],
+        data->submesh_offset_list,
+        sizeof( int ) * submesh_count
+    );
+
+    // a level that far off is not worth drawing instead of culling
+    float dx = data->bounds_max[ 0 ] - data->bounds_min[ 0 ];
+    float dy = data->bounds_max[ 1 ] - data->bounds_min[ 1 ];
+    float dz = data->bounds_max[ 2 ] - data->bounds_min[ 2 ];
+    float max_error = sqrtf( dx * dx + dy * dy + dz * dz ) * 0.5f * 0.25f;
+
+    for ( int lod = 1; lod < MEOWGL_MAX_LOD_COUNT; lod++ ) {
+        unsigned int * previous_list = data->lod_index_list[ lod - 1 ];
+        int * previous_first_list = data->lod_submesh_first_list[ lod - 1 ];
+        int previous_count = data->lod_index_count_list[ lod - 1 ];
+
+        unsigned int * lod_index_list = new unsigned int[ index_count ];
+        int * first_list = new int[ submesh_count ];
+
+        int count = 0;
+        float error = data->lod_error_list[ lod - 1 ];
+
+        for ( int i = 0; i < submesh_count; i++ ) {
+            int previous_submesh_count =
+                model_data_submesh_count( data, lod - 1, i );
+
+            unsigned int * out = lod_index_list + count;
+            first_list[ i ] = count;
+
+            float submesh_error;
+            int n = simplify_mesh(
+                out,
+                mesh->index_list + data->submesh_offset_list[ i ],
+                model_data_submesh_count( data, 0, i ),
+                mesh->pos_list,
+                mesh->normal_list,
+                mesh->vertex_count,
+                previous_submesh_count / 2,
+                &submesh_error
+            );
+
+            if ( n == 0 || n > previous_submesh_count * 4 / 5 ||
+                 submesh_error > max_error ) {
+                n = previous_submesh_count;
+                memcpy(
+                    out,
+                    previous_list + previous_first_list[ i ],
+                    sizeof( unsigned int ) * n
+                );
+            } else {
+                optimize_triangle_order(
+                    out,
+                    n,
+                    mesh->pos_list,
+                    mesh->vertex_count
+                );
+                error = fmaxf( error, submesh_error );
+            }
+
+            count += n;
+        }
+
+        if ( count == 0 || count > previous_count * 4 / 5 ) {
+            delete[] lod_index_list;
+            delete[] first_list;
+            break;
+        }
+
+        data->lod_index_list[ lod ] = lod_index_list;
+        data->lod_index_count_list[ lod ] = count;
+        data->lod_submesh_first_list[ lod ] = first_list;
+        data->lod_error_list[ lod ] = error;
+        data->lod_count++;
+    }
+}
+
+/// splits the full detail level of every submesh into clusters for culling
+static void build_clusters( model_data_t * data )
+{
+    wavefront_t * mesh = data->mesh;
+    int submesh_count = data->submesh_count;
+
+    int bound = 0;
+    for ( int i = 0; i < submesh_count; i++ ) {
+        bound += meshlet_bound( model_data_submesh_count( data, 0, i ) );
+    }
+
+    data->meshlet_list = new meshlet_t[ bound ];
+    data->submesh_first_meshlet_list = new int[ submesh_count ];
+    data->submesh_meshlet_count_list = new int[ submesh_count ];
+
+    int count = 0;
+
+    for ( int i = 0; i < submesh_count; i++ ) {
+        int first = data->submesh_offset_list[ i ];
+        int n = build_meshlets(
+            data->meshlet_list + count,
+            mesh->index_list + first,
+            model_data_submesh_count( data, 0, i ),
+            mesh->pos_list
+        );
+
+        for ( int m = count; m < count + n; m++ ) {
+            data->meshlet_list[ m ].first += first;
+        }
+
+        data->submesh_first_meshlet_list[ i ] = count;
+        data->submesh_meshlet_count_list[ i ] = n;
+        count += n;
+    }
+
+    // a single cluster culls no better than the entity itself
+    if ( count < 2 ) {
+        count = 0;
+        for ( int i = 0; i < submesh_count; i++ ) {
+            data->submesh_meshlet_count_list[ i ] = 0;
+        }
+    }
+
+    data->meshlet_count = count;
+}
+
+static void load_materials( model_data_t * data )
+{
+    wavefront_t * mesh = data->mesh;
+
+    if ( !mesh->material_lib_filename || mesh->material_group_count == 0 ) {
+        return;
+    }
+
+    res_t res = find_res( mesh->material_lib_filename );
+    if ( !res.data ) return;
+
+    // a gltf mesh names itself as its material lib
+    if ( is_gltf( mesh->material_lib_filename ) ) {
+        data->errors += load_gltf_materials(
+            &data->material_lib,
+            res,
+            mesh->material_lib_filename
+        );
+    } else {
+        data->errors += load_material_lib( &data->material_lib, res );
+    }
+    data->has_material_lib = 1;
+
+    release_res( &res );
+}
+
+// palette baking [begin] //////////////////////////////////////////////////////
+
+/// an image decoded to rgba8. pixels is nullptr if it does not decode or is
+/// too large to be a palette, see TEXTURE_MIN_MIPMAP_SIZE
+struct palette_t {
+    unsigned char * pixels;
+    int width;
+    int height;
+};
+
+static void load_palette( palette_t * out, res_t res )
+{
+    out->pixels = nullptr;
+    if ( !res.data ) return;
+
+    int width, height, channels;
+    int ok = stbi_info_from_memory(
+        res.data,
+        (int) res.size,
+        &width,
+        &height,
+        &channels
+    );
+    if ( !ok || texture_level_count( width, height ) > 1 ) return;
+
+    out->pixels = stbi_load_from_memory(
+        res.data,
+        (int) res.size,
+        &out->width,
+        &out->height,
+        &channels,
+        4
+    );
+}
+
+static void load_palette_file( palette_t * out, const char * filename )
+{
+    res_t res = find_res( filename );
+    load_palette( out, res );
+    release_res( &res );
+}
+
+/// the diffuse map of a material group, 0 without one and -1 if it is not
+/// a palette
+static int load_group_palette( palette_t * out, model_data_t * data, int i )
+{
+    out->pixels = nullptr;
+
+    const char * name = data->mesh->material_group_material_list[ i ];
+    material_lib_t & lib = data->material_lib;
+
+    for ( int m = 0; m < lib.material_count; m++ ) {
+        if ( strcmp( lib.material_name_list[ m ], name ) != 0 ) continue;
+
+        material_t & material = lib.material_list[ m ];
+        if ( material.map_kd_data ) {
+            res_t res;
+            res.data = material.map_kd_data;
+            res.size = material.map_kd_size;
+            res.storage = RES_UNOWNED;
+            load_palette( out, res );
+        } else if ( material.map_kd ) {
+            load_palette_file( out, material.map_kd );
+        } else {
+            return 0;
+        }
+
+        return out->pixels ? 0 : -1;
+    }
+
+    return 0;
+}
+
+/// the texel under a uv, the texture repeats and is sampled nearest
+static int palette_texel( palette_t * palette, const float * uv )
+{
+    int x = (int) floorf( uv[ 0 ] * palette->width );
+    int y = (int) floorf( uv[ 1 ] * palette->height );
+
+    x %= palette->width;
+    y %= palette->height;
+    if ( x < 0 ) x += palette->width;
+    if ( y < 0 ) y += palette->height;
+
+    return y * palette->width + x;
+}
+
+/// colors every vertex of a submesh with the texel its triangles sample,
+/// white without a palette. fails when a triangle spans texels, it would
+/// show more than one color, or when a vertex would need two colors.
+static int bake_submesh(
+    model_data_t * data,
+    int i,
+    palette_t * palette,
+    unsigned int * color_list,
+    bool * baked_list
+)
+{
+    wavefront_t * mesh = data->mesh;
+    int first = data->submesh_offset_list[ i ];
+    int count = model_data_submesh_count( data, 0, i );
+
+    for ( int t = first; t + 2 < first + count; t += 3 ) {
+        unsigned int * triangle = mesh->index_list + t;
+        unsigned int color = 0xffffffff;
+
+        if ( palette && palette->pixels ) {
+            float * first_uv = mesh->uv_list + triangle[ 0 ] * 2;
+            int texel = palette_texel( palette, first_uv );
+            for ( int k = 1; k < 3; k++ ) {
+                float * uv = mesh->uv_list + triangle[ k ] * 2;
+                if ( palette_texel( palette, uv ) != texel ) return -1;
+            }
+            memcpy( &color, palette->pixels + texel * 4, 4 );
+        }
+
+        for ( int k = 0; k < 3; k++ ) {
+            unsigned int v = triangle[ k ];
+            if ( baked_list[ v ] && color_list[ v ] != color ) return -1;
+            color_list[ v ] = color;
+            baked_list[ v ] = true;
+        }
+    }
+
+    return 0;
+}
+
+/// sets color_list if every texture the model draws with is a palette the
+/// triangles sample one texel of. models without textures are left alone,
+/// there is no texture to save.
+static void bake_palette_colors(
+    model_data_t * data,
+    const char * texture_file
+)
+{
+    wavefront_t * mesh = data->mesh;
+    int group_count = mesh->material_group_count;
+
+    // the texture set on the model replaces the textures of the materials
+    palette_t model_palette;
+    palette_t * group_palette_list = nullptr;
+
+    int textured = 0;
+    int failed = 0;
+
+    if ( texture_file ) {
+        load_palette_file( &model_palette, texture_file );
+        textured = 1;
+        failed = !model_palette.pixels;
+    } else {
+        group_palette_list = new palette_t[ group_count ];
+        for ( int i = 0; i < group_count; i++ ) {
+            palette_t * palette = group_palette_list + i;
+            if ( load_group_palette( palette, data, i ) ) failed = 1;
+            if ( palette->pixels ) textured = 1;
+        }
+    }
+
+    if ( textured && !failed ) {
+        unsigned int * color_list = new unsigned int[ mesh->vertex_count ];
+        bool * baked_list = new bool[ mesh->vertex_count ];
+        memset( baked_list, 0, sizeof( bool ) * mesh->vertex_count );
+
+        for ( int i = 0; i < data->submesh_count && !failed; i++ ) {
+            int group = data->submesh_group_list[ i ];
+
+            palette_t * palette = &model_palette;
+            if ( !texture_file ) {
+                palette = group == -1 ? nullptr : group_palette_list + group;
+            }
+
+            failed = bake_submesh( data, i, palette, color_list, baked_list );
+        }
+
+        // vertices no triangle uses
+        for ( int v = 0; v < mesh->vertex_count; v++ ) {
+            if ( !baked_list[ v ] ) color_list[ v ] = 0xffffffff;
+        }
+
+        if ( failed ) {
+            delete[] color_list;
+        } else {
+            data->color_list = color_list;
+        }
+        delete[] baked_list;
+    }
+
+    if ( texture_file ) {
+        if ( model_palette.pixels ) stbi_image_free( model_palette.pixels );
+    } else {
+        for ( int i = 0; i < group_count; i++ ) {
+            if ( group_palette_list[ i ].pixels ) {
+                stbi_image_free( group_palette_list[ i ].pixels );
+            }
+        }
+        delete[] group_palette_list;
+    }
+}
+
+// palette baking [end] ////////////////////////////////////////////////////////
+
+/// identical files under different names hash the same, the material names
+/// are part of it since materials are shared by name
+static hash_t hash_content( wavefront_t * mesh )
+{
+    int vertex_count = mesh->vertex_count;
+
+    hash_t hash = HASH_SEED;
+    hash = hash_bytes( &vertex_count, sizeof( int ), hash );
+    size_t vertex_size = sizeof( float ) * vertex_count;
+    size_t index_size = sizeof( unsigned int ) * mesh->index_count;
+
+    hash = hash_bytes( mesh->pos_list, vertex_size * 3, hash );
+    hash = hash_bytes( mesh->normal_list, vertex_size * 3, hash );
+    hash = hash_bytes( mesh->uv_list, vertex_size * 2, hash );
+    hash = hash_bytes( mesh->index_list, index_size, hash );
+    hash = hash_bytes(
+        mesh->obj_offset_list,
+        sizeof( int ) * mesh->obj_count,
+        hash
+    );
+
+    for ( int i = 0; i < mesh->material_group_count; i++ ) {
+        hash = hash_bytes(
+            mesh->material_group_offset_list + i,
+            sizeof( int ),
+            hash
+        );
+        hash = hash_string( mesh->material_group_material_list[ i ], hash );
+    }
+
+    return hash;
+}
+
+int load_model_mesh( model_data_t * out, const char * filename, bool optimize )
+{
+    memset( out, 0, sizeof( model_data_t ) );
+
+    if ( load_mesh_cache( &out->cache, filename, optimize ) == 0 ) {
+        out->mesh = &out->cache.mesh;
+    } else {
+        res_t res = find_res( filename );
+        if ( is_gltf( filename ) ) {
+            out->errors = load_gltf( &out->file, res, filename );
+        } else {
+            // callers are already a pool of workers, a parallel parse in
+            // each of them would oversubscribe the cores
+            out->errors = load_wavefront( &out->file, res );
+        }
+        release_res( &res );
+
+        if ( out->errors == 0 && optimize ) {
+            optimize_wavefront( &out->file, filename );
+        }
+        if ( out->errors == 0 ) {
+            save_mesh_cache( filename, &out->file, optimize );
+        }
+
+        out->mesh = &out->file;
+    }
+
+    wavefront_t * mesh = out->mesh;
+
+    load_materials( out );
+
+    mesh->compute_bounds( out->bounds_min, out->bounds_max );
+    if ( mesh->vertex_count == 0 ) {
+        memset( out->bounds_min, 0, sizeof( float ) * 3 );
+        memset( out->bounds_max, 0, sizeof( float ) * 3 );
+    }
+
+    return out->errors;
+}
+
+int load_model_data(
+    model_data_t * out,
+    const char * filename,
+    const char * texture_file,
+    bool optimize,
+    bool bake_palettes
+)
+{
+    load_model_mesh( out, filename, optimize );
+
+    wavefront_t * mesh = out->mesh;
+
+    int submesh_cap = mesh->obj_count + mesh->material_group_count + 1;
+    out->submesh_offset_list = new int[ submesh_cap ];
+    out->submesh_group_list = new int[ submesh_cap ];
+    out->submesh_count = split_submeshes(
+        mesh,
+        out->submesh_offset_list,
+        out->submesh_group_list
+    );
+
+    build_lods( out );
+    build_clusters( out );
+
+    if ( out->errors == 0 && bake_palettes && mesh->vertex_count > 0 ) {
+        bake_palette_colors( out, texture_file );
+    }
+
+    if ( out->errors == 0 && mesh->vertex_count > 0 ) {
+        out->content_hash = hash_content( mesh );
+    }
+
+    return out->errors;
+}
+
+int model_data_size( model_data_t * data )
+{
+    int size = data->mesh->vertex_count * sizeof( float ) * 8;
+    for ( int i = 0; i < data->lod_count; i++ ) {
+        size += data->lod_index_count_list[ i ] * sizeof( unsigned int );
+    }
+
+    return size;
+}
+
+void model_data_free( model_data_t * data )
+{
+    for ( int i = 1; i < data->lod_count; i++ ) {
+        delete[] data->lod_index_list[ i ];
+    }
+    for ( int i = 0; i < data->lod_count; i++ ) {
+        delete[] data->lod_submesh_first_list[ i ];
+    }
+
+    delete[] data->submesh_offset_list;
+    delete[] data->submesh_group_list;
+    delete[] data->meshlet_list;
+    delete[] data->submesh_first_meshlet_list;
+    delete[] data->submesh_meshlet_count_list;
+    delete[] data->color_list;
+
+    if ( data->has_material_lib ) {
+        material_lib_free( &data->material_lib );
+    }
+
+    if ( data->mesh == &data->cache.mesh ) {
+        mesh_cache_free( &data->cache );
+    } else {
+        wavefront_free( &data->file );
+    }
+
+    memset( data, 0, sizeof( model_data_t ) );
+}
+
+// model data [end] ////////////////////////////////////////////////////////////
+
+// loader [begin] //////////////////////////////////////////////////////////////
+
+struct job_t {
+    int model_id;
+    char * filename;
+    char * texture_file; // nullptr = use the materials
+    bool optimize;
+    bool bake_palettes;
+
+    model_data_t * data;
+
+    job_t * next;
+};
+
+static struct {
+    // requests, oldest first
+    job_t * pending_first;
+    job_t * pending_last;
+
+    // finished loads taken off done, oldest first. gl thread only
+    job_t * ready;
+
+    int pending_count;
+
+#ifndef __EMSCRIPTEN__
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool quit;
+
+    // finished loads, newest first. workers push, the gl thread takes all
+    std::atomic< job_t * > done;
+
+    std::thread thread_list[ MAX_LOADER_THREAD_COUNT ];
+    int thread_count;
+#endif
+} loader;
+
+static void run_job( job_t * job )
+{
+    job->data = new model_data_t;
+    load_model_data(
+        job->data,
+        job->filename,
+        job->texture_file,
+        job->optimize,
+        job->bake_palettes
+    );
+}
+
+static void free_job( job_t * job )
+{
+    delete[] job->filename;
+    delete[] job->texture_file;
+    delete job;
+}
+
+#ifndef __EMSCRIPTEN__
+
+static void worker()
+{
+    for ( ;; ) {
+        job_t * job;
+
+        {
+            std::unique_lock< std::mutex > lock( loader.mutex );
+            loader.wake.wait( lock, [] {
+                return loader.quit || loader.pending_first;
+            } );
+
+            if ( loader.quit ) return;
+
+            job = loader.pending_first;
+            loader.pending_first = job->next;
+            if ( !loader.pending_first ) loader.pending_last = nullptr;
+        }
+
+        run_job( job );
+
+        job->next = loader.done.load( std::memory_order_relaxed );
+        while ( !loader.done.compare_exchange_weak(
+            job->next,
+            job,
+            std::memory_order_release,
+            std::memory_order_relaxed
+        ) ) {
+        }
+    }
+}
+
+#endif
+
+void model_loader_init( int thread_count )
+{
+    loader.pending_first = nullptr;
+    loader.pending_last = nullptr;
+    loader.ready = nullptr;
+    loader.pending_count = 0;
+
+#ifndef __EMSCRIPTEN__
+    if ( thread_count <= 0 ) {
+        thread_count = (int) std::thread::hardware_concurrency() - 1;
+    }
+    if ( thread_count < 1 ) thread_count = 1;
+    if ( thread_count > MAX_LOADER_THREAD_COUNT ) {
+        thread_count = MAX_LOADER_THREAD_COUNT;
+    }
+
+    loader.quit = false;
+    loader.done = nullptr;
+    loader.thread_count = thread_count;
+
+    for ( int i = 0; i < thread_count; i++ ) {
+        loader.thread_list[ i ] = std::thread( worker );
+    }
+#endif
+}
+
+void model_loader_shutdown()
+{
+#ifndef __EMSCRIPTEN__
+    {
+        std::lock_guard< std::mutex > lock( loader.mutex );
+        loader.quit = true;
+    }
+    loader.wake.notify_all();
+
+    for ( int i = 0; i < loader.thread_count; i++ ) {
+        loader.thread_list[ i ].join();
+    }
+    loader.thread_count = 0;
+
+    // finished loads nobody polled
+    int model_id;
+    while ( model_data_t * data = model_loader_poll( &model_id ) ) {
+        model_data_free( data );
+        delete data;
+    }
+#endif
+
+    while ( job_t * job = loader.pending_first ) {
+        loader.pending_first = job->next;
+        free_job( job );
+    }
+    loader.pending_last = nullptr;
+    loader.pending_count = 0;
+}
+
+void model_loader_request(
+    int model_id,
+    const char * filename,
+    const char * texture_file,
+    bool optimize,
+    bool bake_palettes
+)
+{
+    job_t * job = new job_t;
+    job->model_id = model_id;
+    job->filename = new char[ strlen( filename ) + 1 ];
+    strcpy( job->filename, filename );
+    job->texture_file = nullptr;
+    if ( texture_file ) {
+        job->texture_file = new char[ strlen( texture_file ) + 1 ];
+        strcpy( job->texture_file, texture_file );
+    }
+    job->optimize = optimize;
+    job->bake_palettes = bake_palettes;
+    job->data = nullptr;
+    job->next = nullptr;
+
+    loader.pending_count++;
+
+#ifndef __EMSCRIPTEN__
+    std::lock_guard< std::mutex > lock( loader.mutex );
+#endif
+
+    if ( loader.pending_last ) {
+        loader.pending_last->next = job;
+    } else {
+        loader.pending_first = job;
+    }
+    loader.pending_last = job;
+
+#ifndef __EMSCRIPTEN__
+    loader.wake.notify_one();
+#endif
+}
+
+model_data_t * model_loader_poll( int * out_model_id )
+{
+#ifdef __EMSCRIPTEN__
+    // no workers, one load per poll on the calling thread
+    if ( !loader.ready && loader.pending_first ) {
+        job_t * job = loader.pending_first;
+        loader.pending_first = job->next;
+        if ( !loader.pending_first ) loader.pending_last = nullptr;
+
+        run_job( job );
+        job->next = nullptr;
+        loader.ready = job;
+    }
+#else
+    if ( !loader.ready ) {
+        job_t * list =
+            loader.done.exchange( nullptr, std::memory_order_acquire );
+
+        // newest first, reverse into completion order
+        while ( list ) {
+            job_t * next = list->next;
+            list->next = loader.ready;
+            loader.ready = list;
+            list = next;
+        }
+    }
+#endif
+
+    job_t * job = loader.ready;
+    if ( !job ) return nullptr;
+
+    loader.ready = job->next;
+    loader.pending_count--;
+
+    model_data_t * data = job->data;
+    *out_model_id = job->model_id;
+    free_job( job );
+
+    return data;
+}
+
+int model_loader_pending()
+{
+    return loader.pending_count;
+}
+
+// loader [end] ////////////////////////////////////////////////////////////////
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "mesh_cache.hpp"
+#include "mesh_opt.hpp"
+#include "registry.hpp"
+#include "render.hpp"
+
+/// everything the model tables need from a model file, prepared without
+/// touching gl or the render state so it can be built on any thread
+struct model_data_t {
+    wavefront_t * mesh; // file or cache.mesh
+    wavefront_t file;
+    mesh_cache_t cache;
+
+    material_lib_t material_lib; // empty without a mtllib
+    int has_material_lib;
+
+    float bounds_min[ 3 ];
+    float bounds_max[ 3 ];
+
+    int * submesh_offset_list; // first index
+    int * submesh_group_list;  // material group, -1 = none
+    int submesh_count;
+
+    // level 0 is the mesh index list, submeshes are consecutive in each level
+    unsigned int * lod_index_list[ MEOWGL_MAX_LOD_COUNT ];
+    int lod_index_count_list[ MEOWGL_MAX_LOD_COUNT ];
+    int * lod_submesh_first_list[ MEOWGL_MAX_LOD_COUNT ];
+    float lod_error_list[ MEOWGL_MAX_LOD_COUNT ];
+    int lod_count;
+
+    meshlet_t * meshlet_list; // first index is model relative, level 0 only
+    int * submesh_first_meshlet_list;
+    int * submesh_meshlet_count_list;
+    int meshlet_count;
+
+    // palette colors sampled at the uvs, rgba8 per vertex. nullptr unless
+    // the model was baked, see load_model_data
+    unsigned int * color_list;
+
+    hash_t content_hash; // 0 = empty or failed, nothing to share
+
+    int errors;
+};
+
+/// reads (or maps the cache of) a model file with its materials and bounds,
+/// without preparing anything for the tables, enough to look at the model.
+/// writes the cache after a clean parse.
+/// @threadsafe
+int load_model_mesh(
+    model_data_t * out_data,
+    const char * filename,
+    bool optimize
+);
+
+/// load_model_mesh, then prepares the submeshes, levels of detail and
+/// clusters. texture_file is the texture set on the whole model, nullptr to
+/// use the materials. with bake_palettes a model whose textures are all
+/// palettes and whose triangles each sit inside one texel gets the texel
+/// colors in color_list and draws without its textures.
+/// @threadsafe
+int load_model_data(
+    model_data_t * out_data,
+    const char * filename,
+    const char * texture_file,
+    bool optimize,
+    bool bake_palettes
+);
+
+/// index count of a submesh in a level
+int model_data_submesh_count( model_data_t * data, int lod, int i );
+
+/// bytes the model adds to the vertex and index tables
+int model_data_size( model_data_t * data );
+
+void model_data_free( model_data_t * data );
+
+/// starts the workers, thread_count 0 uses all cores but one
+void model_loader_init( int thread_count );
+
+/// waits for the running loads and drops the queued ones
+void model_loader_shutdown();
+
+/// queues a load_model_data, the result comes back from model_loader_poll
+void model_loader_request(
+    int model_id,
+    const char * filename,
+    const char * texture_file,
+    bool optimize,
+    bool bake_palettes
+);
+
+/// takes the next finished load in completion order, nullptr if there is
+/// none. the caller owns the data, free it with model_data_free and delete.
+model_data_t * model_loader_poll( int * out_model_id );
+
+/// loads requested and not yet polled
+int model_loader_pending();
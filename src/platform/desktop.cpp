@@ -339,3 +339,8 @@ int hardware_touch_is_down()
 {
     return glfwGetMouseButton( intern.window, GLFW_MOUSE_BUTTON_LEFT );
 }
+
+void * hardware_gl_proc( const char * name )
+{
+    return (void *) glfwGetProcAddress( name );
+}
@@ -265,3 +265,8 @@ int hardware_touch_is_down()
 {
     return intern.touch_state;
 }
+
+void * hardware_gl_proc( const char * name )
+{
+    return (void *) glfwGetProcAddress( name );
+}
@@ -0,0 +1,376 @@
+#include "program_cache.hpp"
+#include "hardware.hpp"
+#include "logging.hpp"
+#include "registry.hpp"
+#include "render_utils.hpp"
+#include "res.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __EMSCRIPTEN__
+#define PROGRAM_CACHE_ENABLED 0
+#else
+#define PROGRAM_CACHE_ENABLED 1
+#include <glad/glad.h>
+#endif
+
+#define PROGRAM_CACHE_VERSION 1
+#define MAX_PATH_LENGTH       1024
+
+#if PROGRAM_CACHE_ENABLED
+
+// gl 4.1 and ARB_get_program_binary, glad is only generated for 3.0
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+
+typedef void( APIENTRYP get_program_binary_t )(
+    GLuint program,
+    GLsizei size,
+    GLsizei * length,
+    GLenum * format,
+    void * binary
+);
+typedef void( APIENTRYP program_binary_t )(
+    GLuint program,
+    GLenum format,
+    const void * binary,
+    GLsizei length
+);
+typedef void( APIENTRYP program_parameteri_t )(
+    GLuint program,
+    GLenum name,
+    GLint value
+);
+
+/// layout:
+///   header
+///   entries [ entry_count ], each an entry_t and size bytes of binary
+struct header_t {
+    char magic[ 4 ];
+    uint32_t version;
+    uint32_t entry_count;
+};
+
+struct entry_t {
+    uint64_t key;
+    uint32_t format;
+    uint32_t size;
+};
+
+static const char magic[ 4 ] = { 'M', 'W', 'P', 'C' };
+
+struct program_binary_entry_t {
+    hash_t key;
+    unsigned int format;
+    int size;
+    unsigned char * data;
+    bool used; // loaded or saved since the start, kept by the next flush
+};
+
+static struct {
+    bool enabled;
+
+    get_program_binary_t get_program_binary;
+    program_binary_t program_binary;
+    program_parameteri_t program_parameteri;
+
+    hash_t driver_hash; // seeds every key
+
+    program_binary_entry_t * entry_list;
+    int entry_count;
+    int entry_cap;
+
+    bool dirty; // something was saved since the last flush
+} intern;
+
+static bool has_program_binary()
+{
+    int major = 0;
+    int minor = 0;
+    glGetIntegerv( GL_MAJOR_VERSION, &major );
+    glGetIntegerv( GL_MINOR_VERSION, &minor );
+    if ( major > 4 || ( major == 4 && minor >= 1 ) ) return true;
+
+    return has_gl_extension( "GL_ARB_get_program_binary" );
+}
+
+static hash_t hash_gl_string( GLenum name, hash_t seed )
+{
+    const char * s = (const char *) glGetString( name );
+    return hash_string( s ? s : "", seed );
+}
+
+static program_binary_entry_t * find_entry( hash_t key )
+{
+    for ( int i = 0; i < intern.entry_count; i++ ) {
+        if ( intern.entry_list[ i ].key == key ) return intern.entry_list + i;
+    }
+
+    return nullptr;
+}
+
+static program_binary_entry_t * add_entry( hash_t key )
+{
+    // resize
+    if ( intern.entry_count >= intern.entry_cap ) {
+        int new_cap = intern.entry_cap * 2;
+        program_binary_entry_t * list = new program_binary_entry_t[ new_cap ];
+        memcpy(
+            list,
+            intern.entry_list,
+            sizeof( program_binary_entry_t ) * intern.entry_count
+        );
+
+        delete[] intern.entry_list;
+
+        intern.entry_list = list;
+        intern.entry_cap = new_cap;
+    }
+
+    program_binary_entry_t * entry = intern.entry_list + intern.entry_count++;
+    entry->key = key;
+    entry->format = 0;
+    entry->size = 0;
+    entry->data = nullptr;
+    entry->used = false;
+
+    return entry;
+}
+
+static void remove_entry( program_binary_entry_t * entry )
+{
+    delete[] entry->data;
+    *entry = intern.entry_list[ --intern.entry_count ];
+}
+
+/// a missing, outdated or torn file leaves the cache empty
+static void read_cache( const char * path )
+{
+    res_t res = load_file( path );
+    if ( !res.data ) return;
+
+    header_t header;
+    size_t offset = sizeof( header_t );
+
+    bool valid = res.size >= offset;
+    if ( valid ) {
+        memcpy( &header, res.data, sizeof( header_t ) );
+        valid = memcmp( header.magic, magic, 4 ) == 0 &&
+                header.version == PROGRAM_CACHE_VERSION;
+    }
+
+    for ( uint32_t i = 0; valid && i < header.entry_count; i++ ) {
+        entry_t entry;
+        if ( res.size - offset < sizeof( entry_t ) ) break;
+        memcpy( &entry, res.data + offset, sizeof( entry_t ) );
+        offset += sizeof( entry_t );
+
+        if ( res.size - offset < entry.size ) break;
+
+        program_binary_entry_t * out = add_entry( entry.key );
+        out->format = entry.format;
+        out->size = entry.size;
+        out->data = new unsigned char[ entry.size ];
+        memcpy( out->data, res.data + offset, entry.size );
+        offset += entry.size;
+    }
+
+    release_res( &res );
+}
+
+void program_cache_init()
+{
+    intern.enabled = false;
+    intern.dirty = false;
+    intern.entry_list = new program_binary_entry_t[ 16 ];
+    intern.entry_count = 0;
+    intern.entry_cap = 16;
+
+    if ( has_program_binary() ) {
+        intern.get_program_binary = (get_program_binary_t) hardware_gl_proc(
+            "glGetProgramBinary"
+        );
+        intern.program_binary =
+            (program_binary_t) hardware_gl_proc( "glProgramBinary" );
+        intern.program_parameteri =
+            (program_parameteri_t) hardware_gl_proc( "glProgramParameteri" );
+    }
+
+    int format_count = 0;
+    if ( intern.get_program_binary && intern.program_binary &&
+         intern.program_parameteri ) {
+        glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &format_count );
+    }
+
+    if ( format_count == 0 ) {
+        INFO_LOG( "no program binaries, shaders are compiled every launch" );
+        return;
+    }
+
+    intern.enabled = true;
+
+    // a driver update may change the compiler without changing the sources
+    hash_t hash = hash_gl_string( GL_VENDOR, HASH_SEED );
+    hash = hash_gl_string( GL_RENDERER, hash );
+    intern.driver_hash = hash_gl_string( GL_VERSION, hash );
+
+    char path[ MAX_PATH_LENGTH ];
+    if ( res_path( path, MAX_PATH_LENGTH, "programs.cache" ) == 0 ) {
+        read_cache( path );
+    }
+}
+
+hash_t program_cache_key( const char * vertex, const char * fragment )
+{
+    hash_t hash = hash_string( vertex, intern.driver_hash );
+    return hash_string( fragment, hash );
+}
+
+int program_cache_load( hash_t key )
+{
+    if ( !intern.enabled ) return -1;
+
+    program_binary_entry_t * entry = find_entry( key );
+    if ( !entry ) return -1;
+
+    int program = glCreateProgram();
+    intern.program_binary( program, entry->format, entry->data, entry->size );
+
+    int linked = 0;
+    glGetProgramiv( program, GL_LINK_STATUS, &linked );
+
+    // the driver may turn down binaries of its older builds even with the
+    // same version string, the compiled program is saved over it
+    if ( !linked ) {
+        glDeleteProgram( program );
+        remove_entry( entry );
+        intern.dirty = true;
+        return -1;
+    }
+
+    entry->used = true;
+    return program;
+}
+
+void program_cache_hint( int program )
+{
+    if ( !intern.enabled ) return;
+
+    intern.program_parameteri(
+        program,
+        GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+        GL_TRUE
+    );
+}
+
+void program_cache_save( int program, hash_t key )
+{
+    if ( !intern.enabled ) return;
+
+    int size = 0;
+    glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &size );
+    if ( size <= 0 ) return;
+
+    unsigned char * data = new unsigned char[ size ];
+    GLsizei length = 0;
+    GLenum format = 0;
+    intern.get_program_binary( program, size, &length, &format, data );
+    if ( length <= 0 ) {
+        delete[] data;
+        return;
+    }
+
+    program_binary_entry_t * entry = find_entry( key );
+    if ( !entry ) entry = add_entry( key );
+
+    delete[] entry->data;
+    entry->format = format;
+    entry->size = length;
+    entry->data = data;
+    entry->used = true;
+
+    intern.dirty = true;
+}
+
+void program_cache_flush()
+{
+    if ( !intern.dirty ) return;
+    intern.dirty = false;
+
+    char path[ MAX_PATH_LENGTH ];
+    if ( res_path( path, MAX_PATH_LENGTH - 4, "programs.cache" ) ) return;
+
+    header_t header;
+    memcpy( header.magic, magic, 4 );
+    header.version = PROGRAM_CACHE_VERSION;
+    header.entry_count = 0;
+    for ( int i = 0; i < intern.entry_count; i++ ) {
+        if ( intern.entry_list[ i ].used ) header.entry_count++;
+    }
+
+    // write to a temporary and rename, so a crash never leaves a torn cache
+    char temp_path[ MAX_PATH_LENGTH ];
+    snprintf( temp_path, MAX_PATH_LENGTH, "%s.tmp", path );
+
+    FILE * file = fopen( temp_path, "wb" );
+    if ( !file ) {
+        ERROR_LOG( "failed to write program cache: %s", path );
+        return;
+    }
+
+    bool failed = fwrite( &header, sizeof( header_t ), 1, file ) != 1;
+
+    for ( int i = 0; i < intern.entry_count && !failed; i++ ) {
+        program_binary_entry_t & entry = intern.entry_list[ i ];
+        if ( !entry.used ) continue;
+
+        entry_t out;
+        out.key = entry.key;
+        out.format = entry.format;
+        out.size = entry.size;
+
+        size_t size = entry.size;
+        failed = fwrite( &out, sizeof( entry_t ), 1, file ) != 1 ||
+                 fwrite( entry.data, 1, size, file ) != size;
+    }
+
+    failed = fclose( file ) != 0 || failed;
+
+    if ( failed || rename( temp_path, path ) ) {
+        ERROR_LOG( "failed to write program cache: %s", path );
+        remove( temp_path );
+    }
+}
+
+#else
+
+void program_cache_init()
+{
+}
+
+hash_t program_cache_key( const char * vertex, const char * fragment )
+{
+    return 0;
+}
+
+int program_cache_load( hash_t key )
+{
+    return -1;
+}
+
+void program_cache_hint( int program )
+{
+}
+
+void program_cache_save( int program, hash_t key )
+{
+}
+
+void program_cache_flush()
+{
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "registry.hpp"
+
+/// linked programs saved with glGetProgramBinary to programs.cache next to
+/// the resources, so later launches skip compiling and linking. a program
+/// is keyed by its sources, which also decide its attribute locations, and
+/// the driver's vendor, renderer and version strings. anything else gets
+/// compiled again. desktop gl 4.1 or ARB_get_program_binary only, webgl
+/// has no program binaries.
+
+/// looks for driver support and reads the cache, once the context is up
+void program_cache_init();
+
+/// key of the program built from the two sources
+hash_t program_cache_key( const char * vertex, const char * fragment );
+
+/// program linked from the cached binary, -1 if there is none or the driver
+/// turns it down, then compile as usual
+int program_cache_load( hash_t key );
+
+/// asks the driver to keep the binary of a program about to be linked
+void program_cache_hint( int program );
+
+/// keeps the binary of a freshly linked program for program_cache_flush
+void program_cache_save( int program, hash_t key );
+
+/// writes the programs loaded or saved since the start if any were saved,
+/// programs not asked for are dropped from the file
+void program_cache_flush();
@@ -0,0 +1,263 @@
+#include "registry.hpp"
+
+#include <string.h>
+
+#define HASH_EMPTY   0ull
+#define HASH_REMOVED 1ull
+
+hash_t hash_bytes( const void * data, size_t size, hash_t seed )
+{
+    const unsigned char * bytes = (const unsigned char *) data;
+
+    hash_t hash = seed;
+    for ( size_t i = 0; i < size; i++ ) {
+        hash ^= bytes[ i ];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+hash_t hash_string( const char * s, hash_t seed )
+{
+    return hash_bytes( s, strlen( s ), seed );
+}
+
+// hash map [begin] ////////////////////////////////////////////////////////////
+
+/// moves keys off the two reserved values
+static hash_t map_key( hash_t key )
+{
+    return key <= HASH_REMOVED ? key + 2 : key;
+}
+
+void hash_map_init( hash_map_t * map, int cap )
+{
+    int pow2 = 16;
+    while ( pow2 < cap ) pow2 *= 2;
+
+    map->key_list = new hash_t[ pow2 ];
+    map->value_list = new int[ pow2 ];
+    map->count = 0;
+    map->cap = pow2;
+
+    memset( map->key_list, 0, sizeof( hash_t ) * pow2 );
+}
+
+void hash_map_free( hash_map_t * map )
+{
+    delete[] map->key_list;
+    delete[] map->value_list;
+
+    memset( map, 0, sizeof( hash_map_t ) );
+}
+
+/// slot of the key, or the slot to insert it at
+static int find_slot( hash_map_t * map, hash_t key )
+{
+    int mask = map->cap - 1;
+    int slot = (int) ( key & mask );
+    int removed = -1;
+
+    while ( map->key_list[ slot ] != HASH_EMPTY ) {
+        if ( map->key_list[ slot ] == key ) return slot;
+        if ( map->key_list[ slot ] == HASH_REMOVED && removed == -1 ) {
+            removed = slot;
+        }
+        slot = ( slot + 1 ) & mask;
+    }
+
+    return removed != -1 ? removed : slot;
+}
+
+/// rebuilds the map without removed slots, at least twice the live count
+static void rehash( hash_map_t * map )
+{
+    hash_t * key_list = map->key_list;
+    int * value_list = map->value_list;
+    int cap = map->cap;
+
+    int live = 0;
+    for ( int i = 0; i < cap; i++ ) {
+        if ( key_list[ i ] > HASH_REMOVED ) live++;
+    }
+
+    hash_map_init( map, ( live + 1 ) * 2 );
+
+    for ( int i = 0; i < cap; i++ ) {
+        if ( key_list[ i ] <= HASH_REMOVED ) continue;
+
+        int slot = find_slot( map, key_list[ i ] );
+        map->key_list[ slot ] = key_list[ i ];
+        map->value_list[ slot ] = value_list[ i ];
+        map->count++;
+    }
+
+    delete[] key_list;
+    delete[] value_list;
+}
+
+int hash_map_find( hash_map_t * map, hash_t key )
+{
+    key = map_key( key );
+
+    int slot = find_slot( map, key );
+    return map->key_list[ slot ] == key ? map->value_list[ slot ] : -1;
+}
+
+void hash_map_set( hash_map_t * map, hash_t key, int value )
+{
+    key = map_key( key );
+
+    // keep a quarter of the slots empty so probes stay short
+    if ( ( map->count + 1 ) * 4 > map->cap * 3 ) rehash( map );
+
+    int slot = find_slot( map, key );
+    if ( map->key_list[ slot ] == HASH_EMPTY ) map->count++;
+
+    map->key_list[ slot ] = key;
+    map->value_list[ slot ] = value;
+}
+
+void hash_map_remove( hash_map_t * map, hash_t key )
+{
+    key = map_key( key );
+
+    int slot = find_slot( map, key );
+    if ( map->key_list[ slot ] == key ) {
+        map->key_list[ slot ] = HASH_REMOVED;
+    }
+}
+
+void hash_map_remove_value( hash_map_t * map, int value )
+{
+    for ( int i = 0; i < map->cap; i++ ) {
+        if ( map->key_list[ i ] <= HASH_REMOVED ) continue;
+        if ( map->value_list[ i ] == value ) {
+            map->key_list[ i ] = HASH_REMOVED;
+        }
+    }
+}
+
+// hash map [end] //////////////////////////////////////////////////////////////
+
+// range list [begin] //////////////////////////////////////////////////////////
+
+void range_list_init( range_list_t * list )
+{
+    list->count = 0;
+    list->cap = 16;
+    list->offset_list = new int[ 16 ];
+    list->size_list = new int[ 16 ];
+}
+
+void range_list_free( range_list_t * list )
+{
+    delete[] list->offset_list;
+    delete[] list->size_list;
+
+    memset( list, 0, sizeof( range_list_t ) );
+}
+
+static void insert_range( range_list_t * list, int i, int offset, int size )
+{
+    // resize
+    if ( list->count >= list->cap ) {
+        int new_cap = list->cap * 2;
+        int * out_offset = new int[ new_cap ];
+        int * out_size = new int[ new_cap ];
+
+        memcpy( out_offset, list->offset_list, sizeof( int ) * list->count );
+        memcpy( out_size, list->size_list, sizeof( int ) * list->count );
+
+        delete[] list->offset_list;
+        delete[] list->size_list;
+
+        list->offset_list = out_offset;
+        list->size_list = out_size;
+        list->cap = new_cap;
+    }
+
+    size_t move = ( list->count - i ) * sizeof( int );
+    memmove( list->offset_list + i + 1, list->offset_list + i, move );
+    memmove( list->size_list + i + 1, list->size_list + i, move );
+
+    list->offset_list[ i ] = offset;
+    list->size_list[ i ] = size;
+    list->count++;
+}
+
+static void remove_range( range_list_t * list, int i )
+{
+    size_t move = ( list->count - i - 1 ) * sizeof( int );
+    memmove( list->offset_list + i, list->offset_list + i + 1, move );
+    memmove( list->size_list + i, list->size_list + i + 1, move );
+
+    list->count--;
+}
+
+int range_list_take( range_list_t * list, int size, int align )
+{
+    // empty ranges would only split free ones, they take no room at the end
+    if ( size <= 0 ) return -1;
+
+    for ( int i = 0; i < list->count; i++ ) {
+        int first = list->offset_list[ i ];
+        int last = first + list->size_list[ i ];
+        int offset = ( first + align - 1 ) / align * align;
+
+        if ( offset + size > last ) continue;
+
+        // what is left before and after the taken range stays free
+        remove_range( list, i );
+        if ( offset + size < last ) {
+            insert_range( list, i, offset + size, last - offset - size );
+        }
+        if ( first < offset ) {
+            insert_range( list, i, first, offset - first );
+        }
+
+        return offset;
+    }
+
+    return -1;
+}
+
+void range_list_give( range_list_t * list, int offset, int size )
+{
+    if ( size <= 0 ) return;
+
+    int i = 0;
+    while ( i < list->count && list->offset_list[ i ] < offset ) i++;
+
+    insert_range( list, i, offset, size );
+
+    // merge with the next one, then with the previous one
+    if ( i + 1 < list->count &&
+         offset + size == list->offset_list[ i + 1 ] ) {
+        list->size_list[ i ] += list->size_list[ i + 1 ];
+        remove_range( list, i + 1 );
+    }
+    if ( i > 0 && list->offset_list[ i - 1 ] + list->size_list[ i - 1 ] ==
+                      offset ) {
+        list->size_list[ i - 1 ] += list->size_list[ i ];
+        remove_range( list, i );
+    }
+}
+
+int range_list_trim( range_list_t * list, int end )
+{
+    if ( list->count == 0 ) return end;
+
+    int last = list->count - 1;
+    if ( list->offset_list[ last ] + list->size_list[ last ] != end ) {
+        return end;
+    }
+
+    end = list->offset_list[ last ];
+    list->count--;
+
+    return end;
+}
+
+// range list [end] ////////////////////////////////////////////////////////////
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+
+using hash_t = unsigned long long;
+
+#define HASH_SEED 14695981039346656037ull
+
+/// 64 bit fnv-1a, start with HASH_SEED and chain calls by passing the
+/// previous hash
+hash_t hash_bytes( const void * data, size_t size, hash_t seed );
+
+hash_t hash_string( const char * s, hash_t seed );
+
+/// open addressing map from hashes to ids, linear probing. keys 0 and 1 are
+/// stored as 2 and 3.
+struct hash_map_t {
+    hash_t * key_list; // 0 = empty, 1 = removed
+    int * value_list;
+    int count; // used slots, removed ones included
+    int cap;   // power of two
+};
+
+void hash_map_init( hash_map_t * map, int cap );
+
+void hash_map_free( hash_map_t * map );
+
+/// value of the key, -1 if it is not in the map
+int hash_map_find( hash_map_t * map, hash_t key );
+
+/// inserts or replaces
+void hash_map_set( hash_map_t * map, hash_t key, int value );
+
+void hash_map_remove( hash_map_t * map, hash_t key );
+
+/// removes every key of the value, walks all slots
+void hash_map_remove_value( hash_map_t * map, int value );
+
+/// free ranges of a table that only grows at its end, sorted by offset and
+/// never touching each other
+struct range_list_t {
+    int * offset_list;
+    int * size_list;
+    int count;
+    int cap;
+};
+
+void range_list_init( range_list_t * list );
+
+void range_list_free( range_list_t * list );
+
+/// first free range that fits size at a multiple of align, the rest of the
+/// range stays free. returns -1 if there is none, append to the table then.
+int range_list_take( range_list_t * list, int size, int align );
+
+/// marks a range free, merging it with its neighbours
+void range_list_give( range_list_t * list, int offset, int size );
+
+/// drops a free range at the end of a table of size end, returns the new end
+int range_list_trim( range_list_t * list, int end );
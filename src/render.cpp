@@ -1,5 +1,8 @@
 #include "render.hpp"
 #include "hardware.hpp"
+#include "logging.hpp"
+#include "program_cache.hpp"
+#include "registry.hpp"
 #include "render_utils.hpp"
 #include "shape.hpp"
 
@@ -11,11 +14,25 @@
 
 #include <cglm/affine.h>
 #include <cglm/cam.h>
+#include <cglm/frustum.h>
 #include <cglm/mat4.h>
 
 #include <math.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
+#ifndef __EMSCRIPTEN__
+// core since gl 3.2, glad is only generated for 3.0
+typedef void( APIENTRYP draw_elements_base_vertex_t )(
+    GLenum mode,
+    GLsizei count,
+    GLenum type,
+    const void * indices,
+    GLint base_vertex
+);
+#endif
+
 renderstate_t rstate;
 
 void transform_t::update()
@@ -44,6 +61,58 @@ void transform_t::identity()
     update();
 }
 
+/// one visible submesh of one entity, sorted by material before drawing
+struct draw_t {
+    int baked; // drawn with the vertex colors, without a texture
+    int texture;
+    int material;
+    int model;
+    int entity;
+    int submesh;
+    int lod;
+};
+
+/// defines a program is built with, bits of its variant flags
+#define VARIANT_TEXTURED 1 // times the material texture
+#define VARIANT_BAKED    2 // times the vertex colors baked at import
+#define VARIANT_PACKED   4 // decodes packed vertices
+#define VARIANT_SHADOWED 8 // tests the light's shadow map
+#define VARIANT_COUNT    4
+
+static const char * variant_define_list[ VARIANT_COUNT ] = {
+    "TEXTURED",
+    "BAKED",
+    "PACKED",
+    "SHADOWED",
+};
+
+/// the geometry pass programs, only the textured ones have a material
+/// texture, the uniform is -1 in the others
+struct deferred_shader_t {
+    int id;
+    int proj;
+    int view;
+    int model;
+    int color;
+    int material_texture;
+    int emission;
+    int pos_offset;
+    int pos_scale;
+};
+
+/// the light pass programs, the unshadowed one has no shadow map and its
+/// shadow uniforms are -1
+struct light_shader_t {
+    int id;
+    int position_texture;
+    int normal_texture;
+    int depth_texture;
+    int depth_tile;
+    int light_matrix;
+    int light_pos;
+    int shadow_bias;
+};
+
 // render state
 struct {
     mat4 model;
@@ -52,39 +121,27 @@ struct {
 
     mat4 sun_combined;
 
-    struct {
-        int id;
-        int proj;
-        int view;
-        int model;
-        int color;
-        int material_texture;
-        int material_mix;
-        int emission;
-    } deferred_shader;
+    // by the TEXTURED, BAKED and PACKED variant flags, picked per draw
+    deferred_shader_t deferred_shader_list[ 8 ];
 
     struct {
         int id;
         int combined;
         int model;
+        int pos_offset;
+        int pos_scale;
     } shadow_shader;
 
-    struct {
-        int id;
-        int position_texture;
-        int normal_texture;
-        int depth_texture;
-        int depth_tile;
-        int light_matrix;
-        int light_pos;
-        int shadow_bias;
-    } light_shader;
+    light_shader_t light_shader;
+    light_shader_t nocast_light_shader; // unshadowed
 
     struct {
         int id;
         int proj;
         int view;
         int model;
+        int pos_offset;
+        int pos_scale;
     } highlight_shader;
 
     struct {
@@ -110,6 +167,19 @@ struct {
     vbuffer_t vertex_pos_buffer;
     vbuffer_t vertex_normal_buffer;
     vbuffer_t vertex_uv_buffer;
+    vbuffer_t vertex_color_view; // vertex_uv_buffer read as rgba8
+    ibuffer_t index_buffer;
+
+    // dequantization uniforms of the bound model shader
+    int model_pos_offset;
+    int model_pos_scale;
+
+    draw_t * draw_list;
+    int draw_cap;
+
+#ifndef __EMSCRIPTEN__
+    draw_elements_base_vertex_t draw_elements_base_vertex;
+#endif
 
     vbuffer_t fb_pos_buffer;
     vbuffer_t fb_uv_buffer;
@@ -138,67 +208,43 @@ struct {
 
 } intern;
 
-static void init_shader1()
+static void init_shader1( int id, int flags, int built_flags )
 {
-    int id = build_shader(
-        find_shader_string( "vertex_deferred" ),
-        find_shader_string( "fragment_deferred" )
-    );
-    intern.deferred_shader.id = id;
-
-    intern.deferred_shader.proj = find_uniform( id, "u_proj" );
-    intern.deferred_shader.view = find_uniform( id, "u_view" );
-    intern.deferred_shader.model = find_uniform( id, "u_model" );
-    intern.deferred_shader.color = find_uniform( id, "u_color" );
-    intern.deferred_shader.material_texture =
-        find_uniform( id, "u_material_texture" );
-    intern.deferred_shader.material_mix = find_uniform( id, "u_material_mix" );
-    intern.deferred_shader.emission = find_uniform( id, "u_emission" );
-
-    glBindAttribLocation( id, 0, "a_pos" );
-    glBindAttribLocation( id, 1, "a_normal" );
-    glBindAttribLocation( id, 2, "a_uv" );
+    deferred_shader_t * shader = intern.deferred_shader_list + flags;
+    shader->id = id;
+
+    shader->proj = find_uniform( id, "u_proj" );
+    shader->view = find_uniform( id, "u_view" );
+    shader->model = find_uniform( id, "u_model" );
+    shader->color = find_uniform( id, "u_color" );
+    shader->material_texture = -1;
+    if ( built_flags & VARIANT_TEXTURED ) {
+        shader->material_texture = find_uniform( id, "u_material_texture" );
+    }
+    shader->emission = find_uniform( id, "u_emission" );
+    shader->pos_offset = find_uniform( id, "u_pos_offset" );
+    shader->pos_scale = find_uniform( id, "u_pos_scale" );
 }
 
-static void init_shader2()
+static void init_shader2( int id, int /*flags*/, int /*built_flags*/ )
 {
-    int id = build_shader(
-        find_shader_string( "vertex_mesh_highlight" ),
-        find_shader_string( "fragment_highlight" )
-    );
-
     intern.highlight_shader.id = id;
     intern.highlight_shader.proj = find_uniform( id, "u_proj" );
     intern.highlight_shader.view = find_uniform( id, "u_view" );
     intern.highlight_shader.model = find_uniform( id, "u_model" );
-
-    glBindAttribLocation( id, 0, "a_pos" );
-    glBindAttribLocation( id, 1, "a_normal" );
-    glBindAttribLocation( id, 2, "a_uv" );
+    intern.highlight_shader.pos_offset = find_uniform( id, "u_pos_offset" );
+    intern.highlight_shader.pos_scale = find_uniform( id, "u_pos_scale" );
 }
 
-static void init_shader3()
+static void init_shader3( int id, int /*flags*/, int /*built_flags*/ )
 {
-    int id = build_shader(
-        find_shader_string( "vertex_screen" ),
-        find_shader_string( "fragment_highlight_pos" )
-    );
-
     intern.highlight_post_shader.id = id;
     intern.highlight_post_shader.texture = find_uniform( id, "u_texture" );
     intern.highlight_post_shader.size = find_uniform( id, "u_size" );
-
-    glBindAttribLocation( id, 0, "a_pos" );
-    glBindAttribLocation( id, 1, "a_uv" );
 }
 
-static void init_shader4()
+static void init_shader4( int id, int /*flags*/, int /*built_flags*/ )
 {
-    int id = build_shader(
-        find_shader_string( "vertex_screen" ),
-        find_shader_string( "fragment_scene_compose" )
-    );
-
     intern.scene_compose_shader.id = id;
     intern.scene_compose_shader.color_texture =
         find_uniform( id, "u_color_texture" );
@@ -207,45 +253,261 @@ static void init_shader4()
     intern.scene_compose_shader.bloom_texture =
         find_uniform( id, "u_bloom_texture" );
     intern.scene_compose_shader.size = find_uniform( id, "u_size" );
+}
 
-    glBindAttribLocation( id, 0, "a_pos" );
-    glBindAttribLocation( id, 1, "a_uv" );
+static void init_shader5( int id, int flags, int built_flags )
+{
+    light_shader_t * shader = flags & VARIANT_SHADOWED
+                                  ? &intern.light_shader
+                                  : &intern.nocast_light_shader;
+    shader->id = id;
+
+    shader->position_texture = find_uniform( id, "u_position_texture" );
+    shader->normal_texture = find_uniform( id, "u_normal_texture" );
+    shader->light_pos = find_uniform( id, "u_light_pos" );
+
+    // the unshadowed variant has no shadow map
+    shader->depth_texture = -1;
+    shader->depth_tile = -1;
+    shader->light_matrix = -1;
+    shader->shadow_bias = -1;
+    if ( built_flags & VARIANT_SHADOWED ) {
+        shader->depth_texture = find_uniform( id, "u_depth_texture" );
+        shader->depth_tile = find_uniform( id, "u_depth_tile" );
+        shader->light_matrix = find_uniform( id, "u_light_matrix" );
+        shader->shadow_bias = find_uniform( id, "u_shadow_bias" );
+    }
 }
 
-static void init_shader5()
+static void init_shader6( int id, int /*flags*/, int /*built_flags*/ )
 {
-    int id = build_shader(
-        find_shader_string( "vertex_screen" ),
-        find_shader_string( "fragment_light" )
-    );
+    intern.shadow_shader.id = id;
+    intern.shadow_shader.combined = find_uniform( id, "u_combined" );
+    intern.shadow_shader.model = find_uniform( id, "u_model" );
+    intern.shadow_shader.pos_offset = find_uniform( id, "u_pos_offset" );
+    intern.shadow_shader.pos_scale = find_uniform( id, "u_pos_scale" );
+}
 
-    intern.light_shader.id = id;
-    intern.light_shader.position_texture =
-        find_uniform( id, "u_position_texture" );
-    intern.light_shader.normal_texture = find_uniform( id, "u_normal_texture" );
-    intern.light_shader.depth_texture = find_uniform( id, "u_depth_texture" );
-    intern.light_shader.depth_tile = find_uniform( id, "u_depth_tile" );
-    intern.light_shader.light_matrix = find_uniform( id, "u_light_matrix" );
-    intern.light_shader.light_pos = find_uniform( id, "u_light_pos" );
-    intern.light_shader.shadow_bias = find_uniform( id, "u_shadow_bias" );
+/// a variant of a program built from two shaders.glsl sections
+struct program_t {
+    const char * vertex;
+    const char * fragment;
+    // stores the program and finds its uniforms, built_flags are those of
+    // the variant id was built from, the fallback's until it is ready
+    void ( *init )( int id, int flags, int built_flags );
+    int flags;    // VARIANT_*, its defines
+    int fallback; // flags of the variant init gets until it is ready, -1 to
+                  // wait for it
+
+    int id = 0;      // 0 until it builds
+    hash_t hash = 0; // of both expanded sections
+
+    bool pending = false;  // the driver is still on job
+    shader_job_t job = {}; // of the sections with job_hash
+    hash_t job_hash = 0;
+};
+
+// clang-format off
+static program_t program_list[] = {
+    // textured and baked draws take the material color alone until their
+    // variant is ready
+    { "vertex_deferred", "fragment_deferred", init_shader1,
+      0, -1 },
+    { "vertex_deferred", "fragment_deferred", init_shader1,
+      VARIANT_PACKED, -1 },
+    { "vertex_deferred", "fragment_deferred", init_shader1,
+      VARIANT_TEXTURED, 0 },
+    { "vertex_deferred", "fragment_deferred", init_shader1,
+      VARIANT_TEXTURED | VARIANT_PACKED, VARIANT_PACKED },
+    { "vertex_deferred", "fragment_deferred", init_shader1,
+      VARIANT_BAKED, 0 },
+    { "vertex_deferred", "fragment_deferred", init_shader1,
+      VARIANT_BAKED | VARIANT_PACKED, VARIANT_PACKED },
+    { "vertex_mesh_highlight", "fragment_highlight", init_shader2, 0, -1 },
+    { "vertex_screen", "fragment_highlight_post", init_shader3, 0, -1 },
+    { "vertex_screen", "fragment_scene_compose", init_shader4, 0, -1 },
+    { "vertex_screen", "fragment_light", init_shader5, VARIANT_SHADOWED, -1 },
+    { "vertex_screen", "fragment_light", init_shader5, 0, -1 },
+    { "vertex_shadow", "fragment_shadow", init_shader6, 0, -1 },
+};
+// clang-format on
+
+#define PROGRAM_COUNT (int) ( sizeof( program_list ) / sizeof( program_t ) )
+
+/// "#define NAME\n" for every flag
+static void variant_defines( char * out, int size, int flags )
+{
+    int length = 0;
+    out[ 0 ] = '\0';
 
-    glBindAttribLocation( id, 0, "a_pos" );
-    glBindAttribLocation( id, 1, "a_uv" );
+    for ( int i = 0; i < VARIANT_COUNT; i++ ) {
+        if ( !( flags & ( 1 << i ) ) ) continue;
+
+        length += snprintf(
+            out + length,
+            size - length,
+            "#define %s\n",
+            variant_define_list[ i ]
+        );
+    }
 }
 
-static void init_shader6()
+/// hands the program to the driver again if its expanded sections changed,
+/// the running one stays until the new one is ready. returns 1 if
+/// submitted.
+static int submit_program( program_t * program )
 {
-    int id = build_shader(
-        find_shader_string( "vertex_shadow" ),
-        find_shader_string( "fragment_shadow" )
-    );
+    char defines[ 256 ];
+    variant_defines( defines, 256, program->flags );
 
-    intern.shadow_shader.id = id;
-    intern.shadow_shader.combined = find_uniform( id, "u_combined" );
-    intern.shadow_shader.model = find_uniform( id, "u_model" );
+    char * vertex = expand_shader( program->vertex, defines );
+    char * fragment = expand_shader( program->fragment, defines );
+
+    hash_t hash = hash_string( vertex, HASH_SEED );
+    hash = hash_string( fragment, hash );
+
+    if ( program->pending && program->job_hash != hash ) {
+        // edited again before the driver was done, drop the older build
+        int id = finish_shader( &program->job );
+        if ( id != -1 ) glDeleteProgram( id );
+        program->pending = false;
+    }
+
+    bool changed = !program->pending &&
+                   ( program->id == 0 || program->hash != hash );
+    if ( changed ) {
+        submit_shader( &program->job, vertex, fragment );
+        program->pending = true;
+        program->job_hash = hash;
+    }
+
+    delete[] vertex;
+    delete[] fragment;
+
+    return changed;
+}
+
+/// puts the submitted program into use once the driver is done with it or
+/// right away with wait, a program that fails to build keeps running as it
+/// was. returns 1 if a new program went into use.
+static int finish_program( program_t * program, bool wait )
+{
+    if ( !program->pending ) return 0;
+    if ( !wait && !shader_ready( &program->job ) ) return 0;
+
+    program->pending = false;
+
+    int id = finish_shader( &program->job );
+    if ( id == -1 ) {
+        ERROR_LOG(
+            "failed to build program %s %s",
+            program->vertex,
+            program->fragment
+        );
+        return 0;
+    }
+
+    if ( program->id != 0 ) glDeleteProgram( program->id );
+
+    program->id = id;
+    program->hash = program->job_hash;
+    program->init( id, program->flags, program->flags );
+
+    return 1;
+}
+
+/// the variant of the same sections with the flags, nullptr if none
+static program_t * find_variant( program_t * program, int flags )
+{
+    for ( int i = 0; i < PROGRAM_COUNT; i++ ) {
+        program_t * variant = program_list + i;
+        if ( variant->flags == flags &&
+             strcmp( variant->vertex, program->vertex ) == 0 &&
+             strcmp( variant->fragment, program->fragment ) == 0 ) {
+            return variant;
+        }
+    }
+
+    return nullptr;
+}
+
+/// reports the programs naming a section shaders.glsl does not have, as
+/// lookups are exact they would build from an empty source
+static void check_program_sections()
+{
+    for ( int i = 0; i < PROGRAM_COUNT; i++ ) {
+        program_t * program = program_list + i;
+        const char * name_list[ 2 ] = { program->vertex, program->fragment };
+
+        for ( int j = 0; j < 2; j++ ) {
+            if ( has_shader_string( name_list[ j ] ) ) continue;
+
+            ERROR_LOG(
+                "program %d names a missing shader section: %s",
+                i,
+                name_list[ j ]
+            );
+        }
+    }
+}
+
+/// programs without one of their own yet draw with their fallback
+static void init_fallback_programs()
+{
+    for ( int i = 0; i < PROGRAM_COUNT; i++ ) {
+        program_t * program = program_list + i;
+        if ( program->id != 0 || program->fallback == -1 ) continue;
+
+        program_t * fallback = find_variant( program, program->fallback );
+        if ( fallback && fallback->id != 0 ) {
+            program->init( fallback->id, program->flags, fallback->flags );
+        }
+    }
+}
+
+/// takes the programs the driver finished into use, once per frame
+static void poll_programs()
+{
+    int count = 0;
+    for ( int i = 0; i < PROGRAM_COUNT; i++ ) {
+        count += finish_program( program_list + i, false );
+    }
+
+    if ( count == 0 ) return;
+
+    init_fallback_programs();
+    program_cache_flush();
+
+    // shadow maps are only drawn when something changes
+    compute_all_shadow_maps();
+}
+
+int reload_shaders()
+{
+    reload_shader_strings();
+    check_program_sections();
+
+    int count = 0;
+    for ( int i = 0; i < PROGRAM_COUNT; i++ ) {
+        count += submit_program( program_list + i );
+    }
+
+    return count;
+}
+
+int program_count()
+{
+    return PROGRAM_COUNT;
+}
+
+int program_ready_count()
+{
+    int count = 0;
+    for ( int i = 0; i < PROGRAM_COUNT; i++ ) {
+        if ( program_list[ i ].id != 0 && !program_list[ i ].pending ) count++;
+    }
 
-    glBindAttribLocation( id, 0, "a_pos" );
-    glBindAttribLocation( id, 1, "a_uv" );
+    return count;
 }
 
 static void setup_camera()
@@ -294,70 +556,716 @@ static void setup_light_camera()
     );
 }
 
-static void render_model( int model_id )
+static void use_model_shader( int id, int pos_offset, int pos_scale )
+{
+    use_program( id );
+
+    intern.model_pos_offset = pos_offset;
+    intern.model_pos_scale = pos_scale;
+}
+
+/// the model an entity draws, the placeholder while its own is loading
+static int entity_model( int e )
 {
+    int model_id = rstate.entity_model_list[ e ];
+    if ( rstate.model_resident_list[ model_id ] ) return model_id;
+
+    return rstate.placeholder_model;
+}
+
+static void bind_model( int model_id )
+{
+    vec3 offset{ 0.0f, 0.0f, 0.0f };
+    vec3 scale{ 1.0f, 1.0f, 1.0f };
+
+    if ( rstate.packed_vertices ) {
+        glm_vec3_copy( rstate.model_bounds_min_list[ model_id ], offset );
+        glm_vec3_sub(
+            rstate.model_bounds_max_list[ model_id ],
+            rstate.model_bounds_min_list[ model_id ],
+            scale
+        );
+    }
+
+    set_uniform( intern.model_pos_offset, offset );
+    set_uniform( intern.model_pos_scale, scale );
+
     intern.vertex_pos_buffer.enable( 0 );
     intern.vertex_normal_buffer.enable( 1 );
-    intern.vertex_uv_buffer.enable( 2 );
+    if ( rstate.model_baked_list[ model_id ] ) {
+        intern.vertex_color_view.enable( 2 );
+    } else {
+        intern.vertex_uv_buffer.enable( 2 );
+    }
+    intern.index_buffer.bind();
+}
+
+/// index_offset in bytes
+static void draw_model_range( int model_id, int index_offset, int count )
+{
+    int type = rstate.model_index_size_list[ model_id ] == 2
+                   ? GL_UNSIGNED_SHORT
+                   : GL_UNSIGNED_INT;
+
+#ifndef __EMSCRIPTEN__
+    if ( rstate.has_base_vertex ) {
+        intern.draw_elements_base_vertex(
+            GL_TRIANGLES,
+            count,
+            type,
+            (void *) (intptr_t) index_offset,
+            rstate.model_offset_list[ model_id ]
+        );
+        return;
+    }
+#endif
 
-    glDrawArrays(
+    glDrawElements(
         GL_TRIANGLES,
-        rstate.model_offset_list[ model_id ],
-        rstate.model_size_list[ model_id ]
+        count,
+        type,
+        (void *) (intptr_t) index_offset
+    );
+}
+
+static void render_model( int model_id, int lod )
+{
+    bind_model( model_id );
+
+    int lod_id = model_id * MEOWGL_MAX_LOD_COUNT + lod;
+    draw_model_range(
+        model_id,
+        rstate.lod_index_offset_list[ lod_id ],
+        rstate.lod_index_count_list[ lod_id ]
+    );
+}
+
+static float max_scale( transform_t & t )
+{
+    return fmaxf(
+        fabsf( t.scale[ 0 ] ),
+        fmaxf( fabsf( t.scale[ 1 ] ), fabsf( t.scale[ 2 ] ) )
     );
 }
 
+static bool sphere_outside( vec4 * planes, vec3 center, float radius )
+{
+    for ( int i = 0; i < 6; i++ ) {
+        float d = glm_vec3_dot( planes[ i ], center ) + planes[ i ][ 3 ];
+        if ( d < -radius ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool submesh_outside( int e, int submesh, vec4 * planes )
+{
+    transform_t & t = rstate.entity_transform_list[ e ];
+
+    float * min = rstate.submesh_bounds_min_list[ submesh ];
+    float * max = rstate.submesh_bounds_max_list[ submesh ];
+
+    vec4 center;
+    glm_vec3_center( min, max, center );
+    center[ 3 ] = 1.0f;
+    glm_mat4_mulv( t.m, center, center );
+
+    float radius = glm_vec3_distance( min, max ) * 0.5f * max_scale( t );
+
+    return sphere_outside( planes, center, radius );
+}
+
+/// draws the clusters of the bound model that are inside the frustum planes
+/// and not entirely back facing from eye. neighbouring visible clusters are
+/// merged into one draw.
+static void draw_clusters(
+    int e,
+    int first_cluster,
+    int cluster_count,
+    vec4 * planes,
+    vec3 eye
+)
+{
+    int model_id = entity_model( e );
+    transform_t & t = rstate.entity_transform_list[ e ];
+
+    float size = max_scale( t );
+
+    // normals only survive a uniform scale, skip the cone test otherwise
+    bool uniform = fabsf( t.scale[ 0 ] ) == size &&
+                   fabsf( t.scale[ 1 ] ) == size &&
+                   fabsf( t.scale[ 2 ] ) == size;
+
+    int index_size = rstate.model_index_size_list[ model_id ];
+    int base_offset =
+        rstate.lod_index_offset_list[ model_id * MEOWGL_MAX_LOD_COUNT ];
+
+    int run_first = -1; // index
+    int run_count = 0;
+
+    for ( int c = first_cluster; c < first_cluster + cluster_count; c++ ) {
+        float * sphere = rstate.cluster_sphere_list[ c ];
+        float * cone = rstate.cluster_cone_list[ c ];
+
+        vec4 center{ sphere[ 0 ], sphere[ 1 ], sphere[ 2 ], 1.0f };
+        glm_mat4_mulv( t.m, center, center );
+        float radius = sphere[ 3 ] * size;
+
+        bool visible = !sphere_outside( planes, center, radius );
+
+        if ( visible && uniform && cone[ 3 ] < 1.0f ) {
+            vec4 axis{ cone[ 0 ], cone[ 1 ], cone[ 2 ], 0.0f };
+            glm_mat4_mulv( t.m, axis, axis );
+            glm_vec3_normalize( axis );
+
+            vec3 view;
+            glm_vec3_sub( center, eye, view );
+
+            float d = glm_vec3_dot( view, axis );
+            if ( d >= cone[ 3 ] * glm_vec3_norm( view ) + radius ) {
+                visible = false;
+            }
+        }
+
+        int first = rstate.cluster_index_offset_list[ c ];
+        int count = rstate.cluster_index_count_list[ c ];
+
+        if ( visible && run_count > 0 && run_first + run_count == first ) {
+            run_count += count;
+            continue;
+        }
+
+        if ( run_count > 0 ) {
+            draw_model_range(
+                model_id,
+                base_offset + run_first * index_size,
+                run_count
+            );
+            run_count = 0;
+        }
+
+        if ( visible ) {
+            run_first = first;
+            run_count = count;
+        }
+    }
+
+    if ( run_count > 0 ) {
+        draw_model_range(
+            model_id,
+            base_offset + run_first * index_size,
+            run_count
+        );
+    }
+}
+
+/// draws the full detail level of an entity's model, cluster culled
+static void render_model_clusters( int e, vec4 * planes, vec3 eye )
+{
+    int model_id = entity_model( e );
+    int cluster_count = rstate.model_cluster_count_list[ model_id ];
+
+    if ( !rstate.enable_cluster_culling || cluster_count == 0 ) {
+        render_model( model_id, 0 );
+        return;
+    }
+
+    bind_model( model_id );
+    draw_clusters(
+        e,
+        rstate.model_cluster_offset_list[ model_id ],
+        cluster_count,
+        planes,
+        eye
+    );
+}
+
+/// draws one submesh of the entity's model, the model must be bound
+static void draw_submesh( int e, int submesh, int lod, vec4 * planes, vec3 eye )
+{
+    int cluster_count = rstate.submesh_cluster_count_list[ submesh ];
+
+    if ( lod == 0 && rstate.enable_cluster_culling && cluster_count > 0 ) {
+        draw_clusters(
+            e,
+            rstate.submesh_first_cluster_list[ submesh ],
+            cluster_count,
+            planes,
+            eye
+        );
+        return;
+    }
+
+    int lod_id = submesh * MEOWGL_MAX_LOD_COUNT + lod;
+    draw_model_range(
+        entity_model( e ),
+        rstate.submesh_index_offset_list[ lod_id ],
+        rstate.submesh_index_count_list[ lod_id ]
+    );
+}
+
+int model_vertex_index( int model_id, int i )
+{
+    const char * data =
+        rstate.index_data + rstate.model_index_offset_list[ model_id ];
+
+    int index;
+    if ( rstate.model_index_size_list[ model_id ] == 2 ) {
+        index = ( (const unsigned short *) data )[ i ];
+    } else {
+        index = ( (const unsigned int *) data )[ i ];
+    }
+
+    if ( rstate.has_base_vertex ) index += rstate.model_offset_list[ model_id ];
+
+    return index;
+}
+
+/// pixels per unit of size at distance 1
+static float pixel_scale( float fov, float viewport_height )
+{
+    return viewport_height / ( 2.0f * tanf( fov * 0.5f ) );
+}
+
+/// level of detail for an entity seen from eye, -1 if it is too small to
+/// draw at all
+static int select_lod( int e, vec3 eye, float scale )
+{
+    int model_id = entity_model( e );
+    transform_t & t = rstate.entity_transform_list[ e ];
+
+    float * min = rstate.model_bounds_min_list[ model_id ];
+    float * max = rstate.model_bounds_max_list[ model_id ];
+
+    vec4 center;
+    glm_vec3_center( min, max, center );
+    center[ 3 ] = 1.0f;
+    glm_mat4_mulv( t.m, center, center );
+
+    float size = max_scale( t );
+    float radius = glm_vec3_distance( min, max ) * 0.5f * size;
+
+    float distance = glm_vec3_distance( center, eye ) - radius;
+    if ( distance <= 0.0f || !rstate.enable_lod ) return 0;
+
+    float pixels_per_unit = scale / distance;
+    if ( radius * pixels_per_unit < rstate.cull_pixel_size ) return -1;
+
+    int lod = 0;
+    int lod_count = rstate.model_lod_count_list[ model_id ];
+    for ( int i = 1; i < lod_count; i++ ) {
+        int lod_id = model_id * MEOWGL_MAX_LOD_COUNT + i;
+        float error = rstate.lod_error_list[ lod_id ] * size;
+        if ( error * pixels_per_unit > rstate.lod_pixel_error ) break;
+        lod = i;
+    }
+
+    return lod;
+}
+
+// vertex packing [begin] //////////////////////////////////////////////////////
+
+static unsigned short quantize_unorm16( float v, float min, float extent )
+{
+    if ( extent <= 0.0f ) return 0;
+
+    float t = ( v - min ) / extent;
+    t = t < 0.0f ? 0.0f : ( t > 1.0f ? 1.0f : t );
+
+    return (unsigned short) ( t * 65535.0f + 0.5f );
+}
+
+static short quantize_snorm16( float v )
+{
+    v = v < -1.0f ? -1.0f : ( v > 1.0f ? 1.0f : v );
+
+    return (short) roundf( v * 32767.0f );
+}
+
+/// octahedral mapping, decoded in vertex_deferred
+static void encode_normal( short * out, float * n )
+{
+    float l1 = fabsf( n[ 0 ] ) + fabsf( n[ 1 ] ) + fabsf( n[ 2 ] );
+    if ( l1 <= 0.0f ) {
+        out[ 0 ] = 0;
+        out[ 1 ] = 0;
+        return;
+    }
+
+    float x = n[ 0 ] / l1;
+    float y = n[ 1 ] / l1;
+
+    if ( n[ 2 ] < 0.0f ) {
+        float fx = ( 1.0f - fabsf( y ) ) * ( x >= 0.0f ? 1.0f : -1.0f );
+        float fy = ( 1.0f - fabsf( x ) ) * ( y >= 0.0f ? 1.0f : -1.0f );
+        x = fx;
+        y = fy;
+    }
+
+    out[ 0 ] = quantize_snorm16( x );
+    out[ 1 ] = quantize_snorm16( y );
+}
+
+/// round to nearest even, overflows to inf
+static unsigned short float_to_half( float f )
+{
+    uint32_t x;
+    memcpy( &x, &f, 4 );
+
+    uint32_t sign = ( x >> 16 ) & 0x8000;
+    uint32_t mantissa = x & 0x7fffff;
+    int exponent = (int) ( ( x >> 23 ) & 0xff ) - 127 + 15;
+
+    if ( ( x & 0x7fffffff ) >= 0x7f800000 ) {
+        return sign | 0x7c00 | ( mantissa ? 0x200 : 0 );
+    }
+
+    if ( exponent >= 31 ) return sign | 0x7c00;
+
+    if ( exponent <= 0 ) {
+        if ( exponent < -10 ) return sign;
+
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint32_t h = mantissa >> shift;
+        uint32_t rest = mantissa & ( ( 1u << shift ) - 1 );
+        uint32_t half = 1u << ( shift - 1 );
+        if ( rest > half || ( rest == half && ( h & 1 ) ) ) h++;
+        return sign | h;
+    }
+
+    uint32_t h = ( exponent << 10 ) | ( mantissa >> 13 );
+    uint32_t rest = mantissa & 0x1fff;
+    if ( rest > 0x1000 || ( rest == 0x1000 && ( h & 1 ) ) ) h++;
+
+    return sign | h;
+}
+
+static void quantize_pos( unsigned short * out, int model_id, float * pos )
+{
+    float * min = rstate.model_bounds_min_list[ model_id ];
+    float * max = rstate.model_bounds_max_list[ model_id ];
+
+    for ( int j = 0; j < 3; j++ ) {
+        out[ j ] = quantize_unorm16( pos[ j ], min[ j ], max[ j ] - min[ j ] );
+    }
+}
+
+void model_vertex_pos( int model_id, int i, float * out_pos )
+{
+    int v = model_vertex_index( model_id, i );
+    float * pos = rstate.vertex_pos_list + v * 3;
+
+    if ( !rstate.packed_vertices ) {
+        glm_vec3_copy( pos, out_pos );
+        return;
+    }
+
+    unsigned short q[ 3 ];
+    quantize_pos( q, model_id, pos );
+
+    float * min = rstate.model_bounds_min_list[ model_id ];
+    float * max = rstate.model_bounds_max_list[ model_id ];
+
+    for ( int j = 0; j < 3; j++ ) {
+        float extent = max[ j ] - min[ j ];
+        out_pos[ j ] = min[ j ] + ( q[ j ] / 65535.0f ) * extent;
+    }
+}
+
+/// baked models have no uvs, the rgba8 color of each vertex takes the first
+/// 4 bytes of its uv instead. uv_list holds every vertex, stride bytes each.
+static void write_baked_colors( void * uv_list, int stride )
+{
+    char * out = (char *) uv_list;
+
+    for ( int m = 0; m < rstate.model_count; m++ ) {
+        if ( !rstate.model_baked_list[ m ] ) continue;
+
+        int first = rstate.model_offset_list[ m ];
+        int last = first + rstate.model_size_list[ m ];
+
+        for ( int v = first; v < last; v++ ) {
+            memcpy( out + v * stride, rstate.vertex_color_list + v, 4 );
+        }
+    }
+}
+
+/// pos:    4 x unorm16 (w unused, keeps the stride aligned), model bounds
+/// normal: 2 x snorm16 octahedral
+/// uv:     2 x half, or 4 x unorm8 color for baked models
+static void upload_packed_vertices()
+{
+    int count = rstate.vertex_count;
+
+    unsigned short * pos_list = new unsigned short[ count * 4 ];
+    short * normal_list = new short[ count * 2 ];
+    unsigned short * uv_list = new unsigned short[ count * 2 ];
+
+    for ( int m = 0; m < rstate.model_count; m++ ) {
+        int first = rstate.model_offset_list[ m ];
+        int last = first + rstate.model_size_list[ m ];
+
+        for ( int v = first; v < last; v++ ) {
+            quantize_pos( pos_list + v * 4, m, rstate.vertex_pos_list + v * 3 );
+            pos_list[ v * 4 + 3 ] = 0;
+
+            encode_normal(
+                normal_list + v * 2,
+                rstate.vertex_normal_list + v * 3
+            );
+
+            uv_list[ v * 2 + 0 ] =
+                float_to_half( rstate.vertex_uv_list[ v * 2 + 0 ] );
+            uv_list[ v * 2 + 1 ] =
+                float_to_half( rstate.vertex_uv_list[ v * 2 + 1 ] );
+        }
+    }
+
+    write_baked_colors( uv_list, 4 );
+
+    intern.vertex_pos_buffer.set_format( 3, GL_UNSIGNED_SHORT, 8 );
+    intern.vertex_normal_buffer.set_format( 2, GL_SHORT, 4 );
+    intern.vertex_uv_buffer.set_format( 2, GL_HALF_FLOAT, 4 );
+    intern.vertex_color_view.set_format( 4, GL_UNSIGNED_BYTE, 4 );
+
+    intern.vertex_pos_buffer.set( pos_list, count );
+    intern.vertex_normal_buffer.set( normal_list, count );
+    intern.vertex_uv_buffer.set( uv_list, count );
+
+    delete[] pos_list;
+    delete[] normal_list;
+    delete[] uv_list;
+}
+
+// vertex packing [end] ////////////////////////////////////////////////////////
+
+static int compare_draw( const void * a, const void * b )
+{
+    const draw_t * x = (const draw_t *) a;
+    const draw_t * y = (const draw_t *) b;
+
+    if ( x->baked != y->baked ) return x->baked - y->baked;
+    if ( x->texture != y->texture ) return x->texture < y->texture ? -1 : 1;
+    if ( x->material != y->material ) return x->material < y->material ? -1 : 1;
+    if ( x->model != y->model ) return x->model < y->model ? -1 : 1;
+    if ( x->entity != y->entity ) return x->entity < y->entity ? -1 : 1;
+    return x->submesh - y->submesh;
+}
+
+static void push_draw( int draw_count, draw_t & draw )
+{
+    // resize
+    if ( draw_count >= intern.draw_cap ) {
+        int new_cap = intern.draw_cap * 2;
+        draw_t * out_draw = new draw_t[ new_cap ];
+
+        memcpy( out_draw, intern.draw_list, sizeof( draw_t ) * draw_count );
+
+        delete[] intern.draw_list;
+
+        intern.draw_list = out_draw;
+        intern.draw_cap = new_cap;
+    }
+
+    intern.draw_list[ draw_count ] = draw;
+}
+
+/// visible submeshes of all model entities, sorted so that the program,
+/// textures and materials only change between batches. returns the draw
+/// count.
+static int collect_draws( vec4 * planes, float scale )
+{
+    int draw_count = 0;
+
+    for ( int i = 0; i < rstate.e_model_count; i++ ) {
+        int e = rstate.e_model_entity_list[ i ];
+        int model_id = entity_model( e );
+
+        int lod = select_lod( e, rstate.camera.pos, scale );
+        if ( lod < 0 ) continue;
+
+        int first = rstate.model_submesh_offset_list[ model_id ];
+        int count = rstate.model_submesh_count_list[ model_id ];
+
+        for ( int s = first; s < first + count; s++ ) {
+            if ( submesh_outside( e, s, planes ) ) continue;
+
+            draw_t draw;
+            draw.baked = rstate.model_baked_list[ model_id ];
+            draw.material = rstate.submesh_material_list[ s ];
+            draw.texture = rstate.model_texture_list[ model_id ];
+            if ( draw.texture == -1 && draw.material != -1 ) {
+                draw.texture = rstate.material_texture_list[ draw.material ];
+            }
+            if ( draw.baked ) draw.texture = -1;
+            draw.model = model_id;
+            draw.entity = e;
+            draw.submesh = s;
+            draw.lod = lod;
+
+            push_draw( draw_count++, draw );
+        }
+    }
+
+    qsort( intern.draw_list, draw_count, sizeof( draw_t ), compare_draw );
+
+    return draw_count;
+}
+
+/// binds a geometry pass program and sets the uniforms all draws share
+static void use_deferred_shader( deferred_shader_t * shader )
+{
+    use_model_shader( shader->id, shader->pos_offset, shader->pos_scale );
+
+    set_uniform( shader->view, intern.view );
+    set_uniform( shader->proj, intern.proj );
+    set_uniform( shader->material_texture, 1 );
+}
+
+/// the cheapest geometry pass program that draws it, untextured draws skip
+/// the texture fetch
+static deferred_shader_t * deferred_variant( int baked, int texture )
+{
+    int flags = rstate.packed_vertices ? VARIANT_PACKED : 0;
+    if ( baked ) {
+        flags |= VARIANT_BAKED;
+    } else if ( texture != -1 ) {
+        flags |= VARIANT_TEXTURED;
+    }
+
+    return intern.deferred_shader_list + flags;
+}
+
 static void render_scene()
 {
     vec4 white{ 1.0f, 1.0f, 1.0f, 1.0f };
     vec3 white_emission{ 1.0f, 1.0f, 1.0f };
     vec3 black_emission{ 0.0f, 0.0f, 0.0f };
 
-    for ( int i = 0; i < rstate.e_model_count; i++ ) {
-        int e = rstate.e_model_entity_list[ i ];
-        int model_id = rstate.entity_model_list[ e ];
-        int texture = rstate.model_texture_list[ model_id ];
+    float scale = pixel_scale( glm_rad( 45.0f ), hardware_height() );
+
+    vec4 planes[ 6 ];
+    glm_frustum_planes( rstate.combined, planes );
+
+    int draw_count = collect_draws( planes, scale );
+
+    deferred_shader_t * shader = nullptr;
+
+    // -2 is never a texture or material, so the first draw sets everything
+    int texture = -2;
+    int material = -2;
+    int model_id = -1;
+    int e = -1;
+
+    for ( int i = 0; i < draw_count; i++ ) {
+        draw_t & draw = intern.draw_list[ i ];
+
+        // draws are sorted untextured, textured and then baked, so the
+        // program changes at most twice. uniforms are per program, the
+        // new one gets everything set again.
+        deferred_shader_t * variant =
+            deferred_variant( draw.baked, draw.texture );
+        if ( variant != shader ) {
+            shader = variant;
+            use_deferred_shader( shader );
+
+            material = -2;
+            model_id = -1;
+            e = -1;
+        }
+
+        if ( !draw.baked && draw.texture != -1 && draw.texture != texture ) {
+            texture = draw.texture;
 
-        set_uniform(
-            intern.deferred_shader.model,
-            rstate.entity_transform_list[ e ].m
-        );
-        set_uniform( intern.deferred_shader.material_texture, 1 );
-        set_uniform( intern.deferred_shader.color, white );
-        set_uniform(
-            intern.deferred_shader.emission,
-            rstate.model_emission_list[ model_id ]
-        );
-        if ( texture == -1 ) {
-            glActiveTexture( GL_TEXTURE1 );
-            glBindTexture( GL_TEXTURE_2D, 0 );
-            set_uniform( intern.deferred_shader.material_mix, 1.0f );
-        } else {
             glActiveTexture( GL_TEXTURE1 );
             glBindTexture( GL_TEXTURE_2D, texture );
-            set_uniform( intern.deferred_shader.material_mix, 0.0f );
         }
 
-        render_model( model_id );
+        bool material_changed = draw.material != material;
+        bool model_changed = draw.model != model_id;
+
+        if ( material_changed ) {
+            material = draw.material;
+            set_uniform(
+                shader->color,
+                material == -1 ? white : rstate.material_color_list[ material ]
+            );
+        }
+
+        if ( model_changed ) {
+            model_id = draw.model;
+            bind_model( model_id );
+        }
+
+        if ( material_changed || model_changed ) {
+            vec3 emission;
+            glm_vec3_copy( rstate.model_emission_list[ model_id ], emission );
+            if ( material != -1 ) {
+                glm_vec3_add(
+                    emission,
+                    rstate.material_emission_list[ material ],
+                    emission
+                );
+            }
+            set_uniform( shader->emission, emission );
+        }
+
+        if ( draw.entity != e ) {
+            e = draw.entity;
+            set_uniform( shader->model, rstate.entity_transform_list[ e ].m );
+        }
+
+        draw_submesh( e, draw.submesh, draw.lod, planes, rstate.camera.pos );
     }
 
+    deferred_shader_t * plain = deferred_variant( 0, -1 );
+    if ( shader != plain ) use_deferred_shader( plain );
+
     // TODO: move outside of deferred pipeline
     glPolygonMode( GL_FRONT_AND_BACK, GL_LINE );
     for ( int i = 0; i < rstate.e_light_count; i++ ) {
         int e = rstate.e_light_entity_list[ i ];
-        int model_id = rstate.entity_model_list[ e ];
-        set_uniform(
-            intern.deferred_shader.model,
-            rstate.entity_transform_list[ e ].m
-        );
-        set_uniform( intern.deferred_shader.color, white );
-        set_uniform( intern.deferred_shader.emission, black_emission );
-        set_uniform( intern.deferred_shader.material_mix, 1.0f );
-        render_model( model_id );
+        int model_id = entity_model( e );
+        set_uniform( plain->model, rstate.entity_transform_list[ e ].m );
+        set_uniform( plain->color, white );
+        set_uniform( plain->emission, black_emission );
+        render_model( model_id, 0 );
+    }
+    for ( int i = 0; i < rstate.e_nocast_light_count; i++ ) {
+        int e = rstate.e_nocast_light_entity_list[ i ];
+        int model_id = entity_model( e );
+        set_uniform( plain->model, rstate.entity_transform_list[ e ].m );
+        set_uniform( plain->color, white );
+        set_uniform( plain->emission, black_emission );
+        render_model( model_id, 0 );
     }
     glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
 }
 
+static void setup_base_vertex()
+{
+    rstate.has_base_vertex = 0;
+
+#ifndef __EMSCRIPTEN__
+    int major = 0;
+    int minor = 0;
+    glGetIntegerv( GL_MAJOR_VERSION, &major );
+    glGetIntegerv( GL_MINOR_VERSION, &minor );
+
+    intern.draw_elements_base_vertex = nullptr;
+
+    if ( major > 3 || ( major == 3 && minor >= 2 ) ) {
+        intern.draw_elements_base_vertex = (draw_elements_base_vertex_t)
+            hardware_gl_proc( "glDrawElementsBaseVertex" );
+    }
+
+    rstate.has_base_vertex = intern.draw_elements_base_vertex != nullptr;
+#endif
+}
+
 static void setup_tables()
 {
     rstate.vertex_count = 0;
@@ -365,12 +1273,60 @@ static void setup_tables()
     rstate.vertex_pos_list = new float[ 1024 * 3 ];
     rstate.vertex_normal_list = new float[ 1024 * 3 ];
     rstate.vertex_uv_list = new float[ 1024 * 2 ];
+    rstate.vertex_color_list = new unsigned int[ 1024 ];
+
+    rstate.index_size = 0;
+    rstate.index_cap = 4096;
+    rstate.index_data = new char[ 4096 ];
 
     rstate.model_count = 0;
-    rstate.model_size_list = new int[ MEOWGL_MAX_MODEL_COUNT ];
-    rstate.model_offset_list = new int[ MEOWGL_MAX_MODEL_COUNT ];
-    rstate.model_emission_list = new vec3[ MEOWGL_MAX_MODEL_COUNT ];
-    rstate.model_texture_list = new int[ MEOWGL_MAX_MODEL_COUNT ];
+    rstate.model_cap = 32;
+    rstate.model_size_list = new int[ 32 ];
+    rstate.model_offset_list = new int[ 32 ];
+    rstate.model_index_count_list = new int[ 32 ];
+    rstate.model_index_offset_list = new int[ 32 ];
+    rstate.model_index_size_list = new int[ 32 ];
+    rstate.model_emission_list = new vec3[ 32 ];
+    rstate.model_texture_list = new int[ 32 ];
+    rstate.model_bounds_min_list = new vec3[ 32 ];
+    rstate.model_bounds_max_list = new vec3[ 32 ];
+    rstate.model_lod_count_list = new int[ 32 ];
+
+    rstate.model_cluster_offset_list = new int[ 32 ];
+    rstate.model_cluster_count_list = new int[ 32 ];
+
+    rstate.model_submesh_offset_list = new int[ 32 ];
+    rstate.model_submesh_count_list = new int[ 32 ];
+    rstate.model_resident_list = new int[ 32 ];
+    rstate.model_baked_list = new int[ 32 ];
+
+    rstate.submesh_count = 0;
+    rstate.submesh_cap = 64;
+    rstate.submesh_index_offset_list = new int[ 64 * MEOWGL_MAX_LOD_COUNT ];
+    rstate.submesh_index_count_list = new int[ 64 * MEOWGL_MAX_LOD_COUNT ];
+    rstate.submesh_bounds_min_list = new vec3[ 64 ];
+    rstate.submesh_bounds_max_list = new vec3[ 64 ];
+    rstate.submesh_material_list = new int[ 64 ];
+    rstate.submesh_first_cluster_list = new int[ 64 ];
+    rstate.submesh_cluster_count_list = new int[ 64 ];
+
+    rstate.material_count = 0;
+    rstate.material_cap = 64;
+    rstate.material_texture_list = new int[ 64 ];
+    rstate.material_color_list = new vec4[ 64 ];
+    rstate.material_emission_list = new vec3[ 64 ];
+
+    rstate.cluster_count = 0;
+    rstate.cluster_cap = 256;
+    rstate.cluster_index_offset_list = new int[ 256 ];
+    rstate.cluster_index_count_list = new int[ 256 ];
+    rstate.cluster_sphere_list = new vec4[ 256 ];
+    rstate.cluster_cone_list = new vec4[ 256 ];
+
+    int lod_cap = 32 * MEOWGL_MAX_LOD_COUNT;
+    rstate.lod_index_count_list = new int[ lod_cap ];
+    rstate.lod_index_offset_list = new int[ lod_cap ];
+    rstate.lod_error_list = new float[ lod_cap ];
 
     rstate.entity_count = 0;
     rstate.entity_model_list = new int[ MEOWGL_MAX_ENTITY_COUNT ];
@@ -389,8 +1345,17 @@ static void setup_tables()
 void render_init()
 {
     setup_tables();
+    setup_base_vertex();
+
+    intern.draw_cap = 256;
+    intern.draw_list = new draw_t[ 256 ];
 
     rstate.shadow_bias = 0.01;
+    rstate.packed_vertices = 1;
+    rstate.enable_lod = 1;
+    rstate.enable_cluster_culling = 1;
+    rstate.lod_pixel_error = 1.0f;
+    rstate.cull_pixel_size = 1.0f;
 
     float pos_buffer[ 6 * 2 ];
     float uv_buffer[ 6 * 2 ];
@@ -405,6 +1370,10 @@ void render_init()
     intern.vertex_pos_buffer.init( 3 );
     intern.vertex_normal_buffer.init( 3 );
     intern.vertex_uv_buffer.init( 2 );
+    intern.index_buffer.init();
+
+    intern.vertex_color_view = intern.vertex_uv_buffer;
+    intern.vertex_color_view.element_size = 4;
 
     intern.fb_pos_buffer.init( 2 );
     intern.fb_uv_buffer.init( 2 );
@@ -412,12 +1381,20 @@ void render_init()
     intern.fb_pos_buffer.set( pos_buffer, 6 );
     intern.fb_uv_buffer.set( uv_buffer, 6 );
 
-    init_shader1();
-    init_shader2();
-    init_shader3();
-    init_shader4();
-    init_shader5();
-    init_shader6();
+    // everything goes to the driver before the first status query, then
+    // the first frame waits for the programs without a fallback
+    program_cache_init();
+    check_program_sections();
+    for ( int i = 0; i < PROGRAM_COUNT; i++ ) {
+        submit_program( program_list + i );
+    }
+    for ( int i = 0; i < PROGRAM_COUNT; i++ ) {
+        if ( program_list[ i ].fallback == -1 ) {
+            finish_program( program_list + i, true );
+        }
+    }
+    init_fallback_programs();
+    program_cache_flush();
 
     intern.deferred_fb.init( hardware_width(), hardware_height() );
 
@@ -454,12 +1431,33 @@ void render_init()
 
 void update_vertex_buffers()
 {
-    intern.vertex_pos_buffer.set( rstate.vertex_pos_list, rstate.vertex_count );
-    intern.vertex_normal_buffer.set(
-        rstate.vertex_normal_list,
-        rstate.vertex_count
+    intern.index_buffer.set( rstate.index_data, rstate.index_size );
+
+    if ( rstate.packed_vertices ) {
+        upload_packed_vertices();
+        return;
+    }
+
+    int count = rstate.vertex_count;
+
+    float * uv_list = new float[ count * 2 ];
+    memcpy( uv_list, rstate.vertex_uv_list, sizeof( float ) * count * 2 );
+    write_baked_colors( uv_list, 2 * sizeof( float ) );
+
+    intern.vertex_pos_buffer.set_format( 3, GL_FLOAT, 3 * sizeof( float ) );
+    intern.vertex_normal_buffer.set_format( 3, GL_FLOAT, 3 * sizeof( float ) );
+    intern.vertex_uv_buffer.set_format( 2, GL_FLOAT, 2 * sizeof( float ) );
+    intern.vertex_color_view.set_format(
+        4,
+        GL_UNSIGNED_BYTE,
+        2 * sizeof( float )
     );
-    intern.vertex_uv_buffer.set( rstate.vertex_uv_list, rstate.vertex_count );
+
+    intern.vertex_pos_buffer.set( rstate.vertex_pos_list, count );
+    intern.vertex_normal_buffer.set( rstate.vertex_normal_list, count );
+    intern.vertex_uv_buffer.set( uv_list, count );
+
+    delete[] uv_list;
 }
 
 static void render_fb()
@@ -480,7 +1478,11 @@ static void render_highlight()
     glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-    glUseProgram( intern.highlight_shader.id );
+    use_model_shader(
+        intern.highlight_shader.id,
+        intern.highlight_shader.pos_offset,
+        intern.highlight_shader.pos_scale
+    );
 
     int e = rstate.hi_entity;
     set_uniform( intern.highlight_shader.proj, intern.proj );
@@ -489,11 +1491,11 @@ static void render_highlight()
         intern.highlight_shader.model,
         rstate.entity_transform_list[ e ].m
     );
-    render_model( rstate.entity_model_list[ e ] );
+    render_model( entity_model( e ), 0 );
 
     glBindFramebuffer( GL_FRAMEBUFFER, 0 );
 
-    glUseProgram( intern.highlight_post_shader.id );
+    use_program( intern.highlight_post_shader.id );
 
     glActiveTexture( GL_TEXTURE0 );
     glBindTexture( GL_TEXTURE_2D, intern.highlight_fb_texture );
@@ -534,11 +1536,6 @@ static void do_geometry_pass()
     glViewport( 0, 0, hardware_width(), hardware_height() );
     glCullFace( GL_BACK );
 
-    glUseProgram( intern.deferred_shader.id );
-
-    set_uniform( intern.deferred_shader.view, intern.view );
-    set_uniform( intern.deferred_shader.proj, intern.proj );
-
     render_scene();
 }
 
@@ -592,13 +1589,27 @@ static void compute_shadow_map( int shadow_index, vec3 pos, int dir )
 
     set_uniform( intern.shadow_shader.combined, m );
 
+    // 90 degree faces on a square tile
+    float scale = pixel_scale( glm_rad( 90.0f ), tile[ 3 ] );
+
+    vec4 planes[ 6 ];
+    glm_frustum_planes( m, planes );
+
     for ( int i = 0; i < rstate.e_model_count; i++ ) {
         int e = rstate.e_model_entity_list[ i ];
+
+        int lod = select_lod( e, pos, scale );
+        if ( lod < 0 ) continue;
+
         set_uniform(
             intern.shadow_shader.model,
             rstate.entity_transform_list[ e ].m
         );
-        render_model( rstate.entity_model_list[ e ] );
+        if ( lod == 0 ) {
+            render_model_clusters( e, planes, pos );
+        } else {
+            render_model( entity_model( e ), lod );
+        }
     }
 }
 
@@ -606,7 +1617,11 @@ void compute_all_shadow_maps()
 {
     glBindFramebuffer( GL_FRAMEBUFFER, intern.depth_fb.id );
     glClear( GL_DEPTH_BUFFER_BIT );
-    glUseProgram( intern.shadow_shader.id );
+    use_model_shader(
+        intern.shadow_shader.id,
+        intern.shadow_shader.pos_offset,
+        intern.shadow_shader.pos_scale
+    );
     enable_n_attachments( 1 );
 
     int shadow_count = 0;
@@ -649,7 +1664,7 @@ static void do_all_shadow_passes()
     glViewport( 0, 0, hardware_width(), hardware_height() );
     glClearColor( 0.0f, 0.0f, 0.0f, 1.0f );
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-    glUseProgram( intern.light_shader.id );
+    use_program( intern.light_shader.id );
     enable_n_attachments( 1 );
 
     glActiveTexture( GL_TEXTURE0 );
@@ -680,6 +1695,21 @@ static void do_all_shadow_passes()
         do_shadow_pass( shadow_count++, pos, 5 );
     }
 
+    // lights that cast no shadow need no shadow map, one pass each
+    if ( rstate.e_nocast_light_count > 0 ) {
+        light_shader_t * shader = &intern.nocast_light_shader;
+        use_program( shader->id );
+        set_uniform( shader->position_texture, 0 );
+        set_uniform( shader->normal_texture, 1 );
+
+        for ( int i = 0; i < rstate.e_nocast_light_count; i++ ) {
+            int e = rstate.e_nocast_light_entity_list[ i ];
+            vec3 & pos = rstate.entity_transform_list[ e ].pos;
+            set_uniform( shader->light_pos, pos );
+            render_fb();
+        }
+    }
+
     glEnable( GL_CULL_FACE );
     glEnable( GL_DEPTH_TEST );
     glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA ); // blend alpha
@@ -698,7 +1728,7 @@ static void do_composition_pass()
     glClearColor( 0.0f, 0.0f, 0.0f, 1.0f );
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-    glUseProgram( intern.scene_compose_shader.id );
+    use_program( intern.scene_compose_shader.id );
 
     glActiveTexture( GL_TEXTURE0 );
     glBindTexture( GL_TEXTURE_2D, intern.deferred_color_texture );
@@ -723,6 +1753,8 @@ static void do_composition_pass()
 
 void render()
 {
+    poll_programs();
+
     // compute_all_shadow_maps();
 
     do_geometry_pass();
@@ -4,8 +4,8 @@
 
 #include <cglm/types.h>
 
-#define MEOWGL_MAX_MODEL_COUNT  32
 #define MEOWGL_MAX_ENTITY_COUNT 1024
+#define MEOWGL_MAX_LOD_COUNT    4
 
 struct transform_t {
     vec3 pos;
@@ -29,14 +29,59 @@ struct renderstate_t {
     float *        vertex_pos_list;            // VERTEX TABLE
     float *        vertex_normal_list;
     float *        vertex_uv_list;
+    unsigned int * vertex_color_list;          // rgba8, white unless baked
     int            vertex_count;
     int            vertex_cap;
 
-    int *          model_size_list;            // MODEL TABLE
-    int *          model_offset_list;          //
-    int *          model_texture_list;         //
+    char *         index_data;                 // INDEX TABLE (16 or 32 bit)
+    int            index_size;                 // in bytes
+    int            index_cap;                  //
+
+    int *          model_size_list;            // MODEL TABLE (vertex count)
+    int *          model_offset_list;          // first vertex
+    int *          model_index_count_list;     //
+    int *          model_index_offset_list;    // in bytes
+    int *          model_index_size_list;      // 2 or 4 bytes per index
+    int *          model_texture_list;         // -1 = use the materials
     vec3 *         model_emission_list;        //
+    vec3 *         model_bounds_min_list;      // object space
+    vec3 *         model_bounds_max_list;      //
+    int *          model_lod_count_list;       // 1 = only the full mesh
+    int *          model_cluster_offset_list;  // first cluster
+    int *          model_cluster_count_list;   // 0 = draw whole
+    int *          model_submesh_offset_list;  // first submesh
+    int *          model_submesh_count_list;   //
+    int *          model_resident_list;        // 0 while loading
+    int *          model_baked_list;           // colors instead of textures
+
+    int *          lod_index_count_list;       // LOD TABLE
+    int *          lod_index_offset_list;      // [ model * MAX_LOD + lod ]
+    float *        lod_error_list;             // object space
+
+    int *          submesh_index_offset_list;  // SUBMESH TABLE (bytes)
+    int *          submesh_index_count_list;   // [ submesh * MAX_LOD + lod ]
+    vec3 *         submesh_bounds_min_list;    // object space
+    vec3 *         submesh_bounds_max_list;    //
+    int *          submesh_material_list;      // -1 = none
+    int *          submesh_first_cluster_list; //
+    int *          submesh_cluster_count_list; // 0 = draw whole
+    int            submesh_count;              //
+    int            submesh_cap;                //
+
+    int *          material_texture_list;      // MATERIAL TABLE (-1 = none)
+    vec4 *         material_color_list;        //
+    vec3 *         material_emission_list;     //
+    int            material_count;             //
+    int            material_cap;               //
+
+    int *          cluster_index_offset_list;  // CLUSTER TABLE (lod 0 only)
+    int *          cluster_index_count_list;   // first index, in the model
+    vec4 *         cluster_sphere_list;        // object space, w = radius
+    vec4 *         cluster_cone_list;          // xyz = axis, w = cutoff
+    int            cluster_count;              //
+    int            cluster_cap;                //
     int            model_count;                //
+    int            model_cap;                  // also for the lod table
 
     transform_t *  entity_transform_list;      // ENTITY TABLE
     int *          entity_model_list;          //
@@ -54,6 +99,8 @@ struct renderstate_t {
 
     int light_model; // model used for visualizing lights
 
+    int placeholder_model; // drawn for models that are not resident yet
+
     int hi_entity; // entity to highlight/outline
 
     camera_t camera; // for moving the camera
@@ -63,6 +110,15 @@ struct renderstate_t {
     mat4 combined; // for raycasting to things
 
     float shadow_bias;
+
+    int has_base_vertex; // model indices are model local
+
+    int packed_vertices; // upload quantized vertices, 16 instead of 32 bytes
+
+    int enable_lod;
+    int enable_cluster_culling;
+    float lod_pixel_error; // coarsest level within this error is drawn
+    float cull_pixel_size; // entities with a smaller radius are skipped
 };
 
 extern renderstate_t rstate;
@@ -76,3 +132,19 @@ void compute_all_shadow_maps();
 void compute_camera_matrices();
 
 void update_vertex_buffers();
+
+/// hands the programs whose shaders.glsl sections changed to the driver,
+/// they replace the running ones as they finish. returns how many.
+int reload_shaders();
+
+int program_count();
+
+/// programs built and not rebuilding
+int program_ready_count();
+
+/// index into the vertex table of the i'th index of a model
+int model_vertex_index( int model_id, int i );
+
+/// object space position of the i'th index of a model as the gpu sees it,
+/// so picking agrees with what is drawn when vertices are packed
+void model_vertex_pos( int model_id, int i, float * out_pos );
@@ -1,7 +1,14 @@
 #include "render_utils.hpp"
 
+#include "hardware.hpp"
 #include "logging.hpp"
+#include "program_cache.hpp"
 #include "res.hpp"
+#include "shader_sections.hpp"
+
+#if RELEASE
+#include "shader_table.hpp" // generated, see tools/shaderpack.cpp
+#endif
 
 #ifdef __EMSCRIPTEN__
 #include <GLES3/gl3.h>
@@ -9,200 +16,460 @@
 #include <glad/glad.h>
 #endif
 
-#include <sstream>
+#include <stdio.h>
 #include <string.h>
-#include <string>
-#include <vector>
 
-static int match_shader_line( const char * line, const char * name )
+#if RELEASE
+
+/// source of the section, nullptr if there is none
+static const char * lookup_shader_string( const char * name )
+{
+    for ( int i = 0; i < shader_table_count; i++ ) {
+        if ( strcmp( shader_table[ i ].name, name ) == 0 ) {
+            return shader_table[ i ].source;
+        }
+    }
+
+    return nullptr;
+}
+
+void reload_shader_strings()
+{
+}
+
+#else
+
+// shaders.glsl as it is on disk, read on the first lookup and again after
+// every reload_shader_strings
+static struct {
+    char * text; // cut into the sections, nullptr until read
+    shader_section_t section_list[ MAX_SHADER_SECTION_COUNT ];
+    int section_count;
+} shader_index;
+
+static void read_shader_index()
 {
-    char buffer[ 128 ];
-    snprintf( buffer, 128, "#shader %s", name );
+    res_t res = find_res( "shaders.glsl" );
+
+    shader_index.text = new char[ res.size + 1 ];
+    memcpy( shader_index.text, res.data, res.size );
+    shader_index.text[ res.size ] = '\0';
+
+    release_res( &res );
+
+    shader_index.section_count = split_shader_sections(
+        shader_index.text,
+        shader_index.section_list,
+        MAX_SHADER_SECTION_COUNT
+    );
 
-    return strncmp( line, buffer, strlen( buffer ) ) == 0;
+    if ( shader_index.section_count < 0 ) {
+        ERROR_LOG(
+            "shaders.glsl has more than %d sections",
+            MAX_SHADER_SECTION_COUNT
+        );
+        shader_index.section_count = 0;
+    }
 }
 
-static int match_any_shader_line( const char * line )
+/// source of the section, nullptr if there is none
+static const char * lookup_shader_string( const char * name )
 {
-    const char * buffer = "#shader";
-    return strncmp( line, buffer, strlen( buffer ) ) == 0;
+    if ( !shader_index.text ) read_shader_index();
+
+    for ( int i = 0; i < shader_index.section_count; i++ ) {
+        shader_section_t & section = shader_index.section_list[ i ];
+        if ( strcmp( section.name, name ) == 0 ) return section.source;
+    }
+
+    return nullptr;
 }
 
-// TODO: make this less c++ dependent?
+void reload_shader_strings()
+{
+    delete[] shader_index.text;
+    shader_index.text = nullptr;
+    shader_index.section_count = 0;
+}
+
+#endif
+
 const char * find_shader_string( const char * name )
 {
-    res_t shader_res = find_res( "shaders.glsl" );
-    const unsigned char * shaders = shader_res.data;
-    int len = shader_res.size;
+    const char * source = lookup_shader_string( name );
+    if ( source ) return source;
+
+    ERROR_LOG( "failed to find shader: %s", name );
+    return "";
+}
+
+bool has_shader_string( const char * name )
+{
+    return lookup_shader_string( name ) != nullptr;
+}
+
+/// last value sent to one uniform of one program
+struct uniform_value_t {
+    int program;
+    int size; // in bytes, 0 when unknown
+    unsigned char data[ 64 ];
+};
+
+// what each program's uniforms hold, so set_uniform can skip the driver
+// call when the value did not change
+static struct {
+    int program; // current, glUseProgram only through use_program
+
+    hash_map_t map; // program << 32 | location to an index into value_list
+    uniform_value_t * value_list;
+    int value_count;
+    int value_cap;
+} uniform_cache;
+
+void use_program( int program )
+{
+    if ( program == uniform_cache.program ) return;
+
+    uniform_cache.program = program;
+    glUseProgram( program );
+}
+
+/// drops what was known of a program, its id may belong to an older one
+static void forget_uniforms( int program )
+{
+    for ( int i = 0; i < uniform_cache.value_count; i++ ) {
+        uniform_value_t & value = uniform_cache.value_list[ i ];
+        if ( value.program == program ) value.size = 0;
+    }
+
+    if ( uniform_cache.program == program ) uniform_cache.program = -1;
+}
+
+#define MAX_SHADER_INCLUDE_DEPTH 8
+
+/// growing, unterminated text
+struct text_buffer_t {
+    char * data;
+    int size;
+    int cap;
+};
+
+static void append_text( text_buffer_t * out, const char * s, int size )
+{
+    // resize
+    if ( out->size + size > out->cap ) {
+        int new_cap = ( out->size + size ) * 2;
+        char * data = new char[ new_cap ];
+        memcpy( data, out->data, out->size );
 
-    // split into lines
-    std::vector< std::string > lines;
+        delete[] out->data;
 
-    {
-        std::string line;
-        for ( int i = 0; i < len; i++ ) {
-            if ( shaders[ i ] == '\n' ) {
-                lines.push_back( line );
-                line = "";
+        out->data = data;
+        out->cap = new_cap;
+    }
+
+    memcpy( out->data + out->size, s, size );
+    out->size += size;
+}
+
+/// copies the source with every #include "section" line replaced by that
+/// section
+static void expand_includes(
+    text_buffer_t * out,
+    const char * source,
+    int depth
+)
+{
+    const char * line = source;
+    while ( *line ) {
+        const char * end = strchr( line, '\n' );
+        int size = end ? end - line + 1 : strlen( line );
+
+        const char * s = line;
+        while ( *s == ' ' || *s == '\t' ) s++;
+
+        char name[ 64 ];
+        if ( strncmp( s, "#include", 8 ) == 0 &&
+             sscanf( s + 8, " \"%63[^\"]\"", name ) == 1 ) {
+            if ( depth < MAX_SHADER_INCLUDE_DEPTH ) {
+                expand_includes( out, find_shader_string( name ), depth + 1 );
+                if ( out->size > 0 && out->data[ out->size - 1 ] != '\n' ) {
+                    append_text( out, "\n", 1 );
+                }
             } else {
-                line += shaders[ i ];
+                ERROR_LOG(
+                    "shader includes nest deeper than %d at %s",
+                    MAX_SHADER_INCLUDE_DEPTH,
+                    name
+                );
             }
+        } else {
+            append_text( out, line, size );
         }
+
+        line += size;
     }
+}
+
+char * expand_shader( const char * name, const char * defines )
+{
+    const char * source = find_shader_string( name );
+
+    text_buffer_t out;
+    out.size = 0;
+    out.cap = strlen( source ) * 2 + 256;
+    out.data = new char[ out.cap ];
+
+    // #version has to come before anything but comments, the defines go
+    // right after it
+    const char * body = source;
+    const char * line = source;
+    while ( *line ) {
+        const char * end = strchr( line, '\n' );
 
-    // find shader line
-    int matched_line = -1;
-    for ( int i = 0; i < (int) lines.size(); i++ ) {
-        if ( match_shader_line( lines[ i ].c_str(), name ) ) {
-            matched_line = i;
+        const char * s = line;
+        while ( *s == ' ' || *s == '\t' ) s++;
+
+        if ( strncmp( s, "#version", 8 ) == 0 ) {
+            body = end ? end + 1 : s + strlen( s );
             break;
         }
-    }
 
-    // no match
-    if ( matched_line == -1 ) {
-        ERROR_LOG( "failed to find shader: %s", name );
-        return "";
-    }
+        bool blank = *s == '\n' || *s == '\r' || *s == '\0';
+        if ( !blank && strncmp( s, "//", 2 ) != 0 ) break;
+        if ( !end ) break;
 
-    // match lines
-    std::vector< std::string > matched_lines;
-    for ( int i = matched_line + 1; i < (int) lines.size(); i++ ) {
-        // stop when we get to another shader
-        if ( match_any_shader_line( lines[ i ].c_str() ) ) break;
-        matched_lines.push_back( lines[ i ] );
+        line = end + 1;
     }
 
-    // combine lines into one string
-    std::stringstream ss;
-    for ( std::string & line : matched_lines ) {
-        ss << line << '\n';
-    }
+    append_text( &out, source, body - source );
+    if ( body > source && body[ -1 ] != '\n' ) append_text( &out, "\n", 1 );
 
-    // TODO: lol yea i know
-    std::string * str = new std::string( ss.str() );
+    append_text( &out, defines, strlen( defines ) );
+    expand_includes( &out, body, 0 );
+    append_text( &out, "", 1 );
 
-    return str->c_str();
+    return out.data;
 }
 
-static int create_shader( int * out, int type, const char * source )
+// gl 4.6, KHR_parallel_shader_compile and ARB_parallel_shader_compile
+#define GL_COMPLETION_STATUS 0x91B1
+
+#ifndef __EMSCRIPTEN__
+typedef void( APIENTRYP max_shader_compiler_threads_t )( GLuint count );
+#endif
+
+// the driver compiles on its own threads and says when a program is done,
+// looked up on the first submit_shader
+static struct {
+    bool looked_up;
+    bool enabled;
+} parallel_compile;
+
+bool has_gl_extension( const char * name )
 {
-    int shader;
-    int compiled;
+    int count = 0;
+    glGetIntegerv( GL_NUM_EXTENSIONS, &count );
 
-    // DEBUG_LOG("Shader source:\n%s", source);
+    for ( int i = 0; i < count; i++ ) {
+        const char * s = (const char *) glGetStringi( GL_EXTENSIONS, i );
+        if ( s && strcmp( s, name ) == 0 ) return true;
+    }
 
-    shader = glCreateShader( type );
+    return false;
+}
 
-    if ( shader == 0 ) {
-        ERROR_LOG( "failed to create shader" );
-        return 1;
+static void init_parallel_compile()
+{
+    parallel_compile.looked_up = true;
+
+    bool khr = has_gl_extension( "GL_KHR_parallel_shader_compile" );
+    bool arb = !khr && has_gl_extension( "GL_ARB_parallel_shader_compile" );
+    parallel_compile.enabled = khr || arb;
+
+    if ( !parallel_compile.enabled ) {
+        INFO_LOG( "no parallel shader compile, programs build one by one" );
+        return;
     }
 
-    glShaderSource( shader, 1, &source, nullptr );
+#ifndef __EMSCRIPTEN__
+    // webgl picks the thread count itself, desktop drivers may need asking
+    max_shader_compiler_threads_t max_threads =
+        (max_shader_compiler_threads_t) hardware_gl_proc(
+            khr ? "glMaxShaderCompilerThreadsKHR"
+                : "glMaxShaderCompilerThreadsARB"
+        );
 
-    glCompileShader( shader );
+    // all the threads the driver likes
+    if ( max_threads ) max_threads( 0xffffffff );
+#endif
+}
 
-    glGetShaderiv( shader, GL_COMPILE_STATUS, &compiled );
+/// logs the info log of a shader that did not compile
+static bool check_shader( int shader )
+{
+    if ( shader == 0 ) {
+        ERROR_LOG( "failed to create shader" );
+        return false;
+    }
 
-    if ( !compiled ) {
-        int info_len = 0;
+    int compiled;
+    glGetShaderiv( shader, GL_COMPILE_STATUS, &compiled );
+    if ( compiled ) return true;
 
-        glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &info_len );
+    int info_len = 0;
 
-        if ( info_len > 1 ) {
-            char * info_log = new char[ sizeof( char ) * info_len ];
+    glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &info_len );
 
-            glGetShaderInfoLog( shader, info_len, nullptr, info_log );
-            ERROR_LOG( "failed to compile shader:\n" );
-            printf( "\n%s\n", info_log );
+    if ( info_len > 1 ) {
+        char * info_log = new char[ sizeof( char ) * info_len ];
 
-            delete[] info_log;
-        } else {
-            ERROR_LOG( "failed to compile shader (no error message)" );
-        }
+        glGetShaderInfoLog( shader, info_len, nullptr, info_log );
+        ERROR_LOG( "failed to compile shader:\n" );
+        printf( "\n%s\n", info_log );
 
-        glDeleteShader( shader );
-        return 1;
+        delete[] info_log;
+    } else {
+        ERROR_LOG( "failed to compile shader (no error message)" );
     }
 
-    *out = shader;
-
-    return 0;
+    return false;
 }
 
-static int create_shader_program( int * out, int * shaders, int count )
+/// logs the info log of a program that did not link
+static bool check_program( int program )
 {
-    int program;
     int linked;
+    glGetProgramiv( program, GL_LINK_STATUS, &linked );
+    if ( linked ) return true;
 
-    program = glCreateProgram();
+    int info_len = 0;
 
-    if ( program == 0 ) {
-        ERROR_LOG( "failed to create shader program" );
-        return 1;
-    }
+    glGetProgramiv( program, GL_INFO_LOG_LENGTH, &info_len );
 
-    for ( int i = 0; i < count; i++ ) {
-        glAttachShader( program, shaders[ i ] );
+    if ( info_len > 1 ) {
+        char * info_log = new char[ sizeof( char ) * info_len ];
+
+        glGetProgramInfoLog( program, info_len, nullptr, info_log );
+        ERROR_LOG( "failed to compile program:\n%s", info_log );
+
+        delete[] info_log;
+    } else {
+        ERROR_LOG( "failed to compile program (no error message)" );
     }
 
-    glLinkProgram( program );
+    return false;
+}
 
-    glGetProgramiv( program, GL_LINK_STATUS, &linked );
+static int compile_shader( int type, const char * source )
+{
+    int shader = glCreateShader( type );
+    if ( shader == 0 ) return 0;
 
-    if ( !linked ) {
-        int info_len = 0;
+    glShaderSource( shader, 1, &source, nullptr );
+    glCompileShader( shader );
 
-        glGetProgramiv( program, GL_INFO_LOG_LENGTH, &info_len );
+    return shader;
+}
 
-        if ( info_len > 1 ) {
-            char * info_log = new char[ sizeof( char ) * info_len ];
+/// binds the attributes to locations in the order the vertex shader
+/// declares them, the layout the vertex buffers are enabled in
+static void bind_attributes( int program, const char * vertex_source )
+{
+    int location = 0;
 
-            glGetProgramInfoLog( program, info_len, nullptr, info_log );
-            ERROR_LOG( "failed to compile program:\n%s", info_log );
+    const char * line = vertex_source;
+    while ( line ) {
+        while ( *line == ' ' || *line == '\t' ) line++;
 
-            delete[] info_log;
-        } else {
-            ERROR_LOG( "failed to compile program (no error message)" );
+        char type[ 32 ];
+        char name[ 64 ];
+        if ( strncmp( line, "attribute ", 10 ) == 0 &&
+             sscanf( line + 10, "%31s %63[A-Za-z0-9_]", type, name ) == 2 ) {
+            glBindAttribLocation( program, location++, name );
         }
 
-        glDeleteProgram( program );
-        return 1;
+        line = strchr( line, '\n' );
+        if ( line ) line++;
+    }
+}
+
+void submit_shader(
+    shader_job_t * out,
+    const char * vertex_source,
+    const char * fragment_source
+)
+{
+    if ( !parallel_compile.looked_up ) init_parallel_compile();
+
+    out->key = program_cache_key( vertex_source, fragment_source );
+    out->shaders[ 0 ] = 0;
+    out->shaders[ 1 ] = 0;
+
+    out->program = program_cache_load( out->key );
+    out->cached = out->program != -1;
+    if ( out->cached ) {
+        forget_uniforms( out->program );
+        return;
+    }
+
+    out->shaders[ 0 ] = compile_shader( GL_VERTEX_SHADER, vertex_source );
+    out->shaders[ 1 ] = compile_shader( GL_FRAGMENT_SHADER, fragment_source );
+
+    // no status queries until finish_shader, each one would wait for the
+    // driver to get there
+    out->program = glCreateProgram();
+    forget_uniforms( out->program );
+    for ( int i = 0; i < 2; i++ ) {
+        if ( out->shaders[ i ] ) {
+            glAttachShader( out->program, out->shaders[ i ] );
+        }
     }
 
-    *out = program;
+    bind_attributes( out->program, vertex_source );
 
-    return 0;
+    program_cache_hint( out->program );
+    glLinkProgram( out->program );
 }
 
-int build_shader( const char * vertex_source, const char * fragment_source )
+bool shader_ready( shader_job_t * job )
 {
-    int shaders[ 2 ];
-    int error;
-    int program = -1;
+    if ( job->cached || !parallel_compile.enabled ) return true;
 
-    error = create_shader( shaders + 0, GL_VERTEX_SHADER, vertex_source );
-    if ( error ) {
-        return 1;
-    }
+    int done = 0;
+    glGetProgramiv( job->program, GL_COMPLETION_STATUS, &done );
+
+    return done;
+}
+
+int finish_shader( shader_job_t * job )
+{
+    if ( job->cached ) return job->program;
+
+    bool linked = check_shader( job->shaders[ 0 ] ) &&
+                  check_shader( job->shaders[ 1 ] ) &&
+                  check_program( job->program );
 
-    error = create_shader( shaders + 1, GL_FRAGMENT_SHADER, fragment_source );
-    if ( error ) {
-        goto cleanup_shader1;
+    for ( int i = 0; i < 2; i++ ) {
+        if ( job->shaders[ i ] ) glDeleteShader( job->shaders[ i ] );
     }
 
-    error = create_shader_program( &program, shaders, 2 );
-    if ( error ) {
-        goto cleanup_shader2;
+    if ( !linked ) {
+        glDeleteProgram( job->program );
+        return -1;
     }
 
-cleanup_shader2:
-    glDeleteShader( shaders[ 1 ] );
-cleanup_shader1:
-    glDeleteShader( shaders[ 0 ] );
+    program_cache_save( job->program, job->key );
+
+    return job->program;
+}
+
+int build_shader( const char * vertex_source, const char * fragment_source )
+{
+    shader_job_t job;
+    submit_shader( &job, vertex_source, fragment_source );
 
-    return program;
+    return finish_shader( &job );
 }
 
 void vbuffer_t::init( int new_element_size )
@@ -213,16 +480,29 @@ void vbuffer_t::init( int new_element_size )
     buffer = new_buffer;
     element_size = new_element_size;
     element_count = 0;
+    type = GL_FLOAT;
+    stride = new_element_size * sizeof( GLfloat );
 }
 
-void vbuffer_t::set( const float * new_data, int new_element_count )
+void vbuffer_t::set_format(
+    int new_element_size,
+    int new_type,
+    int new_stride
+)
+{
+    element_size = new_element_size;
+    type = new_type;
+    stride = new_stride;
+}
+
+void vbuffer_t::set( const void * new_data, int new_element_count )
 {
     glBindBuffer( GL_ARRAY_BUFFER, buffer );
     glBufferData(
-        GL_ARRAY_BUFFER,                                    // type
-        new_element_count * element_size * sizeof( float ), // size in bytes
-        new_data,                                           // data pointer
-        GL_STATIC_DRAW                                      // render strategy
+        GL_ARRAY_BUFFER,            // type
+        new_element_count * stride, // size in bytes
+        new_data,                   // data pointer
+        GL_STATIC_DRAW              // render strategy
     );
 
     element_count = new_element_count;
@@ -230,18 +510,42 @@ void vbuffer_t::set( const float * new_data, int new_element_count )
 
 void vbuffer_t::enable( int attrib_index )
 {
+    int normalize = type != GL_FLOAT && type != GL_HALF_FLOAT;
+
     glBindBuffer( GL_ARRAY_BUFFER, buffer );
     glEnableVertexAttribArray( attrib_index );
     glVertexAttribPointer(
-        attrib_index,                     // attrib index
-        element_size,                     // element size
-        GL_FLOAT,                         // type
-        GL_FALSE,                         // normalize
-        element_size * sizeof( GLfloat ), // stride
-        (void *) ( 0 )                    // offset
+        attrib_index,                   // attrib index
+        element_size,                   // element size
+        type,                           // type
+        normalize ? GL_TRUE : GL_FALSE, // normalize
+        stride,                         // stride
+        (void *) ( 0 )                  // offset
     );
 }
 
+void ibuffer_t::init()
+{
+    unsigned int new_buffer;
+    glGenBuffers( 1, &new_buffer );
+
+    buffer = new_buffer;
+    size = 0;
+}
+
+void ibuffer_t::set( const void * new_data, int new_size )
+{
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, buffer );
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER, new_size, new_data, GL_STATIC_DRAW );
+
+    size = new_size;
+}
+
+void ibuffer_t::bind()
+{
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, buffer );
+}
+
 int find_uniform( int shader, const char * uniform_name )
 {
     int location = glGetUniformLocation( shader, uniform_name );
@@ -251,33 +555,90 @@ int find_uniform( int shader, const char * uniform_name )
     return location;
 }
 
+/// true if the uniform of the current program already holds the value,
+/// otherwise remembers it for next time
+static bool uniform_unchanged( int uniform, const void * data, int size )
+{
+    // -1 is an unused uniform, glUniform ignores it anyway
+    if ( uniform < 0 ) return true;
+
+    if ( !uniform_cache.map.key_list ) {
+        hash_map_init( &uniform_cache.map, 256 );
+        uniform_cache.value_list = new uniform_value_t[ 64 ];
+        uniform_cache.value_count = 0;
+        uniform_cache.value_cap = 64;
+    }
+
+    hash_t key = (hash_t) uniform_cache.program << 32 | (unsigned) uniform;
+    int index = hash_map_find( &uniform_cache.map, key );
+
+    if ( index == -1 ) {
+        // resize
+        if ( uniform_cache.value_count >= uniform_cache.value_cap ) {
+            int new_cap = uniform_cache.value_cap * 2;
+            uniform_value_t * list = new uniform_value_t[ new_cap ];
+            memcpy(
+                list,
+                uniform_cache.value_list,
+                sizeof( uniform_value_t ) * uniform_cache.value_count
+            );
+
+            delete[] uniform_cache.value_list;
+
+            uniform_cache.value_list = list;
+            uniform_cache.value_cap = new_cap;
+        }
+
+        index = uniform_cache.value_count++;
+        uniform_cache.value_list[ index ].program = uniform_cache.program;
+        uniform_cache.value_list[ index ].size = 0;
+        hash_map_set( &uniform_cache.map, key, index );
+    }
+
+    uniform_value_t & value = uniform_cache.value_list[ index ];
+    if ( value.size == size && memcmp( value.data, data, size ) == 0 ) {
+        return true;
+    }
+
+    value.size = size;
+    memcpy( value.data, data, size );
+
+    return false;
+}
+
 void set_uniform( int uniform, int v )
 {
+    if ( uniform_unchanged( uniform, &v, sizeof( v ) ) ) return;
     glUniform1i( uniform, v );
 }
 
 void set_uniform( int uniform, float v )
 {
+    if ( uniform_unchanged( uniform, &v, sizeof( v ) ) ) return;
     glUniform1f( uniform, v );
 }
 
 void set_uniform( int uniform, float ( &v )[ 2 ] )
 {
+    if ( uniform_unchanged( uniform, v, sizeof( v ) ) ) return;
     glUniform2fv( uniform, 1, v );
 }
 
 void set_uniform( int uniform, float ( &v )[ 3 ] )
 {
+    if ( uniform_unchanged( uniform, v, sizeof( v ) ) ) return;
     glUniform3fv( uniform, 1, v );
 }
 
 void set_uniform( int uniform, float ( &v )[ 4 ] )
 {
+    if ( uniform_unchanged( uniform, v, sizeof( v ) ) ) return;
     glUniform4fv( uniform, 1, v );
 }
 
 void set_uniform( int uniform, vec4 ( &m )[ 4 ] )
 {
+    if ( uniform_unchanged( uniform, m, sizeof( m ) ) ) return;
     glUniformMatrix4fv( uniform, 1, GL_FALSE, (float *) m );
 }
 
@@ -406,69 +767,35 @@ int framebuffer_t::init_color_texture( int attachment_index )
     return texture;
 }
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
-int load_texture( res_t res )
+int load_texture_pixels( const unsigned char * rgba, int width, int height )
 {
     unsigned int texture;
     glGenTextures( 1, &texture );
-    glBindTexture( GL_TEXTURE_2D, texture );
 
-    int error = 0;
-    // generate a texture
     glBindTexture( GL_TEXTURE_2D, texture );
-    // set the texture wrapping/filtering options (on the currently bound
-    // texture object)
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
     glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
     glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-    // glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-    // glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-    //  load and generate the texture
-    int width, height, nrChannels;
-    unsigned char * data = stbi_load_from_memory(
-        res.data,
-        res.size,
-        &width,
-        &height,
-        &nrChannels,
-        0
+
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        GL_RGBA,
+        width,
+        height,
+        0,
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        rgba
     );
-    if ( data ) {
-        glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
-        if ( nrChannels == 3 ) {
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RGB,
-                width,
-                height,
-                0,
-                GL_RGB,
-                GL_UNSIGNED_BYTE,
-                data
-            );
-        } else {
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RGBA,
-                width,
-                height,
-                0,
-                GL_RGBA,
-                GL_UNSIGNED_BYTE,
-                data
-            );
-        }
-        // glGenerateMipmap( GL_TEXTURE_2D );
-    } else {
-        ERROR_LOG( "failed to load texture" );
-        error = 1;
-    }
-    stbi_image_free( data );
 
     return texture;
 }
+
+void free_texture( int texture )
+{
+    unsigned int id = texture;
+    glDeleteTextures( 1, &id );
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "registry.hpp"
 #include "res.hpp"
 
 #include <cglm/types.h>
@@ -7,13 +8,26 @@
 struct vbuffer_t {
     int buffer;
     int element_count;
-    int element_size;
+    int element_size; // components per element
+    int type;         // component type, GL_FLOAT unless packed
+    int stride;       // in bytes
 
     void init( int new_element_size );
-    void set( const float * new_data, int new_element_count );
+    /// integer types are read as normalized
+    void set_format( int new_element_size, int new_type, int new_stride );
+    void set( const void * new_data, int new_element_count );
     void enable( int attrib_index );
 };
 
+struct ibuffer_t {
+    int buffer;
+    int size; // in bytes
+
+    void init();
+    void set( const void * new_data, int new_size );
+    void bind();
+};
+
 struct framebuffer_t {
     int id;
     int width;
@@ -25,14 +39,67 @@ struct framebuffer_t {
     int init_depth_texture();
 };
 
-int load_texture( res_t res );
+/// texture from raw rgba pixels, 8 bits per channel
+int load_texture_pixels( const unsigned char * rgba, int width, int height );
 
+void free_texture( int texture );
+
+/// source of a shaders.glsl section, "" if there is none. valid until the
+/// next reload_shader_strings.
 const char * find_shader_string( const char * name );
 
+/// whether shaders.glsl has the section, without logging
+bool has_shader_string( const char * name );
+
+/// the next find_shader_string reads shaders.glsl again. release builds
+/// have the sections compiled in and keep them.
+void reload_shader_strings();
+
+/// source of a section to compile, with the defines, "#define NAME\n"
+/// lines, put after its #version line and every #include "section" line
+/// replaced by that section. delete[] it once submitted.
+char * expand_shader( const char * name, const char * defines );
+
+/// a program handed to the driver, its compile and link not checked yet
+struct shader_job_t {
+    int program;
+    int shaders[ 2 ]; // vertex and fragment, 0 if cached or not created
+    hash_t key;       // in the program cache
+    bool cached;      // linked from the program cache, nothing to check
+};
+
+/// compiles and links without asking how it went, so the driver can work
+/// on many programs at once. attributes get locations in the order the
+/// vertex shader declares them. comes from the program cache when it has
+/// the program, see program_cache.hpp.
+void submit_shader(
+    shader_job_t * out,
+    const char * vertex_string,
+    const char * fragment_string
+);
+
+/// true once finish_shader would not wait for the driver. always true
+/// without KHR_parallel_shader_compile, the driver cannot tell then.
+bool shader_ready( shader_job_t * job );
+
+/// linked program of the job, -1 if a shader fails to compile or the
+/// program to link
+int finish_shader( shader_job_t * job );
+
+/// submit_shader and finish_shader in one go
 int build_shader( const char * vertex_string, const char * fragment_string );
 
+/// the context has the extension, "GL_..." as in glGetStringi
+bool has_gl_extension( const char * name );
+
 int find_uniform( int shader, const char * uniform_name );
 
+/// glUseProgram unless it is current already. every program switch has to
+/// go through here, set_uniform keeps the values per current program.
+void use_program( int program );
+
+/// sets a uniform of the current program, skipped when it holds the value
+/// already
 void set_uniform( int uniform, int v );
 void set_uniform( int uniform, float v );
 void set_uniform( int uniform, float ( &v )[ 2 ] );
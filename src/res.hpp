@@ -1,8 +1,44 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+#define RES_UNOWNED 0 // not ours to free, embedded or borrowed
+#define RES_HEAP    1
+#define RES_MAPPED  2
+
 struct res_t {
-    unsigned char * data;
-    int size;
+    unsigned char * data; // read only
+    size_t size;
+    int storage; // RES_*, how release_res frees data
 };
 
+/// serves the resource from the mounted archive if it has it, see
+/// archive.hpp. otherwise maps the file read only on desktop unix, with a
+/// sequential read ahead hint since every user parses front to back, or
+/// reads it into memory where mapping is not available. give it back with
+/// release_res.
 res_t find_res( const char * name );
+
+/// find_res for resources that may not exist, quiet when there is none
+res_t try_res( const char * name );
+
+/// maps or reads a file like find_res, by path and quietly
+res_t load_file( const char * path );
+
+/// unmaps or frees the data, the res is empty afterwards
+void release_res( res_t * res );
+
+/// on-disk path of a resource, only meaningful for file backed resources
+int res_path( char * out_path, int size, const char * name );
+
+/// size and modification time of a resource file, what caches built from it
+/// compare to tell whether it changed
+struct res_stamp_t {
+    int64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+};
+
+/// fails for resources without a file and where files can not be stamped
+int stamp_res( res_stamp_t * out_stamp, const char * name );
@@ -0,0 +1,46 @@
+#include "shader_sections.hpp"
+
+#include <string.h>
+
+#define SHADER_LINE "#shader "
+
+int split_shader_sections( char * text, shader_section_t * out_list, int cap )
+{
+    int count = 0;
+    shader_section_t * section = nullptr;
+
+    char * line = text;
+    while ( *line ) {
+        char * end = strchr( line, '\n' );
+        if ( !end ) end = line + strlen( line );
+        char * next = *end ? end + 1 : end;
+
+        if ( strncmp( line, SHADER_LINE, strlen( SHADER_LINE ) ) == 0 ) {
+            if ( count >= cap ) return -1;
+
+            // the name is the rest of the line, trailing space and \r cut
+            char * name = line + strlen( SHADER_LINE );
+            char * name_end = end;
+            while ( name_end > name && (unsigned char) name_end[ -1 ] <= ' ' ) {
+                name_end--;
+            }
+            *name_end = '\0';
+
+            // the previous section ends where this line starts
+            if ( section ) {
+                *line = '\0';
+                section->size = (int) ( line - section->source );
+            }
+
+            section = out_list + count++;
+            section->name = name;
+            section->source = next;
+        }
+
+        line = next;
+    }
+
+    if ( section ) section->size = (int) ( line - section->source );
+
+    return count;
+}
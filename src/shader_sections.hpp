@@ -0,0 +1,20 @@
+#pragma once
+
+/// res/shaders.glsl is a list of sections, each starting at a line
+///   #shader <name>
+/// and running up to the next one. release builds compile the sections in,
+/// see tools/shaderpack.cpp, the others read the file so it can be edited
+/// while running. both split it with split_shader_sections.
+
+#define MAX_SHADER_SECTION_COUNT 64
+
+struct shader_section_t {
+    const char * name;
+    const char * source; // null terminated
+    int size;            // of source, without the terminator
+};
+
+/// cuts null terminated text into its sections in place, the names and
+/// sources point into text. text before the first section is skipped.
+/// returns the section count, -1 if there are more than cap.
+int split_shader_sections( char * text, shader_section_t * out_list, int cap );
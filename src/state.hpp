@@ -1,5 +1,7 @@
 #pragma once
 
+#include "registry.hpp"
+
 #include <cglm/types.h>
 #include <string.h> // memcpy
 
@@ -8,6 +10,15 @@ template < typename T > void array_swap_last( T * arr, int count, int index )
     memcpy( arr + index, arr + count - 1, sizeof( T ) );
 }
 
+/// reallocates arr to new_cap elements, keeping the first count
+template < typename T > void array_resize( T *& arr, int count, int new_cap )
+{
+    T * out = new T[ new_cap ];
+    memcpy( out, arr, sizeof( T ) * count );
+    delete[] arr;
+    arr = out;
+}
+
 struct state_t {
     float tick_time;
     float render_time;
@@ -17,9 +28,37 @@ struct state_t {
 
     char ** avail_model_file_list;
     int avail_model_file_count;
+    int avail_model_file_cap;
+
+    // same ids as the model table
+    char ** model_file_list;         // nullptr = free slot
+    char ** model_texture_file_list; // for the whole model, nullptr = none
+    int * model_ref_count_list;      // entities and other holders
+    hash_t * model_hash_list;        // content, 0 = not resident
+    int * model_free_list;           // slots to reuse
+    int model_free_count;
+
+    hash_map_t model_name_map;    // file name hash -> model
+    hash_map_t model_content_map; // content hash -> resident model
 
-    char ** model_file_list;
-    int model_file_count;
+    // same ids as the material table
+    char ** material_name_list;    // nullptr = free slot
+    int * material_ref_count_list; // submeshes
+    int * material_free_list;
+    int material_free_count;
+
+    hash_map_t material_name_map; // name hash -> material
+
+    // textures loaded from resource files, to reload them when they change
+    char ** texture_file_list;
+    int * texture_file_texture_list;
+    int texture_file_count;
+    int texture_file_cap;
+
+    range_list_t vertex_range_list;  // free vertices of unloaded models
+    range_list_t index_range_list;   // in bytes
+    range_list_t submesh_range_list; //
+    range_list_t cluster_range_list; //
 
     bool enable_pos_snapping;
     float pos_snapping_delta;
@@ -27,6 +66,12 @@ struct state_t {
     bool enable_rot_snapping;
     float rot_snapping_delta;
 
+    bool enable_mesh_optimization;
+    bool enable_palette_baking; // see load_model_data
+
+    int upload_budget; // bytes of loaded models added per frame
+    int texture_upload_budget; // bytes of texture levels uploaded per frame
+
     bool enable_pos_lock_x;
     bool enable_pos_lock_y;
     bool enable_pos_lock_z;
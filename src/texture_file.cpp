@@ -0,0 +1,76 @@
+#include "texture_file.hpp"
+
+const char texture_file_magic[ 4 ] = { 'M', 'W', 'T', 'X' };
+
+size_t texture_level_size( int format, int width, int height )
+{
+    size_t block_size = 16;
+    if ( format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_ETC2_RGB ) {
+        block_size = 8;
+    }
+
+    size_t blocks_x = ( width + 3 ) / 4;
+    size_t blocks_y = ( height + 3 ) / 4;
+
+    return blocks_x * blocks_y * block_size;
+}
+
+int texture_level_side( int size, int level )
+{
+    size >>= level;
+    return size > 0 ? size : 1;
+}
+
+int texture_level_count( int width, int height )
+{
+    if ( width < TEXTURE_MIN_MIPMAP_SIZE ) return 1;
+    if ( height < TEXTURE_MIN_MIPMAP_SIZE ) return 1;
+
+    int count = 1;
+    int size = width > height ? width : height;
+    while ( size > 1 ) {
+        size >>= 1;
+        count++;
+    }
+
+    return count;
+}
+
+/// that is 2x2 for even sides, odd sides give the last texel a third row or
+/// column instead of dropping it, and a side of 1 is kept
+void downsample_image(
+    const unsigned char * in,
+    int in_width,
+    int in_height,
+    unsigned char * out,
+    int out_width,
+    int out_height,
+    int channels
+)
+{
+    for ( int y = 0; y < out_height; y++ ) {
+        int y0 = y * in_height / out_height;
+        int y1 = ( y + 1 ) * in_height / out_height;
+
+        for ( int x = 0; x < out_width; x++ ) {
+            int x0 = x * in_width / out_width;
+            int x1 = ( x + 1 ) * in_width / out_width;
+            int count = ( x1 - x0 ) * ( y1 - y0 );
+
+            int sum[ 4 ] = {};
+            for ( int sy = y0; sy < y1; sy++ ) {
+                const unsigned char * row = in + sy * in_width * channels;
+                for ( int sx = x0; sx < x1; sx++ ) {
+                    for ( int c = 0; c < channels; c++ ) {
+                        sum[ c ] += row[ sx * channels + c ];
+                    }
+                }
+            }
+
+            unsigned char * q = out + ( y * out_width + x ) * channels;
+            for ( int c = 0; c < channels; c++ ) {
+                q[ c ] = (unsigned char) ( ( sum[ c ] + count / 2 ) / count );
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// gpu compressed texture, the whole mip chain ready to upload. layout:
+///   header
+///   levels [ level_count ] level 0 first
+///   data   every level, starting on a TEXTURE_FILE_ALIGN boundary
+/// integers are little endian. written by tools/texpack.cpp next to the
+/// image it was encoded from, with the name of the image and a suffix for
+/// the block format family, "wall.png" -> "wall.png.bc.tex".
+
+#define TEXTURE_FILE_VERSION 1
+#define TEXTURE_FILE_ALIGN   16
+
+#define TEXTURE_FILE_BC_SUFFIX  ".bc.tex"  // desktop, s3tc
+#define TEXTURE_FILE_ETC_SUFFIX ".etc.tex" // gles and webgl on mobile
+
+#define TEXTURE_FORMAT_BC1       1 // rgb, 8 bytes per 4x4 block
+#define TEXTURE_FORMAT_BC3       2 // rgba, 16 bytes per block
+#define TEXTURE_FORMAT_ETC2_RGB  3 // 8 bytes per block
+#define TEXTURE_FORMAT_ETC2_RGBA 4 // eac alpha, 16 bytes per block
+
+// images with a side below this are palettes and pixel art in this tree,
+// averaging their texels would bleed neighbouring swatches into each other
+// and block compression would shift their colors. they keep one level and
+// are not encoded.
+#define TEXTURE_MIN_MIPMAP_SIZE 64
+
+struct texture_file_header_t {
+    char magic[ 4 ];
+    uint32_t version;
+    uint32_t format; // TEXTURE_FORMAT_*
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+};
+
+struct texture_file_level_t {
+    uint64_t offset; // from the start of the file
+    uint64_t size;
+};
+
+extern const char texture_file_magic[ 4 ];
+
+/// bytes of one level, blocks cover partial edges
+size_t texture_level_size( int format, int width, int height );
+
+/// side of a level, never below 1
+int texture_level_side( int size, int level );
+
+/// levels of a full mip chain down to 1x1, 1 for palettes
+int texture_level_count( int width, int height );
+
+/// box filter into the next level, each texel averages the texels it
+/// covers
+void downsample_image(
+    const unsigned char * in,
+    int in_width,
+    int in_height,
+    unsigned char * out,
+    int out_width,
+    int out_height,
+    int channels
+);
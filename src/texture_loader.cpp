@@ -0,0 +1,637 @@
+#include "texture_loader.hpp"
+#include "logging.hpp"
+#include "texture_file.hpp"
+
+#ifdef __EMSCRIPTEN__
+#include <GLES3/gl3.h>
+#else
+#include <glad/glad.h>
+#endif
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef __EMSCRIPTEN__
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#define MAX_TEXTURE_THREAD_COUNT 4
+#define MAX_LEVEL_COUNT          16
+
+// extensions, not in every header
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
+struct job_t {
+    int texture; // -1 once cancelled. gl thread only
+    res_t res;   // until decoded, kept for texture files
+
+    // the levels, level 0 is the image. decoded images have tightly packed
+    // rows, texture files point into the resource.
+    unsigned char * image;
+    unsigned char * mip_pixels; // the other levels in one block
+    unsigned char * level_list[ MAX_LEVEL_COUNT ];
+    int level_count; // 0 = did not decode
+    int width;
+    int height;
+    int channels; // 3 or 4
+    int format;   // TEXTURE_FORMAT_*, 0 = decoded pixels
+
+    int next_level; // next to upload, counting down. gl thread only
+
+    job_t * next;
+    job_t * live_next; // every job not freed yet. gl thread only
+};
+
+static struct {
+    // requests, oldest first
+    job_t * pending_first;
+    job_t * pending_last;
+
+    // finished decodes taken off done, oldest first. gl thread only
+    job_t * ready;
+
+    job_t * live;
+    int live_count;
+
+    bool bc_supported;
+    bool etc_supported;
+
+#ifndef __EMSCRIPTEN__
+    unsigned int pixel_buffer;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool quit;
+
+    // finished decodes, newest first. workers push, the gl thread takes all
+    std::atomic< job_t * > done;
+
+    std::thread thread_list[ MAX_TEXTURE_THREAD_COUNT ];
+    int thread_count;
+#endif
+} intern;
+
+// levels [begin] //////////////////////////////////////////////////////////////
+
+static void build_mips( job_t * job )
+{
+    int width = job->width;
+    int height = job->height;
+    int channels = job->channels;
+
+    job->level_count = texture_level_count( width, height );
+    if ( job->level_count > MAX_LEVEL_COUNT ) {
+        job->level_count = MAX_LEVEL_COUNT;
+    }
+
+    size_t mip_size = 0;
+    for ( int level = 1; level < job->level_count; level++ ) {
+        mip_size += (size_t) texture_level_side( width, level ) *
+                    texture_level_side( height, level ) * channels;
+    }
+
+    job->level_list[ 0 ] = job->image;
+    job->mip_pixels = mip_size > 0 ? new unsigned char[ mip_size ] : nullptr;
+
+    unsigned char * out = job->mip_pixels;
+    for ( int level = 1; level < job->level_count; level++ ) {
+        int out_width = texture_level_side( width, level );
+        int out_height = texture_level_side( height, level );
+
+        downsample_image(
+            job->level_list[ level - 1 ],
+            texture_level_side( width, level - 1 ),
+            texture_level_side( height, level - 1 ),
+            out,
+            out_width,
+            out_height,
+            channels
+        );
+
+        job->level_list[ level ] = out;
+        out += (size_t) out_width * out_height * channels;
+    }
+}
+
+/// points the levels into a texture file, there is nothing to decode
+static int read_texture_file( job_t * job )
+{
+    const unsigned char * data = job->res.data;
+    size_t size = job->res.size;
+
+    if ( size < sizeof( texture_file_header_t ) ) return 1;
+
+    texture_file_header_t * header = (texture_file_header_t *) data;
+    if ( header->version != TEXTURE_FILE_VERSION ) return 1;
+    if ( header->format < TEXTURE_FORMAT_BC1 ) return 1;
+    if ( header->format > TEXTURE_FORMAT_ETC2_RGBA ) return 1;
+    if ( header->level_count < 1 ) return 1;
+    if ( header->level_count > MAX_LEVEL_COUNT ) return 1;
+
+    int level_count = header->level_count;
+    if ( size < sizeof( texture_file_header_t ) +
+                    sizeof( texture_file_level_t ) * level_count ) {
+        return 1;
+    }
+
+    texture_file_level_t * level_list = (texture_file_level_t *) ( header + 1 );
+    for ( int level = 0; level < level_count; level++ ) {
+        texture_file_level_t * l = &level_list[ level ];
+        size_t expected = texture_level_size(
+            header->format,
+            texture_level_side( header->width, level ),
+            texture_level_side( header->height, level )
+        );
+        if ( l->size != expected ) return 1;
+        if ( l->offset > size || l->size > size - l->offset ) return 1;
+
+        job->level_list[ level ] = job->res.data + l->offset;
+    }
+
+    job->format = header->format;
+    job->width = header->width;
+    job->height = header->height;
+    job->level_count = level_count;
+
+    return 0;
+}
+
+static size_t job_level_size( job_t * job, int level )
+{
+    int width = texture_level_side( job->width, level );
+    int height = texture_level_side( job->height, level );
+
+    if ( job->format ) return texture_level_size( job->format, width, height );
+    return (size_t) width * height * job->channels;
+}
+
+// levels [end] ////////////////////////////////////////////////////////////////
+
+// loader [begin] //////////////////////////////////////////////////////////////
+
+static void run_job( job_t * job )
+{
+    if ( job->res.size >= 4 &&
+         memcmp( job->res.data, texture_file_magic, 4 ) == 0 ) {
+        if ( read_texture_file( job ) ) {
+            job->level_count = 0;
+            release_res( &job->res );
+        }
+        return;
+    }
+
+    int width, height, channels;
+    int ok = stbi_info_from_memory(
+        job->res.data,
+        (int) job->res.size,
+        &width,
+        &height,
+        &channels
+    );
+
+    // grey images are expanded so every level is rgb or rgba
+    job->channels = ok && channels == 3 ? 3 : 4;
+    job->image = ok ? stbi_load_from_memory(
+                          job->res.data,
+                          (int) job->res.size,
+                          &job->width,
+                          &job->height,
+                          &channels,
+                          job->channels
+                      )
+                    : nullptr;
+
+    release_res( &job->res );
+
+    if ( !job->image ) return;
+
+    build_mips( job );
+}
+
+static void free_job( job_t * job )
+{
+    release_res( &job->res );
+    if ( job->image ) stbi_image_free( job->image );
+    delete[] job->mip_pixels;
+    delete job;
+}
+
+/// unlinks a job the gl thread is done with and frees it
+static void retire_job( job_t * job )
+{
+    job_t ** p = &intern.live;
+    while ( *p != job ) p = &( *p )->live_next;
+    *p = job->live_next;
+
+    intern.live_count--;
+    free_job( job );
+}
+
+#ifndef __EMSCRIPTEN__
+
+static void worker()
+{
+    for ( ;; ) {
+        job_t * job;
+
+        {
+            std::unique_lock< std::mutex > lock( intern.mutex );
+            intern.wake.wait( lock, [] {
+                return intern.quit || intern.pending_first;
+            } );
+
+            if ( intern.quit ) return;
+
+            job = intern.pending_first;
+            intern.pending_first = job->next;
+            if ( !intern.pending_first ) intern.pending_last = nullptr;
+        }
+
+        run_job( job );
+
+        job->next = intern.done.load( std::memory_order_relaxed );
+        while ( !intern.done.compare_exchange_weak(
+            job->next,
+            job,
+            std::memory_order_release,
+            std::memory_order_relaxed
+        ) ) {
+        }
+    }
+}
+
+#endif
+
+/// desktop drivers name s3tc EXT_texture_compression_s3tc, browsers
+/// WEBGL_compressed_texture_s3tc. etc2 is core in gles 3 but not in webgl 2
+/// or desktop gl before ES3_compatibility.
+static void find_compressed_formats()
+{
+    intern.bc_supported = false;
+    intern.etc_supported = false;
+
+    int count = 0;
+    glGetIntegerv( GL_NUM_EXTENSIONS, &count );
+    for ( int i = 0; i < count; i++ ) {
+        const char * name = (const char *) glGetStringi( GL_EXTENSIONS, i );
+        if ( !name ) continue;
+
+        if ( strstr( name, "texture_compression_s3tc" ) ||
+             strstr( name, "compressed_texture_s3tc" ) ) {
+            intern.bc_supported = true;
+        }
+        if ( strstr( name, "compressed_texture_etc" ) ||
+             strstr( name, "ES3_compatibility" ) ) {
+            intern.etc_supported = true;
+        }
+    }
+}
+
+void texture_loader_init( int thread_count )
+{
+    intern.pending_first = nullptr;
+    intern.pending_last = nullptr;
+    intern.ready = nullptr;
+    intern.live = nullptr;
+    intern.live_count = 0;
+
+    find_compressed_formats();
+
+#ifndef __EMSCRIPTEN__
+    glGenBuffers( 1, &intern.pixel_buffer );
+
+    if ( thread_count <= 0 ) {
+        thread_count = (int) std::thread::hardware_concurrency() / 2;
+    }
+    if ( thread_count < 1 ) thread_count = 1;
+    if ( thread_count > MAX_TEXTURE_THREAD_COUNT ) {
+        thread_count = MAX_TEXTURE_THREAD_COUNT;
+    }
+
+    intern.quit = false;
+    intern.done = nullptr;
+    intern.thread_count = thread_count;
+
+    for ( int i = 0; i < thread_count; i++ ) {
+        intern.thread_list[ i ] = std::thread( worker );
+    }
+#endif
+}
+
+void texture_loader_shutdown()
+{
+#ifndef __EMSCRIPTEN__
+    {
+        std::lock_guard< std::mutex > lock( intern.mutex );
+        intern.quit = true;
+    }
+    intern.wake.notify_all();
+
+    for ( int i = 0; i < intern.thread_count; i++ ) {
+        intern.thread_list[ i ].join();
+    }
+    intern.thread_count = 0;
+
+    glDeleteBuffers( 1, &intern.pixel_buffer );
+    intern.done = nullptr;
+#endif
+
+    // every job is on the live list wherever it stopped
+    while ( job_t * job = intern.live ) {
+        intern.live = job->live_next;
+        free_job( job );
+    }
+
+    intern.pending_first = nullptr;
+    intern.pending_last = nullptr;
+    intern.ready = nullptr;
+    intern.live_count = 0;
+}
+
+static void queue_job( int texture, res_t res )
+{
+    job_t * job = new job_t;
+    memset( job, 0, sizeof( job_t ) );
+    job->texture = texture;
+    job->res = res;
+
+    // the caller's memory may be gone before a worker gets to it
+    if ( res.storage == RES_UNOWNED ) {
+        unsigned char * data = new unsigned char[ res.size ];
+        memcpy( data, res.data, res.size );
+        job->res.data = data;
+        job->res.storage = RES_HEAP;
+    }
+
+    job->live_next = intern.live;
+    intern.live = job;
+    intern.live_count++;
+
+#ifndef __EMSCRIPTEN__
+    std::lock_guard< std::mutex > lock( intern.mutex );
+#endif
+
+    if ( intern.pending_last ) {
+        intern.pending_last->next = job;
+    } else {
+        intern.pending_first = job;
+    }
+    intern.pending_last = job;
+
+#ifndef __EMSCRIPTEN__
+    intern.wake.notify_one();
+#endif
+}
+
+int texture_loader_request( res_t res )
+{
+    static const unsigned char white[ 4 ] = { 255, 255, 255, 255 };
+
+    unsigned int texture;
+    glGenTextures( 1, &texture );
+
+    glBindTexture( GL_TEXTURE_2D, texture );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        GL_RGBA,
+        1,
+        1,
+        0,
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        white
+    );
+
+    queue_job( texture, res );
+
+    return texture;
+}
+
+void texture_loader_cancel( int texture )
+{
+    for ( job_t * job = intern.live; job; job = job->live_next ) {
+        if ( job->texture == texture ) job->texture = -1;
+    }
+}
+
+void texture_loader_reload( int texture, res_t res )
+{
+    // an older load finishing later would bring the old image back
+    texture_loader_cancel( texture );
+    queue_job( texture, res );
+}
+
+/// moves finished decodes onto the ready list
+static void collect_done()
+{
+#ifdef __EMSCRIPTEN__
+    // no workers, one decode per poll on the calling thread
+    if ( !intern.ready && intern.pending_first ) {
+        job_t * job = intern.pending_first;
+        intern.pending_first = job->next;
+        if ( !intern.pending_first ) intern.pending_last = nullptr;
+
+        run_job( job );
+        job->next = nullptr;
+        intern.ready = job;
+    }
+#else
+    job_t * list = intern.done.exchange( nullptr, std::memory_order_acquire );
+
+    // newest first, reverse into completion order behind what is ready
+    job_t * ordered = nullptr;
+    while ( list ) {
+        job_t * next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+    }
+
+    job_t ** tail = &intern.ready;
+    while ( *tail ) tail = &( *tail )->next;
+    *tail = ordered;
+#endif
+}
+
+static int gl_format( int format )
+{
+    switch ( format ) {
+    case TEXTURE_FORMAT_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TEXTURE_FORMAT_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TEXTURE_FORMAT_ETC2_RGB: return GL_COMPRESSED_RGB8_ETC2;
+    case TEXTURE_FORMAT_ETC2_RGBA: return GL_COMPRESSED_RGBA8_ETC2_EAC;
+    }
+    return 0;
+}
+
+static bool is_supported( int format )
+{
+    switch ( format ) {
+    case TEXTURE_FORMAT_BC1:
+    case TEXTURE_FORMAT_BC3: return intern.bc_supported;
+    case TEXTURE_FORMAT_ETC2_RGB:
+    case TEXTURE_FORMAT_ETC2_RGBA: return intern.etc_supported;
+    }
+    return true;
+}
+
+/// a texture without a complete range of levels samples black, so the
+/// range is moved down to each level as it arrives
+static void upload_level( job_t * job, int level )
+{
+    int width = texture_level_side( job->width, level );
+    int height = texture_level_side( job->height, level );
+    int size = (int) job_level_size( job, level );
+
+    const void * pixels = job->level_list[ level ];
+
+#ifndef __EMSCRIPTEN__
+    // webgl can not map buffers, there a pixel unpack buffer would only add
+    // a copy. elsewhere the driver copies out of the buffer when it gets to
+    // it instead of before glTexImage2D returns.
+    glBindBuffer( GL_PIXEL_UNPACK_BUFFER, intern.pixel_buffer );
+
+    // orphans the storage of the last upload so mapping does not wait on it
+    glBufferData( GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW );
+    void * out = glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER,
+        0,
+        size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+    );
+    if ( out ) {
+        memcpy( out, pixels, size );
+        glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+        pixels = nullptr; // offset into the buffer
+    } else {
+        glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+    }
+#endif
+
+    glBindTexture( GL_TEXTURE_2D, job->texture );
+
+    if ( level == job->level_count - 1 ) {
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level );
+        glTexParameteri(
+            GL_TEXTURE_2D,
+            GL_TEXTURE_MIN_FILTER,
+            job->level_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST
+        );
+    }
+
+    if ( job->format ) {
+        glCompressedTexImage2D(
+            GL_TEXTURE_2D,
+            level,
+            gl_format( job->format ),
+            width,
+            height,
+            0,
+            size,
+            pixels
+        );
+    } else {
+        int format = job->channels == 3 ? GL_RGB : GL_RGBA;
+
+        glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+        glTexImage2D(
+            GL_TEXTURE_2D,
+            level,
+            format,
+            width,
+            height,
+            0,
+            format,
+            GL_UNSIGNED_BYTE,
+            pixels
+        );
+    }
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level );
+
+#ifndef __EMSCRIPTEN__
+    glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+#endif
+}
+
+void texture_loader_poll( int budget )
+{
+    collect_done();
+
+    int size = 0;
+
+    while ( job_t * job = intern.ready ) {
+        if ( job->texture == -1 || job->level_count == 0 ||
+             !is_supported( job->format ) ) {
+            if ( job->texture != -1 ) ERROR_LOG( "failed to load texture" );
+
+            intern.ready = job->next;
+            retire_job( job );
+            continue;
+        }
+
+        if ( size >= budget ) break;
+
+        if ( !job->next_level ) job->next_level = job->level_count;
+        int level = --job->next_level;
+
+        upload_level( job, level );
+        size += (int) job_level_size( job, level );
+
+        if ( level == 0 ) {
+            intern.ready = job->next;
+            retire_job( job );
+        }
+    }
+}
+
+int texture_loader_variant_name(
+    char * out_name,
+    int size,
+    const char * name
+)
+{
+    const char * suffix = nullptr;
+
+#ifdef __EMSCRIPTEN__
+    // a browser offers either, etc on mobile gpus and s3tc on desktop ones
+    if ( intern.etc_supported ) suffix = TEXTURE_FILE_ETC_SUFFIX;
+    if ( intern.bc_supported ) suffix = TEXTURE_FILE_BC_SUFFIX;
+#else
+    // desktop drivers that take etc mostly decode it on upload
+    if ( intern.bc_supported ) suffix = TEXTURE_FILE_BC_SUFFIX;
+#endif
+
+    if ( !suffix ) return 1;
+
+    snprintf( out_name, size, "%s%s", name, suffix );
+    return 0;
+}
+
+int texture_loader_pending()
+{
+    return intern.live_count;
+}
+
+// loader [end] ////////////////////////////////////////////////////////////////
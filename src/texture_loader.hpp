@@ -0,0 +1,42 @@
+#pragma once
+
+#include "res.hpp"
+
+/// decodes images and builds their mip chains on worker threads. the gl
+/// thread streams the levels in over the following frames, smallest first,
+/// so a texture sharpens as it arrives instead of stalling the load.
+
+/// starts the workers, thread_count 0 uses half the cores
+void texture_loader_init( int thread_count );
+
+/// waits for the running decodes and drops the queued ones and everything
+/// not uploaded yet
+void texture_loader_shutdown();
+
+/// gl texture to use right away, white until the image is resident. the
+/// resource is an image stb_image decodes or a texture file. takes over the
+/// resource, unowned data is copied.
+int texture_loader_request( res_t res );
+
+/// decodes the image again into the same texture, which keeps its old image
+/// until the new one is resident or for good if it does not decode. takes
+/// over the resource like texture_loader_request.
+void texture_loader_reload( int texture, res_t res );
+
+/// drops the loads into a texture that is about to be freed
+void texture_loader_cancel( int texture );
+
+/// takes finished decodes and uploads their levels until budget bytes are
+/// spent, at least one level per call. once per frame on the gl thread.
+void texture_loader_poll( int budget );
+
+/// name of the texture file of an image in the compressed format the gpu
+/// takes, see texture_file.hpp. fails when it takes none of them.
+int texture_loader_variant_name(
+    char * out_name,
+    int size,
+    const char * name
+);
+
+/// textures queued, decoding or not fully uploaded yet
+int texture_loader_pending();
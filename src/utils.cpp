@@ -3,6 +3,8 @@
 #define CGLTF_IMPLEMENTATION
 #include <cgltf.h>
 
+#include <string.h>
+
 int tick_timer( float * timer, float step )
 {
     *timer -= step;
@@ -10,3 +12,11 @@ int tick_timer( float * timer, float step )
 
     return *timer > 0.0f;
 }
+
+bool has_suffix( const char * s, const char * suffix )
+{
+    int len = strlen( s );
+    int suffix_len = strlen( suffix );
+
+    return len >= suffix_len && strcmp( s + len - suffix_len, suffix ) == 0;
+}
@@ -2,6 +2,9 @@
 
 int tick_timer( float * timer, float step );
 
+/// case sensitive, "foo.glb" has the suffix ".glb"
+bool has_suffix( const char * s, const char * suffix );
+
 inline int grid( int w, int h, int x, int y )
 {
     if ( x < 0 ) return -1;
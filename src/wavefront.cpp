@@ -4,202 +4,512 @@
 
 #include <float.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// #define MAX_VERTEX_COUNT         4096
-// #define MAX_OBJ_COUNT            16
-#define MAX_VERTEX_COUNT         1000000
-#define MAX_OBJ_COUNT            1000
-#define MAX_NAME_LENGTH          64
-#define MAX_POLYGON_LENGTH       32
-#define MAX_LINE_LENGTH          256
-#define MAX_MATERIAL_GROUP_COUNT 64
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#endif
+
+#define MAX_NAME_LENGTH    64
+#define MAX_POLYGON_LENGTH 32
 
 #define MAX_MATERIAL_COUNT 32
 
+#define MIN_CHUNK_SIZE  ( 256 * 1024 )
+#define MAX_CHUNK_COUNT 64
+
 /// you might be asking why i would write the parser like this. tbh fuck u, idc
 /// how flexible or modern the parser is. it needs to be fast, and simple.
 /// theres a reasonable limit for everything. and if things go out of limits
 /// theres errors printed.
 
-static int starts_with( const char * line, const char * str )
-{
-    return strncmp( line, str, strlen( str ) ) == 0;
-}
+// tokenizer [start] ///////////////////////////////////////////////////////////
 
-// line parsers [start] ////////////////////////////////////////////////////////
+/// the tokenizer walks the resource buffer in place. every helper takes a
+/// cursor and the end of the buffer and never reads past a newline, so there
+/// is no line copy and no line length limit.
 
-static int parse_object_line( char * out_name, const char * line )
+static int is_digit( char c )
 {
-    snprintf( out_name, MAX_NAME_LENGTH, "%s", line + strlen( "o " ) );
-    return 0;
+    return (unsigned) ( c - '0' ) < 10;
 }
 
-static int parse_material_lib_line( char * out_name, const char * line )
+static const char * skip_blank( const char * p, const char * end )
 {
-    snprintf( out_name, MAX_NAME_LENGTH, "%s", line + strlen( "mtllib " ) );
-    return 0;
+    while ( p < end && ( *p == ' ' || *p == '\t' ) ) p++;
+    return p;
 }
 
-static int parse_usemtl_line( char * out_name, const char * line )
+static const char * next_line( const char * p, const char * end )
 {
-    snprintf( out_name, MAX_NAME_LENGTH, "%s", line + strlen( "usemtl " ) );
-    return 0;
+    const char * nl = (const char *) memchr( p, '\n', end - p );
+    return nl ? nl + 1 : end;
 }
 
-static int parse_position_line( float * out3, const char * line )
+/// returns the cursor after the keyword when the line starts with `keyword`
+/// followed by a blank, nullptr otherwise
+static const char *
+match_keyword( const char * p, const char * end, const char * keyword )
 {
-    int count = sscanf( line, "v %f %f %f", out3 + 0, out3 + 1, out3 + 2 );
-    return count != 3;
-}
+    for ( ; *keyword; keyword++, p++ ) {
+        if ( p >= end || *p != *keyword ) return nullptr;
+    }
 
-static int parse_normal_line( float * out3, const char * line )
-{
-    int count = sscanf( line, "vn %f %f %f", out3 + 0, out3 + 1, out3 + 2 );
-    return count != 3;
-}
+    if ( p >= end || ( *p != ' ' && *p != '\t' ) ) return nullptr;
 
-static int parse_uv_line( float * out2, const char * line )
-{
-    int count = sscanf( line, "vt %f %f", out2 + 0, out2 + 1 );
-    return count != 2;
+    return p;
 }
 
-static int
-parse_face_line( int * out_index_list, int * out_index_count, char * line )
+static const double pow10_table[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/// locale independent replacement for strtof.
+/// accepts [+-]digits[.digits][(e|E)[+-]digits]
+static int parse_float( float * out, const char ** cursor, const char * end )
 {
-    int len = strlen( line );
-    int count = 0;
+    const char * p = skip_blank( *cursor, end );
 
-    for ( int i = 0; i < len; i++ ) {
-        if ( line[ i ] == '/' ) line[ i ] = ' ';
+    int negative = 0;
+    if ( p < end && ( *p == '-' || *p == '+' ) ) {
+        negative = *p == '-';
+        p++;
     }
 
-    for ( int i = 0; i < len; i++ ) {
-        if ( line[ i ] != ' ' ) continue;
+    // up to 19 significant digits fit in the mantissa, the rest only moves
+    // the exponent
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digit_count = 0;
+    int has_digits = 0;
+
+    for ( ; p < end && is_digit( *p ); p++ ) {
+        has_digits = 1;
+        if ( digit_count < 19 ) {
+            mantissa = mantissa * 10 + ( *p - '0' );
+            if ( mantissa ) digit_count++;
+        } else {
+            exponent++;
+        }
+    }
 
-        if ( count >= MAX_POLYGON_LENGTH * 3 ) {
-            ERROR_LOG( "polygon limit exceeded" );
-            return 1;
+    if ( p < end && *p == '.' ) {
+        p++;
+        for ( ; p < end && is_digit( *p ); p++ ) {
+            has_digits = 1;
+            if ( digit_count < 19 ) {
+                mantissa = mantissa * 10 + ( *p - '0' );
+                if ( mantissa ) digit_count++;
+                exponent--;
+            }
         }
+    }
 
-        out_index_list[ count ] = atoi( line + i ) - 1;
-        count++;
+    if ( !has_digits ) return 1;
+
+    if ( p < end && ( *p == 'e' || *p == 'E' ) ) {
+        const char * q = p + 1;
+
+        int exponent_negative = 0;
+        if ( q < end && ( *q == '-' || *q == '+' ) ) {
+            exponent_negative = *q == '-';
+            q++;
+        }
+
+        if ( q < end && is_digit( *q ) ) {
+            int e = 0;
+            for ( ; q < end && is_digit( *q ); q++ ) {
+                if ( e < 10000 ) e = e * 10 + ( *q - '0' );
+            }
+            exponent += exponent_negative ? -e : e;
+            p = q;
+        }
     }
 
-    *out_index_count = count;
+    double value = (double) mantissa;
+
+    if ( exponent < -22 || exponent > 22 ) {
+        value *= pow( 10.0, exponent );
+    } else if ( exponent < 0 ) {
+        value /= pow10_table[ -exponent ];
+    } else {
+        value *= pow10_table[ exponent ];
+    }
+
+    *out = (float) ( negative ? -value : value );
+    *cursor = p;
 
-    return count % 3 != 0;
+    return 0;
 }
 
-static int parse_newmtl_line( char * out_name, const char * line )
+/// parses an unsigned or negative integer, does not skip leading blanks
+static int parse_int( int * out, const char ** cursor, const char * end )
 {
-    snprintf( out_name, MAX_NAME_LENGTH, "%s", line + strlen( "newmtl " ) );
+    const char * p = *cursor;
+
+    int negative = 0;
+    if ( p < end && ( *p == '-' || *p == '+' ) ) {
+        negative = *p == '-';
+        p++;
+    }
+
+    if ( p >= end || !is_digit( *p ) ) return 1;
+
+    int value = 0;
+    for ( ; p < end && is_digit( *p ); p++ ) {
+        value = value * 10 + ( *p - '0' );
+    }
+
+    *out = negative ? -value : value;
+    *cursor = p;
+
     return 0;
 }
 
-static int parse_ns_line( float * out, const char * line )
+static int parse_floats(
+    float * out_list,
+    int count,
+    const char ** cursor,
+    const char * end
+)
 {
-    int count = sscanf( line, "Ns %f", out );
-    return count != 1;
+    for ( int i = 0; i < count; i++ ) {
+        if ( parse_float( out_list + i, cursor, end ) ) return 1;
+    }
+
+    return 0;
 }
 
-static int parse_ka_line( float * out3, const char * line )
+/// copies the rest of the line, trailing blanks and '\r' are trimmed. names
+/// longer than MAX_NAME_LENGTH are truncated.
+static int parse_name( char * out_name, const char * p, const char * end )
 {
-    int count = sscanf( line, "Ka %f %f %f", out3 + 0, out3 + 1, out3 + 2 );
-    return count != 3;
+    p = skip_blank( p, end );
+
+    const char * line_end = (const char *) memchr( p, '\n', end - p );
+    if ( !line_end ) line_end = end;
+
+    while ( line_end > p &&
+            ( line_end[ -1 ] == ' ' || line_end[ -1 ] == '\t' ||
+              line_end[ -1 ] == '\r' ) ) {
+        line_end--;
+    }
+
+    int len = (int) ( line_end - p );
+    int error = 0;
+
+    if ( len >= MAX_NAME_LENGTH ) {
+        ERROR_LOG( "name length exceeded" );
+        len = MAX_NAME_LENGTH - 1;
+        error = 1;
+    }
+
+    memcpy( out_name, p, len );
+    out_name[ len ] = '\0';
+
+    return error;
 }
 
-static int parse_kd_line( float * out3, const char * line )
+// tokenizer [end] /////////////////////////////////////////////////////////////
+
+// line parsers [start] ////////////////////////////////////////////////////////
+
+static int is_face_end( const char * p, const char * end )
 {
-    int count = sscanf( line, "Kd %f %f %f", out3 + 0, out3 + 1, out3 + 2 );
-    return count != 3;
+    return p >= end || *p == '\n' || *p == '\r' || *p == '#';
 }
 
-static int parse_ks_line( float * out3, const char * line )
+static int is_corner_end( const char * p, const char * end )
 {
-    int count = sscanf( line, "Ks %f %f %f", out3 + 0, out3 + 1, out3 + 2 );
-    return count != 3;
+    return is_face_end( p, end ) || *p == ' ' || *p == '\t';
 }
 
-static int parse_ke_line( float * out3, const char * line )
+/// number of blank separated corners on a face line. this has to agree with
+/// parse_face_line, the count pass uses it to place every face in the output.
+static int count_face_corners( const char ** cursor, const char * end )
 {
-    int count = sscanf( line, "Ke %f %f %f", out3 + 0, out3 + 1, out3 + 2 );
-    return count != 3;
+    const char * p = *cursor;
+    int count = 0;
+
+    for ( ;; ) {
+        p = skip_blank( p, end );
+        if ( is_face_end( p, end ) ) break;
+
+        while ( !is_corner_end( p, end ) ) p++;
+        count++;
+    }
+
+    *cursor = p;
+
+    return count;
 }
 
-static int parse_ni_line( float * out, const char * line )
+/// indices a polygon turns into after triangulation
+static int face_index_count( int corner_count )
 {
-    int count = sscanf( line, "Ni %f", out );
-    return count != 1;
+    if ( corner_count < 3 || corner_count > MAX_POLYGON_LENGTH ) return 0;
+    return ( corner_count - 2 ) * 3;
 }
 
-static int parse_d_line( float * out, const char * line )
+/// converts a 1-based (or negative, relative) obj index into a 0-based one.
+/// count is the number of records parsed so far.
+static int resolve_index( int * out, int index, int count )
 {
-    int count = sscanf( line, "d %f", out );
-    return count != 1;
+    index = index < 0 ? count + index : index - 1;
+
+    if ( index < 0 || index >= count ) return 1;
+
+    *out = index;
+    return 0;
 }
 
-static int parse_illum_line( int * out, const char * line )
+static int parse_face_corner(
+    int * out3,
+    const char ** cursor,
+    const char * end,
+    int pos_count,
+    int uv_count,
+    int normal_count
+)
 {
-    int count = sscanf( line, "illum %d", out );
-    return count != 1;
+    int index;
+    int errors = 0;
+
+    out3[ 0 ] = -1;
+    out3[ 1 ] = -1;
+    out3[ 2 ] = -1;
+
+    if ( parse_int( &index, cursor, end ) ) return 1;
+    errors += resolve_index( out3 + 0, index, pos_count );
+
+    if ( *cursor < end && **cursor == '/' ) {
+        ( *cursor )++;
+        if ( *cursor < end && **cursor != '/' ) {
+            if ( parse_int( &index, cursor, end ) ) return 1;
+            errors += resolve_index( out3 + 1, index, uv_count );
+        }
+        if ( *cursor < end && **cursor == '/' ) {
+            ( *cursor )++;
+            if ( parse_int( &index, cursor, end ) ) return 1;
+            errors += resolve_index( out3 + 2, index, normal_count );
+        }
+    }
+
+    if ( !is_corner_end( *cursor, end ) ) return 1;
+
+    return errors;
 }
 
-static int parse_map_kd_line( char * out_name, const char * line )
+/// out_index_list gets a (pos, uv, normal) triple per polygon corner. missing
+/// uv or normal references are set to -1. a corner that fails to parse is
+/// still counted so the face keeps the size count_face_corners gave it.
+static int parse_face_line(
+    int * out_index_list,
+    int * out_index_count,
+    const char ** cursor,
+    const char * end,
+    int pos_count,
+    int uv_count,
+    int normal_count
+)
 {
-    snprintf( out_name, MAX_NAME_LENGTH, "%s", line + strlen( "map_Kd " ) );
+    const char * p = *cursor;
+    int count = 0;
+    int errors = 0;
+
+    for ( ;; ) {
+        p = skip_blank( p, end );
+        if ( is_face_end( p, end ) ) break;
+
+        if ( count < MAX_POLYGON_LENGTH * 3 ) {
+            errors += parse_face_corner(
+                out_index_list + count,
+                &p,
+                end,
+                pos_count,
+                uv_count,
+                normal_count
+            );
+        }
+
+        // skip whatever is left of a malformed corner
+        while ( !is_corner_end( p, end ) ) p++;
+
+        count += 3;
+    }
+
+    *cursor = p;
+
+    if ( count > MAX_POLYGON_LENGTH * 3 ) {
+        ERROR_LOG( "polygon limit exceeded" );
+        *out_index_count = 0;
+        return 1;
+    }
+
+    *out_index_count = count;
+
+    if ( errors ) {
+        ERROR_LOG( "bad face index" );
+        return 1;
+    }
+
     return 0;
 }
 
 // line parsers [end] //////////////////////////////////////////////////////////
 
-static void append_vertex(
-    wavefront_t * out,
-    float * pos_list,
-    float * normal_list,
-    float * uv_list,
-    int * index_list,
-    int index
+// chunks [start] //////////////////////////////////////////////////////////////
+
+/// the loader runs three passes over newline aligned chunks of the file.
+/// the count pass counts the records of every chunk, and a prefix sum turns
+/// the counts into the index of each chunk's first record. the parse pass then
+/// writes every record straight to its final place, faces only as index
+/// triples since they can point at records of an earlier chunk. once every
+/// chunk is parsed the triples are welded into unique vertices (serially, so
+/// the vertex order never depends on the chunking) and the gather pass expands
+/// them. so chunks can run on any number of threads and still give the same
+/// output as a single chunk.
+
+struct record_counts_t {
+    int pos;            // v
+    int normal;         // vn
+    int uv;             // vt
+    int index;          // triangulated f corners
+    int obj;            // o
+    int material_group; // usemtl
+};
+
+struct chunk_t {
+    const char * begin;
+    const char * end;
+
+    record_counts_t count; // records in this chunk
+    record_counts_t base;  // records in all chunks before this one
+
+    const char * material_lib_filename;
+    int errors;
+};
+
+/// v, vn and vt records of the whole file, indexed like the obj indexes them,
+/// and the resolved (pos, uv, normal) triple of every triangulated vertex
+struct attrib_table_t {
+    float * pos_list;
+    float * normal_list;
+    float * uv_list;
+    int * corner_list;
+};
+
+static int split_chunks(
+    chunk_t * out_list,
+    int max_count,
+    const char * begin,
+    const char * end
 )
 {
-    if ( out->vertex_count >= MAX_VERTEX_COUNT ) {
-        ERROR_LOG( "vertex limit exceeded" );
-        return;
+    long long size = end - begin;
+
+    int count = (int) ( size / MIN_CHUNK_SIZE );
+    if ( count > max_count ) count = max_count;
+    if ( count < 1 ) count = 1;
+
+    const char * p = begin;
+
+    for ( int i = 0; i < count; i++ ) {
+        const char * split = end;
+
+        if ( i < count - 1 ) {
+            split = begin + size * ( i + 1 ) / count;
+            if ( split < p ) split = p;
+            split = next_line( split, end );
+        }
+
+        out_list[ i ].begin = p;
+        out_list[ i ].end = split;
+        p = split;
     }
 
-    int i = out->vertex_count;
+    return count;
+}
 
-    int pos_index = index_list[ index * 3 + 0 ];
-    int uv_index = index_list[ index * 3 + 1 ];
-    int normal_index = index_list[ index * 3 + 2 ];
+template < typename F > static void parallel_for( int count, F f )
+{
+#ifdef __EMSCRIPTEN__
+    for ( int i = 0; i < count; i++ ) {
+        f( i );
+    }
+#else
+    std::thread thread_list[ MAX_CHUNK_COUNT ];
+
+    for ( int i = 1; i < count; i++ ) {
+        thread_list[ i ] = std::thread( f, i );
+    }
+
+    if ( count > 0 ) f( 0 );
+
+    for ( int i = 1; i < count; i++ ) {
+        thread_list[ i ].join();
+    }
+#endif
+}
 
-    out->pos_list[ i * 3 + 0 ] = pos_list[ pos_index * 3 + 0 ];
-    out->pos_list[ i * 3 + 1 ] = pos_list[ pos_index * 3 + 1 ];
-    out->pos_list[ i * 3 + 2 ] = pos_list[ pos_index * 3 + 2 ];
+static void count_chunk( chunk_t * chunk )
+{
+    const char * p = chunk->begin;
+    const char * end = chunk->end;
+
+    record_counts_t & n = chunk->count;
+    memset( &n, 0, sizeof( n ) );
+
+    while ( p < end ) {
+        p = skip_blank( p, end );
+        if ( p >= end ) break;
+
+        const char * args = p;
+
+        switch ( *p ) {
+        case 'v':
+            if ( match_keyword( p, end, "v" ) ) n.pos++;
+            if ( match_keyword( p, end, "vn" ) ) n.normal++;
+            if ( match_keyword( p, end, "vt" ) ) n.uv++;
+            break;
+
+        case 'f':
+            if ( ( args = match_keyword( p, end, "f" ) ) ) {
+                int corner_count = count_face_corners( &args, end );
+                n.index += face_index_count( corner_count );
+            } else {
+                args = p;
+            }
+            break;
 
-    out->normal_list[ i * 3 + 0 ] = normal_list[ normal_index * 3 + 0 ];
-    out->normal_list[ i * 3 + 1 ] = normal_list[ normal_index * 3 + 1 ];
-    out->normal_list[ i * 3 + 2 ] = normal_list[ normal_index * 3 + 2 ];
+        case 'o':
+            if ( match_keyword( p, end, "o" ) ) n.obj++;
+            break;
 
-    out->uv_list[ i * 2 + 0 ] = uv_list[ uv_index * 2 + 0 ];
-    out->uv_list[ i * 2 + 1 ] = uv_list[ uv_index * 2 + 1 ];
+        case 'u':
+            if ( match_keyword( p, end, "usemtl" ) ) n.material_group++;
+            break;
+        }
 
-    out->vertex_count++;
+        p = next_line( args, end );
+    }
 }
 
-static void append_face(
-    wavefront_t * out,
-    float * pos_list,
-    float * normal_list,
-    float * uv_list,
+/// writes the triangle fan of a polygon as (pos, uv, normal) triples,
+/// starting at index `first`
+static void write_face(
+    int * out_corner_list,
+    int first,
     int * index_list,
     int index_count
 )
 {
     int poly_size = index_count / 3;
+    int * out = out_corner_list + first * 3;
 
     // make triangle fan
     for ( int i = 0; i < poly_size - 2; i++ ) {
@@ -207,12 +517,230 @@ static void append_face(
         int v2 = i + 1;
         int v3 = i + 2;
 
-        append_vertex( out, pos_list, normal_list, uv_list, index_list, v1 );
-        append_vertex( out, pos_list, normal_list, uv_list, index_list, v2 );
-        append_vertex( out, pos_list, normal_list, uv_list, index_list, v3 );
+        memcpy( out + 0, index_list + v1 * 3, 3 * sizeof( int ) );
+        memcpy( out + 3, index_list + v2 * 3, 3 * sizeof( int ) );
+        memcpy( out + 6, index_list + v3 * 3, 3 * sizeof( int ) );
+        out += 9;
     }
 }
 
+static unsigned int hash_corner( int pos_index, int uv_index, int normal_index )
+{
+    unsigned int h = (unsigned int) pos_index * 0x9e3779b1u;
+    h ^= (unsigned int) uv_index * 0x85ebca77u;
+    h ^= (unsigned int) normal_index * 0xc2b2ae3du;
+    h ^= h >> 15;
+    return h;
+}
+
+/// merges corners with the same (pos, uv, normal) triple into one vertex.
+/// fills out_index_list and moves the unique triples to the front of
+/// corner_list in order of first use. returns the unique vertex count.
+static int
+weld_corners( unsigned int * out_index_list, int * corner_list, int count )
+{
+    int cap = 16;
+    while ( cap < count * 2 ) cap *= 2;
+
+    // open addressing, slots hold a vertex id or -1
+    int * slot_list = new int[ cap ];
+    memset( slot_list, 0xff, cap * sizeof( int ) );
+
+    int vertex_count = 0;
+
+    for ( int i = 0; i < count; i++ ) {
+        int pos_index = corner_list[ i * 3 + 0 ];
+        int uv_index = corner_list[ i * 3 + 1 ];
+        int normal_index = corner_list[ i * 3 + 2 ];
+
+        unsigned int slot = hash_corner( pos_index, uv_index, normal_index );
+
+        for ( ;; slot++ ) {
+            slot &= cap - 1;
+            int v = slot_list[ slot ];
+
+            if ( v == -1 ) {
+                // new vertex, v <= i so its triple was already read
+                v = vertex_count++;
+                corner_list[ v * 3 + 0 ] = pos_index;
+                corner_list[ v * 3 + 1 ] = uv_index;
+                corner_list[ v * 3 + 2 ] = normal_index;
+                slot_list[ slot ] = v;
+                out_index_list[ i ] = v;
+                break;
+            }
+
+            if ( corner_list[ v * 3 + 0 ] == pos_index &&
+                 corner_list[ v * 3 + 1 ] == uv_index &&
+                 corner_list[ v * 3 + 2 ] == normal_index ) {
+                out_index_list[ i ] = v;
+                break;
+            }
+        }
+    }
+
+    delete[] slot_list;
+
+    return vertex_count;
+}
+
+/// expands the unique triples of vertices [first, last) into the output
+static void gather_vertices(
+    wavefront_t * out,
+    attrib_table_t * table,
+    int first,
+    int last
+)
+{
+    float * pos_list = table->pos_list;
+    float * normal_list = table->normal_list;
+    float * uv_list = table->uv_list;
+
+    for ( int i = first; i < last; i++ ) {
+        int pos_index = table->corner_list[ i * 3 + 0 ];
+        int uv_index = table->corner_list[ i * 3 + 1 ];
+        int normal_index = table->corner_list[ i * 3 + 2 ];
+
+        if ( pos_index != -1 ) {
+            out->pos_list[ i * 3 + 0 ] = pos_list[ pos_index * 3 + 0 ];
+            out->pos_list[ i * 3 + 1 ] = pos_list[ pos_index * 3 + 1 ];
+            out->pos_list[ i * 3 + 2 ] = pos_list[ pos_index * 3 + 2 ];
+        } else {
+            memset( out->pos_list + i * 3, 0, 3 * sizeof( float ) );
+        }
+
+        if ( normal_index != -1 ) {
+            out->normal_list[ i * 3 + 0 ] = normal_list[ normal_index * 3 + 0 ];
+            out->normal_list[ i * 3 + 1 ] = normal_list[ normal_index * 3 + 1 ];
+            out->normal_list[ i * 3 + 2 ] = normal_list[ normal_index * 3 + 2 ];
+        } else {
+            memset( out->normal_list + i * 3, 0, 3 * sizeof( float ) );
+        }
+
+        if ( uv_index != -1 ) {
+            out->uv_list[ i * 2 + 0 ] = uv_list[ uv_index * 2 + 0 ];
+            out->uv_list[ i * 2 + 1 ] = uv_list[ uv_index * 2 + 1 ];
+        } else {
+            memset( out->uv_list + i * 2, 0, 2 * sizeof( float ) );
+        }
+    }
+}
+
+static void
+parse_chunk( chunk_t * chunk, wavefront_t * out, attrib_table_t * table )
+{
+    const char * p = chunk->begin;
+    const char * end = chunk->end;
+
+    // running global record indices
+    record_counts_t n = chunk->base;
+
+    int errors = 0;
+
+    chunk->material_lib_filename = nullptr;
+
+    while ( p < end ) {
+        p = skip_blank( p, end );
+        if ( p >= end ) break;
+
+        // args points past the keyword, parsers leave it at the last token
+        const char * args = p;
+
+        switch ( *p ) {
+        case 'v':
+            // parse v command
+            if ( ( args = match_keyword( p, end, "v" ) ) ) {
+                float * pos = table->pos_list + n.pos * 3;
+                errors += parse_floats( pos, 3, &args, end );
+                n.pos++;
+                break;
+            }
+
+            // parse vn command
+            if ( ( args = match_keyword( p, end, "vn" ) ) ) {
+                float * normal = table->normal_list + n.normal * 3;
+                errors += parse_floats( normal, 3, &args, end );
+                n.normal++;
+                break;
+            }
+
+            // parse vt command
+            if ( ( args = match_keyword( p, end, "vt" ) ) ) {
+                float * uv = table->uv_list + n.uv * 2;
+                errors += parse_floats( uv, 2, &args, end );
+                uv[ 1 ] = 1.0f - uv[ 1 ]; // idk why this is flipped but yk
+                n.uv++;
+                break;
+            }
+            break;
+
+        case 'f':
+            // parse f command
+            if ( ( args = match_keyword( p, end, "f" ) ) ) {
+                int index_list[ MAX_POLYGON_LENGTH * 3 ];
+                int index_count = 0;
+                errors += parse_face_line(
+                    index_list,
+                    &index_count,
+                    &args,
+                    end,
+                    n.pos,
+                    n.uv,
+                    n.normal
+                );
+                write_face(
+                    table->corner_list,
+                    n.index,
+                    index_list,
+                    index_count
+                );
+                n.index += face_index_count( index_count / 3 );
+            }
+            break;
+
+        case 'o':
+            // parse o command
+            if ( ( args = match_keyword( p, end, "o" ) ) ) {
+                char * name = new char[ MAX_NAME_LENGTH ];
+                errors += parse_name( name, args, end );
+                out->obj_name_list[ n.obj ] = name;
+                out->obj_offset_list[ n.obj ] = n.index;
+                n.obj++;
+            }
+            break;
+
+        case 'm':
+            if ( ( args = match_keyword( p, end, "mtllib" ) ) ) {
+                char * name = new char[ MAX_NAME_LENGTH ];
+                errors += parse_name( name, args, end );
+                delete[] chunk->material_lib_filename;
+                chunk->material_lib_filename = name;
+            }
+            break;
+
+        case 'u':
+            if ( ( args = match_keyword( p, end, "usemtl" ) ) ) {
+                char * name = new char[ MAX_NAME_LENGTH ];
+                errors += parse_name( name, args, end );
+                out->material_group_material_list[ n.material_group ] = name;
+                out->material_group_offset_list[ n.material_group ] = n.index;
+                n.material_group++;
+            }
+            break;
+
+        default:
+            // comments, s, g, l and anything we dont care about
+            break;
+        }
+
+        p = next_line( args ? args : p, end );
+    }
+
+    chunk->errors = errors;
+}
+
+// chunks [end] ////////////////////////////////////////////////////////////////
+
 void wavefront_t::compute_bounds( float * min_vec3, float * max_vec3 )
 {
     min_vec3[ 0 ] = FLT_MAX;
@@ -251,6 +779,7 @@ static void print_header( wavefront_t * out )
         INFO_LOG( "  name:         %s", out->obj_name_list[ 0 ] );
     }
     INFO_LOG( "  vertex count: %d", out->vertex_count );
+    INFO_LOG( "  index count:  %d", out->index_count );
     INFO_LOG( "  object count: %d", out->obj_count );
     INFO_LOG(
         "  bounds:       %.2f x %.2f x %.2f",
@@ -275,141 +804,86 @@ static void print_mtl_header( material_t * out, const char * name )
     INFO_LOG( "  map_Kd: %s", out->map_kd ? out->map_kd : "(null)" );
 }
 
-int load_wavefront( wavefront_t * out, res_t res )
+static int load_chunks( wavefront_t * out, res_t res, int max_chunk_count )
 {
-    char line[ MAX_LINE_LENGTH ];
-
-    int cursor = 0;
-
-    int errors = 0;
+    const char * begin = (const char *) res.data;
+    const char * end = begin + res.size;
+
+    chunk_t chunk_list[ MAX_CHUNK_COUNT ];
+    int chunk_count = split_chunks( chunk_list, max_chunk_count, begin, end );
+
+    // count pass
+    parallel_for( chunk_count, [ & ]( int i ) {
+        count_chunk( chunk_list + i );
+    } );
+
+    // prefix sum
+    record_counts_t total;
+    memset( &total, 0, sizeof( total ) );
+
+    for ( int i = 0; i < chunk_count; i++ ) {
+        record_counts_t & count = chunk_list[ i ].count;
+        chunk_list[ i ].base = total;
+        total.pos += count.pos;
+        total.normal += count.normal;
+        total.uv += count.uv;
+        total.index += count.index;
+        total.obj += count.obj;
+        total.material_group += count.material_group;
+    }
 
-    // intialize output
+    // intialize output, everything is sized by the count pass
     using c_string_t = const char *;
-    out->pos_list = new float[ MAX_VERTEX_COUNT * 3 ];
-    out->normal_list = new float[ MAX_VERTEX_COUNT * 3 ];
-    out->uv_list = new float[ MAX_VERTEX_COUNT * 2 ];
+    out->pos_list = nullptr;
+    out->normal_list = nullptr;
+    out->uv_list = nullptr;
     out->vertex_count = 0;
-    out->obj_offset_list = new int[ MAX_OBJ_COUNT ];
-    out->obj_name_list = new c_string_t[ MAX_OBJ_COUNT ];
-    out->obj_count = 0;
+    out->index_list = new unsigned int[ total.index ];
+    out->index_count = total.index;
+    out->obj_offset_list = new int[ total.obj ];
+    out->obj_name_list = new c_string_t[ total.obj ];
+    out->obj_count = total.obj;
     out->material_lib_filename = nullptr;
-    out->material_group_material_list =
-        new c_string_t[ MAX_MATERIAL_GROUP_COUNT ];
-    out->material_group_offset_list = new int[ MAX_MATERIAL_GROUP_COUNT ];
-    out->material_group_count = 0;
+    out->material_group_material_list = new c_string_t[ total.material_group ];
+    out->material_group_offset_list = new int[ total.material_group ];
+    out->material_group_count = total.material_group;
 
     // local storage
-    float * pos_list = new float[ MAX_VERTEX_COUNT * 3 ];
-    float * normal_list = new float[ MAX_VERTEX_COUNT * 3 ];
-    float * uv_list = new float[ MAX_VERTEX_COUNT * 2 ];
-    int pos_count = 0;
-    int normal_count = 0;
-    int uv_count = 0;
-
-    while ( cursor < res.size ) {
-        // load next line
-        int i;
-        for ( i = 0; i + cursor < res.size; i++ ) {
-            char c = (char) res.data[ i + cursor ];
-
-            if ( c == '\n' ) break;
-
-            if ( i >= MAX_LINE_LENGTH ) {
-                ERROR_LOG( "line length exceeded" );
-                break;
-            }
-
-            line[ i ] = c;
-        }
-        cursor += i + 1;
-        line[ i ] = '\0';
+    attrib_table_t table;
+    table.pos_list = new float[ total.pos * 3 ];
+    table.normal_list = new float[ total.normal * 3 ];
+    table.uv_list = new float[ total.uv * 2 ];
+    table.corner_list = new int[ total.index * 3 ];
+
+    // parse pass
+    parallel_for( chunk_count, [ & ]( int i ) {
+        parse_chunk( chunk_list + i, out, &table );
+    } );
+
+    // weld pass
+    out->vertex_count =
+        weld_corners( out->index_list, table.corner_list, total.index );
+
+    out->pos_list = new float[ out->vertex_count * 3 ];
+    out->normal_list = new float[ out->vertex_count * 3 ];
+    out->uv_list = new float[ out->vertex_count * 2 ];
+
+    // gather pass
+    parallel_for( chunk_count, [ & ]( int i ) {
+        int first = (int) ( (long long) out->vertex_count * i / chunk_count );
+        int last =
+            (int) ( (long long) out->vertex_count * ( i + 1 ) / chunk_count );
+        gather_vertices( out, &table, first, last );
+    } );
 
-        // parse o command
-        if ( starts_with( line, "o " ) ) {
-            if ( out->obj_count >= MAX_OBJ_COUNT ) {
-                ERROR_LOG( "object limit exceeded" );
-                continue;
-            }
-            char * name = new char[ MAX_NAME_LENGTH ];
-            errors += parse_object_line( name, line );
-            out->obj_name_list[ out->obj_count ] = name;
-            out->obj_count++;
-        }
-
-        // parse v command
-        if ( starts_with( line, "v " ) ) {
-            if ( pos_count >= MAX_VERTEX_COUNT * 3 ) {
-                ERROR_LOG( "vertex limit exceeded" );
-                continue;
-            }
-            float pos[ 3 ];
-            errors += parse_position_line( pos, line );
-            pos_list[ pos_count * 3 + 0 ] = pos[ 0 ];
-            pos_list[ pos_count * 3 + 1 ] = pos[ 1 ];
-            pos_list[ pos_count * 3 + 2 ] = pos[ 2 ];
-            pos_count++;
-        }
-
-        // parse vn command
-        if ( starts_with( line, "vn " ) ) {
-            if ( normal_count >= MAX_VERTEX_COUNT * 3 ) {
-                ERROR_LOG( "vertex limit exceeded" );
-                continue;
-            }
-            float normal[ 3 ];
-            errors += parse_normal_line( normal, line );
-            normal_list[ normal_count * 3 + 0 ] = normal[ 0 ];
-            normal_list[ normal_count * 3 + 1 ] = normal[ 1 ];
-            normal_list[ normal_count * 3 + 2 ] = normal[ 2 ];
-            normal_count++;
-        }
-
-        // parse vt command
-        if ( starts_with( line, "vt " ) ) {
-            if ( uv_count >= MAX_VERTEX_COUNT * 2 ) {
-                ERROR_LOG( "vertex limit exceeded" );
-                continue;
-            }
-            float uv[ 2 ];
-            errors += parse_uv_line( uv, line );
-            uv_list[ uv_count * 2 + 0 ] = uv[ 0 ];
-            uv_list[ uv_count * 2 + 1 ] = 1.0f - uv[ 1 ]; // idk why this is flipped but yk
-            uv_count++;
-        }
-
-        // parse f command
-        if ( starts_with( line, "f " ) ) {
-            int index_list[ MAX_POLYGON_LENGTH * 3 ];
-            int index_count = 0;
-            errors += parse_face_line( index_list, &index_count, line );
-            append_face(
-                out,
-                pos_list,
-                normal_list,
-                uv_list,
-                index_list,
-                index_count
-            );
-        }
+    int errors = 0;
 
-        if ( starts_with( line, "mtllib " ) ) {
-            char * name = new char[ MAX_NAME_LENGTH ];
-            errors += parse_material_lib_line( name, line );
-            out->material_lib_filename = name;
-        }
-
-        if ( starts_with( line, "usemtl " ) ) {
-            if ( out->material_group_count >= MAX_MATERIAL_GROUP_COUNT ) {
-                ERROR_LOG( "material group count exceeded" );
-                continue;
-            }
-            char * name = new char[ MAX_NAME_LENGTH ];
-            errors += parse_usemtl_line( name, line );
-            out->material_group_material_list[ out->material_group_count ] =
-                name;
-            out->material_group_offset_list[ out->material_group_count ] =
-                out->vertex_count;
-            out->material_group_count++;
+    // last mtllib wins
+    for ( int i = 0; i < chunk_count; i++ ) {
+        errors += chunk_list[ i ].errors;
+        if ( chunk_list[ i ].material_lib_filename ) {
+            delete[] out->material_lib_filename;
+            out->material_lib_filename = chunk_list[ i ].material_lib_filename;
         }
     }
 
@@ -420,18 +894,64 @@ int load_wavefront( wavefront_t * out, res_t res )
     //print_header( out );
 
     // stfu idc
-    delete[] pos_list;
-    delete[] normal_list;
-    delete[] uv_list;
+    delete[] table.pos_list;
+    delete[] table.normal_list;
+    delete[] table.uv_list;
+    delete[] table.corner_list;
 
     return errors;
 }
 
+int load_wavefront( wavefront_t * out, res_t res )
+{
+    return load_chunks( out, res, 1 );
+}
+
+int load_wavefront_parallel( wavefront_t * out, res_t res, int thread_count )
+{
+#ifdef __EMSCRIPTEN__
+    thread_count = 1;
+#else
+    if ( thread_count <= 0 ) {
+        thread_count = (int) std::thread::hardware_concurrency();
+    }
+#endif
+
+    if ( thread_count < 1 ) thread_count = 1;
+    if ( thread_count > MAX_CHUNK_COUNT ) thread_count = MAX_CHUNK_COUNT;
+
+    return load_chunks( out, res, thread_count );
+}
+
+void wavefront_free( wavefront_t * mesh )
+{
+    for ( int i = 0; i < mesh->obj_count; i++ ) {
+        delete[] mesh->obj_name_list[ i ];
+    }
+
+    for ( int i = 0; i < mesh->material_group_count; i++ ) {
+        delete[] mesh->material_group_material_list[ i ];
+    }
+
+    delete[] mesh->pos_list;
+    delete[] mesh->normal_list;
+    delete[] mesh->uv_list;
+    delete[] mesh->index_list;
+    delete[] mesh->obj_offset_list;
+    delete[] mesh->obj_name_list;
+    delete[] mesh->material_lib_filename;
+    delete[] mesh->material_group_offset_list;
+    delete[] mesh->material_group_material_list;
+
+    memset( mesh, 0, sizeof( wavefront_t ) );
+}
+
 int load_material_lib( material_lib_t * out, res_t res )
 {
+    const char * p = (const char *) res.data;
+    const char * end = p + res.size;
+
     int errors = 0;
-    int cursor = 0;
-    char line[ MAX_LINE_LENGTH ];
 
     using c_string_t = const char *;
     out->material_name_list = new c_string_t[ MAX_MATERIAL_COUNT ];
@@ -441,32 +961,19 @@ int load_material_lib( material_lib_t * out, res_t res )
     // zero out all the materials
     memset( out->material_list, 0, MAX_MATERIAL_COUNT * sizeof( material_t ) );
 
-    while ( cursor < res.size ) {
-        // load next line
-        int i;
-        for ( i = 0; i + cursor < res.size; i++ ) {
-            char c = (char) res.data[ i + cursor ];
-
-            if ( c == '\n' ) break;
-
-            if ( i >= MAX_LINE_LENGTH ) {
-                ERROR_LOG( "line length exceeded" );
-                break;
-            }
+    for ( ; p < end; p = next_line( p, end ) ) {
+        p = skip_blank( p, end );
 
-            line[ i ] = c;
-        }
-        cursor += i + 1;
-        line[ i ] = '\0';
+        const char * args;
 
         // parse newmtl command
-        if ( starts_with( line, "newmtl " ) ) {
+        if ( ( args = match_keyword( p, end, "newmtl" ) ) ) {
             if ( out->material_count >= MAX_MATERIAL_COUNT ) {
                 ERROR_LOG( "material count exceeded" );
                 continue;
             }
             char * newmtl = new char[ MAX_NAME_LENGTH ];
-            errors += parse_newmtl_line( newmtl, line );
+            errors += parse_name( newmtl, args, end );
             out->material_name_list[ out->material_count ] = newmtl;
             out->material_count++;
         }
@@ -477,33 +984,34 @@ int load_material_lib( material_lib_t * out, res_t res )
         // get current material
         material_t * mat = out->material_list + ( out->material_count - 1 );
 
-        if ( starts_with( line, "Ns " ) ) {
-            errors += parse_ns_line( &mat->ns, line );
+        if ( ( args = match_keyword( p, end, "Ns" ) ) ) {
+            errors += parse_float( &mat->ns, &args, end );
         }
-        if ( starts_with( line, "Ka " ) ) {
-            errors += parse_ka_line( mat->ka, line );
+        if ( ( args = match_keyword( p, end, "Ka" ) ) ) {
+            errors += parse_floats( mat->ka, 3, &args, end );
         }
-        if ( starts_with( line, "Kd " ) ) {
-            errors += parse_kd_line( mat->kd, line );
+        if ( ( args = match_keyword( p, end, "Kd" ) ) ) {
+            errors += parse_floats( mat->kd, 3, &args, end );
         }
-        if ( starts_with( line, "Ks " ) ) {
-            errors += parse_ks_line( mat->ks, line );
+        if ( ( args = match_keyword( p, end, "Ks" ) ) ) {
+            errors += parse_floats( mat->ks, 3, &args, end );
         }
-        if ( starts_with( line, "Ke " ) ) {
-            errors += parse_ke_line( mat->ke, line );
+        if ( ( args = match_keyword( p, end, "Ke" ) ) ) {
+            errors += parse_floats( mat->ke, 3, &args, end );
         }
-        if ( starts_with( line, "Ni " ) ) {
-            errors += parse_ni_line( &mat->ni, line );
+        if ( ( args = match_keyword( p, end, "Ni" ) ) ) {
+            errors += parse_float( &mat->ni, &args, end );
         }
-        if ( starts_with( line, "d " ) ) {
-            errors += parse_d_line( &mat->d, line );
+        if ( ( args = match_keyword( p, end, "d" ) ) ) {
+            errors += parse_float( &mat->d, &args, end );
         }
-        if ( starts_with( line, "illum " ) ) {
-            errors += parse_illum_line( &mat->illum, line );
+        if ( ( args = match_keyword( p, end, "illum" ) ) ) {
+            args = skip_blank( args, end );
+            errors += parse_int( &mat->illum, &args, end );
         }
-        if ( starts_with( line, "map_Kd " ) ) {
+        if ( ( args = match_keyword( p, end, "map_Kd" ) ) ) {
             char * filename = new char[ MAX_NAME_LENGTH ];
-            errors += parse_map_kd_line( filename, line );
+            errors += parse_name( filename, args, end );
             mat->map_kd = filename;
         }
     }
@@ -521,3 +1029,17 @@ int load_material_lib( material_lib_t * out, res_t res )
 
     return errors;
 }
+
+void material_lib_free( material_lib_t * lib )
+{
+    for ( int i = 0; i < lib->material_count; i++ ) {
+        delete[] lib->material_name_list[ i ];
+        delete[] lib->material_list[ i ].map_kd;
+        delete[] lib->material_list[ i ].map_kd_data;
+    }
+
+    delete[] lib->material_name_list;
+    delete[] lib->material_list;
+
+    memset( lib, 0, sizeof( material_lib_t ) );
+}
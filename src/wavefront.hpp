@@ -3,19 +3,22 @@
 #include "res.hpp"
 
 struct wavefront_t {
-    float * pos_list;
+    float * pos_list; // unique vertices
     float * normal_list;
     float * uv_list;
 
     int vertex_count;
 
-    int * obj_offset_list;
+    unsigned int * index_list; // triangle list
+    int index_count;
+
+    int * obj_offset_list; // first index of each object
     const char ** obj_name_list;
     int obj_count;
 
     const char * material_lib_filename;
 
-    int * material_group_offset_list;
+    int * material_group_offset_list; // first index of each group
     const char ** material_group_material_list;
     int material_group_count;
 
@@ -32,6 +35,9 @@ struct material_t {
     float d;             // dissolve
     int illum;           // illum model
     const char * map_kd; // diffuse texture map
+
+    unsigned char * map_kd_data; // embedded diffuse image, instead of map_kd
+    int map_kd_size;
 };
 
 struct material_lib_t {
@@ -43,6 +49,21 @@ struct material_lib_t {
 /// @threadsafe
 int load_wavefront( wavefront_t * out_mesh, res_t res );
 
+/// same output as load_wavefront, but the file is split into newline aligned
+/// chunks that are parsed on up to thread_count threads (0 = core count).
+/// small files are parsed on the calling thread.
+/// @threadsafe
+int load_wavefront_parallel(
+    wavefront_t * out_mesh,
+    res_t res,
+    int thread_count
+);
+
+/// frees everything load_wavefront allocated
+void wavefront_free( wavefront_t * mesh );
+
 /// @threadsafe
 int load_material_lib( material_lib_t * out_lib, res_t res );
 
+/// frees everything load_material_lib allocated
+void material_lib_free( material_lib_t * lib );
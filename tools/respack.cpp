@@ -0,0 +1,247 @@
+// packs every file of a resource directory into one archive, see
+// src/archive.hpp for the layout.
+//
+//   respack <res dir> <out archive>
+
+#include "archive.hpp"
+#include "logging.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include "windows.h"
+#else
+#include <dirent.h>
+#endif
+
+#define MAX_PATH_LENGTH 1024
+
+// entries below this ratio of their size after compression are stored
+// compressed, png and the like do not shrink and stay raw
+#define COMPRESS_RATIO 0.9
+
+static bool skip_file( const char * name )
+{
+    int len = strlen( name );
+
+    if ( name[ 0 ] == '.' ) return true;
+    if ( len > 5 && strcmp( name + len - 5, ".mesh" ) == 0 ) return true;
+    if ( len > 4 && strcmp( name + len - 4, ".pak" ) == 0 ) return true;
+    if ( len > 8 && strcmp( name + len - 8, ".catalog" ) == 0 ) return true;
+    if ( len > 6 && strcmp( name + len - 6, ".cache" ) == 0 ) return true;
+
+    return false;
+}
+
+static int compare_name( const void * a, const void * b )
+{
+    return strcmp( *(char * const *) a, *(char * const *) b );
+}
+
+/// sorted so the archive does not depend on the directory order
+static char ** list_files( const char * dir, int * out_count )
+{
+    int count = 0;
+    int cap = 64;
+    char ** name_list = (char **) malloc( sizeof( char * ) * cap );
+
+#ifdef _WIN32
+    char pattern[ MAX_PATH_LENGTH ];
+    snprintf( pattern, MAX_PATH_LENGTH, "%s\\*.*", dir );
+
+    WIN32_FIND_DATA fd;
+    HANDLE find = FindFirstFile( pattern, &fd );
+    if ( find != INVALID_HANDLE_VALUE ) {
+        do {
+            if ( fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) continue;
+            if ( skip_file( fd.cFileName ) ) continue;
+            if ( count >= cap ) {
+                cap *= 2;
+                name_list =
+                    (char **) realloc( name_list, sizeof( char * ) * cap );
+            }
+            name_list[ count++ ] = strdup( fd.cFileName );
+        } while ( FindNextFile( find, &fd ) );
+
+        FindClose( find );
+    }
+#else
+    DIR * d = opendir( dir );
+    if ( d ) {
+        dirent * p;
+        while ( ( p = readdir( d ) ) ) {
+            if ( p->d_type == DT_DIR ) continue;
+            if ( skip_file( p->d_name ) ) continue;
+            if ( count >= cap ) {
+                cap *= 2;
+                name_list =
+                    (char **) realloc( name_list, sizeof( char * ) * cap );
+            }
+            name_list[ count++ ] = strdup( p->d_name );
+        }
+
+        closedir( d );
+    }
+#endif
+
+    qsort( name_list, count, sizeof( char * ), compare_name );
+
+    *out_count = count;
+    return name_list;
+}
+
+static uint64_t align( uint64_t offset )
+{
+    return ( offset + ARCHIVE_ALIGN - 1 ) & ~(uint64_t) ( ARCHIVE_ALIGN - 1 );
+}
+
+static void write_padding( FILE * file, uint64_t from, uint64_t to )
+{
+    static const char zero[ ARCHIVE_ALIGN ] = {};
+    fwrite( zero, 1, to - from, file );
+}
+
+int main( int argc, char ** argv )
+{
+    if ( argc != 3 ) {
+        fprintf( stderr, "usage: respack <res dir> <out archive>\n" );
+        return 1;
+    }
+
+    const char * dir = argv[ 1 ];
+    const char * out_path = argv[ 2 ];
+
+    int count;
+    char ** name_list = list_files( dir, &count );
+
+    uint32_t slot_count = 16;
+    while ( slot_count < (uint32_t) count * 2 ) slot_count *= 2;
+
+    archive_entry_t * slot_list = new archive_entry_t[ slot_count ];
+    memset( slot_list, 0, sizeof( archive_entry_t ) * slot_count );
+
+    uint64_t names_size = 0;
+    for ( int i = 0; i < count; i++ ) {
+        names_size += strlen( name_list[ i ] ) + 1;
+    }
+
+    archive_header_t header;
+    memcpy( header.magic, archive_magic, 4 );
+    header.version = ARCHIVE_VERSION;
+    header.entry_count = count;
+    header.slot_count = slot_count;
+    header.names_offset =
+        sizeof( archive_header_t ) + slot_count * sizeof( archive_entry_t );
+    header.names_size = names_size;
+
+    FILE * out = fopen( out_path, "wb" );
+    if ( !out ) {
+        ERROR_LOG( "failed to open %s", out_path );
+        return 1;
+    }
+
+    // the table of contents is written again at the end, once the offsets
+    // are known
+    fwrite( &header, sizeof( archive_header_t ), 1, out );
+    fwrite( slot_list, sizeof( archive_entry_t ), slot_count, out );
+    for ( int i = 0; i < count; i++ ) {
+        fwrite( name_list[ i ], 1, strlen( name_list[ i ] ) + 1, out );
+    }
+
+    uint64_t offset = align( header.names_offset + names_size );
+    write_padding( out, header.names_offset + names_size, offset );
+
+    uint64_t raw_total = 0;
+    uint64_t stored_total = 0;
+    uint32_t name_offset = 0;
+    int errors = 0;
+
+    for ( int i = 0; i < count; i++ ) {
+        char path[ MAX_PATH_LENGTH ];
+        snprintf( path, MAX_PATH_LENGTH, "%s/%s", dir, name_list[ i ] );
+
+        res_t res = load_file( path );
+        if ( !res.data ) {
+            ERROR_LOG( "failed to read %s", path );
+            errors++;
+            break;
+        }
+
+        archive_entry_t entry;
+        memset( &entry, 0, sizeof( archive_entry_t ) );
+        entry.name_hash = archive_name_hash( name_list[ i ] );
+        entry.offset = offset;
+        entry.raw_size = res.size;
+        entry.codec = ARCHIVE_CODEC_NONE;
+        entry.size = res.size;
+        entry.name_offset = name_offset;
+
+        unsigned char * stored = res.data;
+        unsigned char * packed = nullptr;
+
+        if ( res.size > 0 && res.size < 0x7fffffff ) {
+            packed = new unsigned char[ lz4_bound( res.size ) ];
+            size_t packed_size = lz4_compress( res.data, res.size, packed );
+
+            if ( packed_size < res.size * COMPRESS_RATIO ) {
+                entry.codec = ARCHIVE_CODEC_LZ4;
+                entry.size = packed_size;
+                stored = packed;
+            }
+        }
+
+        fwrite( stored, 1, entry.size, out );
+
+        uint64_t next = align( offset + entry.size );
+        write_padding( out, offset + entry.size, next );
+        offset = next;
+
+        uint32_t slot = (uint32_t) entry.name_hash & ( slot_count - 1 );
+        while ( slot_list[ slot ].name_hash != 0 ) {
+            slot = ( slot + 1 ) & ( slot_count - 1 );
+        }
+        slot_list[ slot ] = entry;
+
+        name_offset += strlen( name_list[ i ] ) + 1;
+        raw_total += entry.raw_size;
+        stored_total += entry.size;
+
+        INFO_LOG(
+            "%-24s %8llu -> %8llu%s",
+            name_list[ i ],
+            (unsigned long long) entry.raw_size,
+            (unsigned long long) entry.size,
+            entry.codec == ARCHIVE_CODEC_LZ4 ? " lz4" : ""
+        );
+
+        delete[] packed;
+        release_res( &res );
+    }
+
+    fseek( out, 0, SEEK_SET );
+    fwrite( &header, sizeof( archive_header_t ), 1, out );
+    fwrite( slot_list, sizeof( archive_entry_t ), slot_count, out );
+
+    fclose( out );
+
+    // a partial archive would shadow the files it is missing
+    if ( errors > 0 ) {
+        remove( out_path );
+        return 1;
+    }
+
+    INFO_LOG(
+        "packed %d files, %llu -> %llu bytes",
+        count,
+        (unsigned long long) raw_total,
+        (unsigned long long) stored_total
+    );
+
+    for ( int i = 0; i < count; i++ ) free( name_list[ i ] );
+    free( name_list );
+    delete[] slot_list;
+
+    return 0;
+}
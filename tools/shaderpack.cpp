@@ -0,0 +1,137 @@
+// compiles the sections of shaders.glsl into a header of string literals
+// for release builds, see src/shader_sections.hpp.
+//
+//   shaderpack <shaders.glsl> <out header>
+
+#include "logging.hpp"
+#include "shader_sections.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+/// whole file with a terminator, nullptr if it does not read
+static char * read_text( const char * path )
+{
+    FILE * f = fopen( path, "rb" );
+    if ( !f ) return nullptr;
+
+    fseek( f, 0, SEEK_END );
+    long size = ftell( f );
+    fseek( f, 0, SEEK_SET );
+
+    if ( size < 0 ) {
+        fclose( f );
+        return nullptr;
+    }
+
+    char * text = new char[ size + 1 ];
+    size_t read = fread( text, 1, size, f );
+    fclose( f );
+
+    if ( read != (size_t) size ) {
+        delete[] text;
+        return nullptr;
+    }
+
+    text[ size ] = '\0';
+    return text;
+}
+
+/// one c string literal per source line, so the table reads like the file
+static void write_literal( FILE * out, const char * s )
+{
+    fputs( "        \"", out );
+
+    for ( ; *s; s++ ) {
+        unsigned char c = *s;
+
+        if ( c == '\n' ) {
+            fputs( "\\n\"", out );
+            if ( s[ 1 ] ) fputs( "\n        \"", out );
+            continue;
+        }
+
+        if ( c == '"' || c == '\\' ) {
+            fprintf( out, "\\%c", c );
+        } else if ( c == '\t' ) {
+            fputs( "\\t", out );
+        } else if ( c < ' ' || c >= 0x7f ) {
+            // octal, hex escapes would swallow the digits after them
+            fprintf( out, "\\%03o", c );
+        } else {
+            fputc( c, out );
+        }
+    }
+
+    if ( s[ -1 ] != '\n' ) fputc( '"', out );
+}
+
+static void write_table( FILE * out, shader_section_t * list, int count )
+{
+    fputs( "// generated by tools/shaderpack.cpp from shaders.glsl, do not "
+           "edit\n\n",
+           out );
+    fputs( "#pragma once\n\n", out );
+    fputs( "#include \"shader_sections.hpp\"\n\n", out );
+
+    fputs( "constexpr shader_section_t shader_table[] = {\n", out );
+    for ( int i = 0; i < count; i++ ) {
+        fputs( "    {\n", out );
+        fprintf( out, "        \"%s\",\n", list[ i ].name );
+        if ( list[ i ].size > 0 ) {
+            write_literal( out, list[ i ].source );
+        } else {
+            fputs( "        \"\"", out );
+        }
+        fprintf( out, ",\n        %d,\n", list[ i ].size );
+        fputs( "    },\n", out );
+    }
+    fputs( "};\n\n", out );
+
+    fprintf( out, "constexpr int shader_table_count = %d;\n", count );
+}
+
+int main( int argc, char ** argv )
+{
+    if ( argc != 3 ) {
+        fprintf( stderr, "usage: shaderpack <shaders.glsl> <out header>\n" );
+        return 1;
+    }
+
+    const char * in_path = argv[ 1 ];
+    const char * out_path = argv[ 2 ];
+
+    char * text = read_text( in_path );
+    if ( !text ) {
+        ERROR_LOG( "failed to read %s", in_path );
+        return 1;
+    }
+
+    shader_section_t list[ MAX_SHADER_SECTION_COUNT ];
+    int count = split_shader_sections( text, list, MAX_SHADER_SECTION_COUNT );
+    if ( count < 0 ) {
+        ERROR_LOG(
+            "%s has more than %d sections",
+            in_path,
+            MAX_SHADER_SECTION_COUNT
+        );
+        delete[] text;
+        return 1;
+    }
+
+    FILE * out = fopen( out_path, "wb" );
+    if ( !out ) {
+        ERROR_LOG( "failed to open %s", out_path );
+        delete[] text;
+        return 1;
+    }
+
+    write_table( out, list, count );
+    fclose( out );
+
+    INFO_LOG( "wrote %d shader sections to %s", count, out_path );
+
+    delete[] text;
+
+    return 0;
+}
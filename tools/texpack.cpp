@@ -0,0 +1,759 @@
+// encodes every png of a resource directory into gpu compressed texture
+// files next to it, bc1/bc3 for desktop and etc2 for gles and webgl. see
+// src/texture_file.hpp for the layout. files newer than their image are
+// left alone.
+//
+//   texpack <res dir>
+
+#include "logging.hpp"
+#include "texture_file.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include "windows.h"
+#else
+#include <dirent.h>
+#endif
+
+#define MAX_PATH_LENGTH 1024
+
+static bool is_image( const char * name )
+{
+    int len = strlen( name );
+    return len > 4 && strcmp( name + len - 4, ".png" ) == 0;
+}
+
+static int compare_name( const void * a, const void * b )
+{
+    return strcmp( *(char * const *) a, *(char * const *) b );
+}
+
+static char ** list_images( const char * dir, int * out_count )
+{
+    int count = 0;
+    int cap = 64;
+    char ** name_list = (char **) malloc( sizeof( char * ) * cap );
+
+#ifdef _WIN32
+    char pattern[ MAX_PATH_LENGTH ];
+    snprintf( pattern, MAX_PATH_LENGTH, "%s\\*.png", dir );
+
+    WIN32_FIND_DATA fd;
+    HANDLE find = FindFirstFile( pattern, &fd );
+    if ( find != INVALID_HANDLE_VALUE ) {
+        do {
+            if ( fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) continue;
+            if ( !is_image( fd.cFileName ) ) continue;
+            if ( count >= cap ) {
+                cap *= 2;
+                name_list =
+                    (char **) realloc( name_list, sizeof( char * ) * cap );
+            }
+            name_list[ count++ ] = strdup( fd.cFileName );
+        } while ( FindNextFile( find, &fd ) );
+
+        FindClose( find );
+    }
+#else
+    DIR * d = opendir( dir );
+    if ( d ) {
+        dirent * p;
+        while ( ( p = readdir( d ) ) ) {
+            if ( p->d_type == DT_DIR ) continue;
+            if ( !is_image( p->d_name ) ) continue;
+            if ( count >= cap ) {
+                cap *= 2;
+                name_list =
+                    (char **) realloc( name_list, sizeof( char * ) * cap );
+            }
+            name_list[ count++ ] = strdup( p->d_name );
+        }
+
+        closedir( d );
+    }
+#endif
+
+    qsort( name_list, count, sizeof( char * ), compare_name );
+
+    *out_count = count;
+    return name_list;
+}
+
+/// a texture file at least as new as its image
+static bool is_up_to_date( const char * image_path, const char * path )
+{
+    struct stat image_st;
+    struct stat st;
+    if ( stat( image_path, &image_st ) ) return false;
+    if ( stat( path, &st ) ) return false;
+
+    return st.st_mtime >= image_st.st_mtime;
+}
+
+static int clamp_byte( int v )
+{
+    return v < 0 ? 0 : ( v > 255 ? 255 : v );
+}
+
+static int color_distance( const unsigned char * a, const int * b )
+{
+    int dr = a[ 0 ] - b[ 0 ];
+    int dg = a[ 1 ] - b[ 1 ];
+    int db = a[ 2 ] - b[ 2 ];
+    return dr * dr + dg * dg + db * db;
+}
+
+/// the 4x4 block at bx, by as rgba, edges repeated for levels below 4x4
+static void read_block(
+    const unsigned char * image,
+    int width,
+    int height,
+    int bx,
+    int by,
+    unsigned char ( *out )[ 4 ]
+)
+{
+    for ( int y = 0; y < 4; y++ ) {
+        int sy = by * 4 + y < height ? by * 4 + y : height - 1;
+        for ( int x = 0; x < 4; x++ ) {
+            int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+            memcpy( out[ y * 4 + x ], image + ( sy * width + sx ) * 4, 4 );
+        }
+    }
+}
+
+// bc [begin] //////////////////////////////////////////////////////////////////
+
+// a color block is two 565 endpoints, little endian, and 2 bit indices for
+// the pixels in row order: 0 = the first endpoint, 1 = the second, 2 and 3
+// = the two thirds between them. with the first endpoint the larger one the
+// block has no transparent texel.
+
+static int to_565( const float * c )
+{
+    int r = (int) ( c[ 0 ] * 31.0f / 255.0f + 0.5f );
+    int g = (int) ( c[ 1 ] * 63.0f / 255.0f + 0.5f );
+    int b = (int) ( c[ 2 ] * 31.0f / 255.0f + 0.5f );
+    return r << 11 | g << 5 | b;
+}
+
+static void from_565( int c, int * out )
+{
+    int r = c >> 11 & 31;
+    int g = c >> 5 & 63;
+    int b = c & 31;
+    out[ 0 ] = r << 3 | r >> 2;
+    out[ 1 ] = g << 2 | g >> 4;
+    out[ 2 ] = b << 3 | b >> 2;
+}
+
+/// endpoints at the ends of the principal axis of the colors
+static void encode_bc1_block( unsigned char ( *px )[ 4 ], unsigned char * out )
+{
+    float mean[ 3 ] = {};
+    for ( int i = 0; i < 16; i++ ) {
+        for ( int c = 0; c < 3; c++ ) mean[ c ] += px[ i ][ c ] / 16.0f;
+    }
+
+    float cov[ 6 ] = {}; // rr rg rb gg gb bb
+    for ( int i = 0; i < 16; i++ ) {
+        float r = px[ i ][ 0 ] - mean[ 0 ];
+        float g = px[ i ][ 1 ] - mean[ 1 ];
+        float b = px[ i ][ 2 ] - mean[ 2 ];
+        cov[ 0 ] += r * r;
+        cov[ 1 ] += r * g;
+        cov[ 2 ] += r * b;
+        cov[ 3 ] += g * g;
+        cov[ 4 ] += g * b;
+        cov[ 5 ] += b * b;
+    }
+
+    // power iteration, starting off the gray diagonal
+    float axis[ 3 ] = { 0.9f, 1.0f, 0.7f };
+    for ( int iteration = 0; iteration < 8; iteration++ ) {
+        float x = cov[ 0 ] * axis[ 0 ] + cov[ 1 ] * axis[ 1 ] +
+                  cov[ 2 ] * axis[ 2 ];
+        float y = cov[ 1 ] * axis[ 0 ] + cov[ 3 ] * axis[ 1 ] +
+                  cov[ 4 ] * axis[ 2 ];
+        float z = cov[ 2 ] * axis[ 0 ] + cov[ 4 ] * axis[ 1 ] +
+                  cov[ 5 ] * axis[ 2 ];
+
+        float length = sqrtf( x * x + y * y + z * z );
+        if ( length < 1e-6f ) break;
+
+        axis[ 0 ] = x / length;
+        axis[ 1 ] = y / length;
+        axis[ 2 ] = z / length;
+    }
+
+    float min_t = 0.0f;
+    float max_t = 0.0f;
+    for ( int i = 0; i < 16; i++ ) {
+        float t = 0.0f;
+        for ( int c = 0; c < 3; c++ ) {
+            t += ( px[ i ][ c ] - mean[ c ] ) * axis[ c ];
+        }
+        if ( t < min_t ) min_t = t;
+        if ( t > max_t ) max_t = t;
+    }
+
+    float end0[ 3 ];
+    float end1[ 3 ];
+    for ( int c = 0; c < 3; c++ ) {
+        end0[ c ] = (float) clamp_byte( mean[ c ] + axis[ c ] * max_t );
+        end1[ c ] = (float) clamp_byte( mean[ c ] + axis[ c ] * min_t );
+    }
+
+    int c0 = to_565( end0 );
+    int c1 = to_565( end1 );
+    if ( c0 < c1 ) {
+        int t = c0;
+        c0 = c1;
+        c1 = t;
+    }
+
+    int palette[ 4 ][ 3 ];
+    from_565( c0, palette[ 0 ] );
+    from_565( c1, palette[ 1 ] );
+    for ( int c = 0; c < 3; c++ ) {
+        palette[ 2 ][ c ] = ( 2 * palette[ 0 ][ c ] + palette[ 1 ][ c ] ) / 3;
+        palette[ 3 ][ c ] = ( palette[ 0 ][ c ] + 2 * palette[ 1 ][ c ] ) / 3;
+    }
+
+    uint32_t indices = 0;
+    if ( c0 != c1 ) {
+        for ( int i = 0; i < 16; i++ ) {
+            int best = 0;
+            int best_distance = color_distance( px[ i ], palette[ 0 ] );
+            for ( int j = 1; j < 4; j++ ) {
+                int distance = color_distance( px[ i ], palette[ j ] );
+                if ( distance < best_distance ) {
+                    best = j;
+                    best_distance = distance;
+                }
+            }
+            indices |= (uint32_t) best << ( i * 2 );
+        }
+    }
+
+    out[ 0 ] = c0 & 255;
+    out[ 1 ] = c0 >> 8;
+    out[ 2 ] = c1 & 255;
+    out[ 3 ] = c1 >> 8;
+    for ( int i = 0; i < 4; i++ ) out[ 4 + i ] = indices >> ( i * 8 ) & 255;
+}
+
+/// two 8 bit endpoints, the larger first, and 3 bit indices: 0 and 1 the
+/// endpoints, 2 to 7 the six sevenths between them
+static void encode_bc3_alpha( unsigned char ( *px )[ 4 ], unsigned char * out )
+{
+    int a0 = 0;
+    int a1 = 255;
+    for ( int i = 0; i < 16; i++ ) {
+        if ( px[ i ][ 3 ] > a0 ) a0 = px[ i ][ 3 ];
+        if ( px[ i ][ 3 ] < a1 ) a1 = px[ i ][ 3 ];
+    }
+
+    int palette[ 8 ];
+    palette[ 0 ] = a0;
+    palette[ 1 ] = a1;
+    for ( int j = 1; j < 7; j++ ) {
+        palette[ j + 1 ] = ( ( 7 - j ) * a0 + j * a1 ) / 7;
+    }
+
+    uint64_t indices = 0;
+    if ( a0 != a1 ) {
+        for ( int i = 0; i < 16; i++ ) {
+            int best = 0;
+            for ( int j = 1; j < 8; j++ ) {
+                if ( abs( px[ i ][ 3 ] - palette[ j ] ) <
+                     abs( px[ i ][ 3 ] - palette[ best ] ) ) {
+                    best = j;
+                }
+            }
+            indices |= (uint64_t) best << ( i * 3 );
+        }
+    }
+
+    out[ 0 ] = a0;
+    out[ 1 ] = a1;
+    for ( int i = 0; i < 6; i++ ) out[ 2 + i ] = indices >> ( i * 8 ) & 255;
+}
+
+// bc [end] ////////////////////////////////////////////////////////////////////
+
+// etc [begin] /////////////////////////////////////////////////////////////////
+
+// etc1 blocks in individual mode, which etc2 decoders read as they are: two
+// halves, side by side or stacked, each with a 444 base color and a table of
+// offsets added to it. 2 bit pixel indices pick the offset, stored as an msb
+// and an lsb plane with the pixels in column order. big endian.
+
+static const int etc_table_list[ 8 ][ 2 ] = {
+    { 2, 8 },   { 5, 17 },  { 9, 29 },  { 13, 42 },
+    { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 },
+};
+
+// eac alpha offsets, scaled by the multiplier of the block
+static const int eac_table_list[ 16 ][ 8 ] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },  { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },  { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },  { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },  { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },   { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },   { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },   { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },    { -3, -5, -7, -9, 2, 4, 6, 8 },
+};
+
+/// index 0 = +small, 1 = +large, 2 = -small, 3 = -large
+static int etc_offset( int table, int index )
+{
+    int offset = etc_table_list[ table ][ index & 1 ];
+    return index & 2 ? -offset : offset;
+}
+
+struct etc_half_t {
+    int base[ 3 ]; // 4 bits each
+    int table;
+    int index_list[ 8 ];
+    int error;
+};
+
+/// tries the rounded mean and one step darker and lighter as the base with
+/// every table
+static void encode_etc_half(
+    unsigned char ( *px )[ 4 ],
+    const int * pixel_list,
+    etc_half_t * out
+)
+{
+    int mean[ 3 ] = {};
+    for ( int i = 0; i < 8; i++ ) {
+        for ( int c = 0; c < 3; c++ ) mean[ c ] += px[ pixel_list[ i ] ][ c ];
+    }
+
+    out->error = 0x7fffffff;
+
+    for ( int shift = -1; shift <= 1; shift++ ) {
+        int base[ 3 ];
+        int color[ 3 ];
+        for ( int c = 0; c < 3; c++ ) {
+            base[ c ] = ( mean[ c ] * 15 + 255 * 4 ) / ( 255 * 8 ) + shift;
+            if ( base[ c ] < 0 ) base[ c ] = 0;
+            if ( base[ c ] > 15 ) base[ c ] = 15;
+            color[ c ] = base[ c ] * 17;
+        }
+
+        for ( int table = 0; table < 8; table++ ) {
+            int error = 0;
+            int index_list[ 8 ];
+
+            for ( int i = 0; i < 8; i++ ) {
+                int best_error = 0x7fffffff;
+                for ( int index = 0; index < 4; index++ ) {
+                    int offset = etc_offset( table, index );
+                    int value[ 3 ];
+                    for ( int c = 0; c < 3; c++ ) {
+                        value[ c ] = clamp_byte( color[ c ] + offset );
+                    }
+                    int e = color_distance( px[ pixel_list[ i ] ], value );
+                    if ( e < best_error ) {
+                        best_error = e;
+                        index_list[ i ] = index;
+                    }
+                }
+                error += best_error;
+            }
+
+            if ( error < out->error ) {
+                memcpy( out->base, base, sizeof( base ) );
+                memcpy( out->index_list, index_list, sizeof( index_list ) );
+                out->table = table;
+                out->error = error;
+            }
+        }
+    }
+}
+
+static void write_big_endian( uint64_t v, unsigned char * out )
+{
+    for ( int i = 0; i < 8; i++ ) out[ i ] = v >> ( 56 - i * 8 ) & 255;
+}
+
+/// whichever split into halves fits better
+static void encode_etc_block( unsigned char ( *px )[ 4 ], unsigned char * out )
+{
+    uint64_t best_block = 0;
+    int best_error = 0x7fffffff;
+
+    for ( int flip = 0; flip < 2; flip++ ) {
+        int pixel_list[ 2 ][ 8 ];
+        int count[ 2 ] = {};
+        for ( int i = 0; i < 16; i++ ) {
+            int x = i % 4;
+            int y = i / 4;
+            int half = flip ? y >= 2 : x >= 2;
+            pixel_list[ half ][ count[ half ]++ ] = i;
+        }
+
+        etc_half_t half[ 2 ];
+        encode_etc_half( px, pixel_list[ 0 ], &half[ 0 ] );
+        encode_etc_half( px, pixel_list[ 1 ], &half[ 1 ] );
+
+        int error = half[ 0 ].error + half[ 1 ].error;
+        if ( error >= best_error ) continue;
+
+        uint64_t block = 0;
+        block |= (uint64_t) half[ 0 ].base[ 0 ] << 60;
+        block |= (uint64_t) half[ 1 ].base[ 0 ] << 56;
+        block |= (uint64_t) half[ 0 ].base[ 1 ] << 52;
+        block |= (uint64_t) half[ 1 ].base[ 1 ] << 48;
+        block |= (uint64_t) half[ 0 ].base[ 2 ] << 44;
+        block |= (uint64_t) half[ 1 ].base[ 2 ] << 40;
+        block |= (uint64_t) half[ 0 ].table << 37;
+        block |= (uint64_t) half[ 1 ].table << 34;
+        block |= (uint64_t) flip << 32; // bit 33, differential, stays 0
+
+        for ( int h = 0; h < 2; h++ ) {
+            for ( int i = 0; i < 8; i++ ) {
+                int p = pixel_list[ h ][ i ];
+                int bit = ( p % 4 ) * 4 + p / 4;
+                int index = half[ h ].index_list[ i ];
+                block |= (uint64_t) ( index >> 1 ) << ( 16 + bit );
+                block |= (uint64_t) ( index & 1 ) << bit;
+            }
+        }
+
+        best_block = block;
+        best_error = error;
+    }
+
+    write_big_endian( best_block, out );
+}
+
+/// base, multiplier and table searched around the alpha range, 3 bit
+/// indices in column order
+static void encode_eac_alpha( unsigned char ( *px )[ 4 ], unsigned char * out )
+{
+    int min_a = 255;
+    int max_a = 0;
+    for ( int i = 0; i < 16; i++ ) {
+        if ( px[ i ][ 3 ] < min_a ) min_a = px[ i ][ 3 ];
+        if ( px[ i ][ 3 ] > max_a ) max_a = px[ i ][ 3 ];
+    }
+
+    uint64_t best_block = 0;
+    int best_error = 0x7fffffff;
+
+    for ( int table = 0; table < 16; table++ ) {
+        const int * offset_list = eac_table_list[ table ];
+        int span = offset_list[ 7 ] - offset_list[ 3 ];
+        int guess = ( max_a - min_a + span / 2 ) / span;
+
+        for ( int multiplier = guess - 1; multiplier <= guess + 1;
+              multiplier++ ) {
+            if ( multiplier < 1 || multiplier > 15 ) continue;
+
+            // the offsets lean negative, the base sits a little above the
+            // middle of the range
+            int base = clamp_byte(
+                ( min_a + max_a + 1 ) / 2 -
+                ( offset_list[ 7 ] + offset_list[ 3 ] ) * multiplier / 2
+            );
+
+            int error = 0;
+            uint64_t indices = 0;
+            for ( int i = 0; i < 16; i++ ) {
+                int a = px[ i ][ 3 ];
+                int best = 0;
+                int best_e = 0x7fffffff;
+                for ( int j = 0; j < 8; j++ ) {
+                    int v = clamp_byte( base + offset_list[ j ] * multiplier );
+                    int e = ( a - v ) * ( a - v );
+                    if ( e < best_e ) {
+                        best_e = e;
+                        best = j;
+                    }
+                }
+                error += best_e;
+
+                int bit = ( i % 4 ) * 4 + i / 4;
+                indices |= (uint64_t) best << ( 45 - bit * 3 );
+            }
+
+            if ( error < best_error ) {
+                best_error = error;
+                best_block = (uint64_t) base << 56 |
+                             (uint64_t) multiplier << 52 |
+                             (uint64_t) table << 48 | indices;
+            }
+        }
+    }
+
+    write_big_endian( best_block, out );
+}
+
+// etc [end] ///////////////////////////////////////////////////////////////////
+
+static void encode_level(
+    const unsigned char * image,
+    int width,
+    int height,
+    int format,
+    unsigned char * out
+)
+{
+    int blocks_x = ( width + 3 ) / 4;
+    int blocks_y = ( height + 3 ) / 4;
+
+    for ( int by = 0; by < blocks_y; by++ ) {
+        for ( int bx = 0; bx < blocks_x; bx++ ) {
+            unsigned char px[ 16 ][ 4 ];
+            read_block( image, width, height, bx, by, px );
+
+            switch ( format ) {
+            case TEXTURE_FORMAT_BC1:
+                encode_bc1_block( px, out );
+                out += 8;
+                break;
+            case TEXTURE_FORMAT_BC3:
+                encode_bc3_alpha( px, out );
+                encode_bc1_block( px, out + 8 );
+                out += 16;
+                break;
+            case TEXTURE_FORMAT_ETC2_RGB:
+                encode_etc_block( px, out );
+                out += 8;
+                break;
+            case TEXTURE_FORMAT_ETC2_RGBA:
+                encode_eac_alpha( px, out );
+                encode_etc_block( px, out + 8 );
+                out += 16;
+                break;
+            }
+        }
+    }
+}
+
+static uint64_t align( uint64_t offset )
+{
+    return ( offset + TEXTURE_FILE_ALIGN - 1 ) &
+           ~(uint64_t) ( TEXTURE_FILE_ALIGN - 1 );
+}
+
+/// level_list holds the rgba mip chain
+static int write_texture_file(
+    const char * path,
+    unsigned char ** level_list,
+    int level_count,
+    int width,
+    int height,
+    int format
+)
+{
+    FILE * out = fopen( path, "wb" );
+    if ( !out ) {
+        ERROR_LOG( "failed to open %s", path );
+        return 1;
+    }
+
+    texture_file_header_t header;
+    memcpy( header.magic, texture_file_magic, 4 );
+    header.version = TEXTURE_FILE_VERSION;
+    header.format = format;
+    header.width = width;
+    header.height = height;
+    header.level_count = level_count;
+
+    texture_file_level_t * entry_list = new texture_file_level_t[ level_count ];
+
+    uint64_t offset = align(
+        sizeof( texture_file_header_t ) +
+        sizeof( texture_file_level_t ) * level_count
+    );
+    for ( int level = 0; level < level_count; level++ ) {
+        entry_list[ level ].offset = offset;
+        entry_list[ level ].size = texture_level_size(
+            format,
+            texture_level_side( width, level ),
+            texture_level_side( height, level )
+        );
+        offset = align( offset + entry_list[ level ].size );
+    }
+
+    fwrite( &header, sizeof( texture_file_header_t ), 1, out );
+    fwrite( entry_list, sizeof( texture_file_level_t ), level_count, out );
+
+    uint64_t at = sizeof( texture_file_header_t ) +
+                  sizeof( texture_file_level_t ) * level_count;
+
+    for ( int level = 0; level < level_count; level++ ) {
+        static const char zero[ TEXTURE_FILE_ALIGN ] = {};
+        fwrite( zero, 1, entry_list[ level ].offset - at, out );
+
+        unsigned char * blocks = new unsigned char[ entry_list[ level ].size ];
+        encode_level(
+            level_list[ level ],
+            texture_level_side( width, level ),
+            texture_level_side( height, level ),
+            format,
+            blocks
+        );
+        fwrite( blocks, 1, entry_list[ level ].size, out );
+        delete[] blocks;
+
+        at = entry_list[ level ].offset + entry_list[ level ].size;
+    }
+
+    int errors = ferror( out );
+    fclose( out );
+    delete[] entry_list;
+
+    if ( errors ) {
+        ERROR_LOG( "failed to write %s", path );
+        remove( path );
+        return 1;
+    }
+
+    return 0;
+}
+
+/// 0 = encoded, 1 = failed, 2 = skipped
+static int pack_image( const char * dir, const char * name )
+{
+    char image_path[ MAX_PATH_LENGTH ];
+    char bc_path[ MAX_PATH_LENGTH ];
+    char etc_path[ MAX_PATH_LENGTH ];
+    snprintf( image_path, MAX_PATH_LENGTH, "%s/%s", dir, name );
+    snprintf(
+        bc_path,
+        MAX_PATH_LENGTH,
+        "%s/%s" TEXTURE_FILE_BC_SUFFIX,
+        dir,
+        name
+    );
+    snprintf(
+        etc_path,
+        MAX_PATH_LENGTH,
+        "%s/%s" TEXTURE_FILE_ETC_SUFFIX,
+        dir,
+        name
+    );
+
+    if ( is_up_to_date( image_path, bc_path ) &&
+         is_up_to_date( image_path, etc_path ) ) {
+        return 2;
+    }
+
+    int width, height, channels;
+    unsigned char * image =
+        stbi_load( image_path, &width, &height, &channels, 4 );
+    if ( !image ) {
+        ERROR_LOG( "failed to load %s", image_path );
+        return 1;
+    }
+
+    // palettes keep their exact colors, and webgl only takes s3tc with whole
+    // blocks at level 0
+    if ( texture_level_count( width, height ) == 1 || width % 4 != 0 ||
+         height % 4 != 0 ) {
+        INFO_LOG( "%-24s %dx%d, kept as it is", name, width, height );
+        stbi_image_free( image );
+        return 2;
+    }
+
+    bool has_alpha = false;
+    for ( int i = 0; i < width * height; i++ ) {
+        if ( image[ i * 4 + 3 ] != 255 ) has_alpha = true;
+    }
+
+    int level_count = texture_level_count( width, height );
+    unsigned char ** level_list = new unsigned char *[ level_count ];
+    level_list[ 0 ] = image;
+    for ( int level = 1; level < level_count; level++ ) {
+        int out_width = texture_level_side( width, level );
+        int out_height = texture_level_side( height, level );
+        level_list[ level ] = new unsigned char[ out_width * out_height * 4 ];
+        downsample_image(
+            level_list[ level - 1 ],
+            texture_level_side( width, level - 1 ),
+            texture_level_side( height, level - 1 ),
+            level_list[ level ],
+            out_width,
+            out_height,
+            4
+        );
+    }
+
+    int errors = 0;
+    errors += write_texture_file(
+        bc_path,
+        level_list,
+        level_count,
+        width,
+        height,
+        has_alpha ? TEXTURE_FORMAT_BC3 : TEXTURE_FORMAT_BC1
+    );
+    errors += write_texture_file(
+        etc_path,
+        level_list,
+        level_count,
+        width,
+        height,
+        has_alpha ? TEXTURE_FORMAT_ETC2_RGBA : TEXTURE_FORMAT_ETC2_RGB
+    );
+
+    INFO_LOG(
+        "%-24s %dx%d, %d levels%s",
+        name,
+        width,
+        height,
+        level_count,
+        has_alpha ? ", alpha" : ""
+    );
+
+    for ( int level = 1; level < level_count; level++ ) {
+        delete[] level_list[ level ];
+    }
+    delete[] level_list;
+    stbi_image_free( image );
+
+    return errors > 0 ? 1 : 0;
+}
+
+int main( int argc, char ** argv )
+{
+    if ( argc != 2 ) {
+        fprintf( stderr, "usage: texpack <res dir>\n" );
+        return 1;
+    }
+
+    const char * dir = argv[ 1 ];
+
+    int count;
+    char ** name_list = list_images( dir, &count );
+
+    int encoded = 0;
+    int errors = 0;
+    for ( int i = 0; i < count; i++ ) {
+        int result = pack_image( dir, name_list[ i ] );
+        if ( result == 0 ) encoded++;
+        if ( result == 1 ) errors++;
+    }
+
+    INFO_LOG( "encoded %d of %d images", encoded, count );
+
+    for ( int i = 0; i < count; i++ ) free( name_list[ i ] );
+    free( name_list );
+
+    return errors > 0 ? 1 : 0;
+}